@@ -0,0 +1,367 @@
+#include "assembler.hpp"
+#include "common/error.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace shl
+{
+    namespace
+    {
+        // The register's encoding, which needs a REX bit for r8 and up.
+        [[nodiscard]] constexpr std::uint8_t get_encoding(x86_register reg) noexcept
+        {
+            return +reg & 15;
+        }
+
+        // The register's size in bytes.
+        [[nodiscard]] constexpr std::uint8_t get_size(x86_register reg) noexcept
+        {
+            return is_qword_register(reg) ? 8 : 4;
+        }
+
+        // The condition code the conditional jump's opcode adds to 0x70 (rel8) or 0x0F 0x80 (rel32).
+        [[nodiscard]] constexpr std::uint8_t get_condition_code(x86_mnemonic mnemonic) noexcept
+        {
+            constexpr std::uint8_t codes[]{0x2, 0x3, 0x4, 0x4, 0x5, 0x5, 0x6, 0x7}; // jb, jae, je, jz, jne, jnz, jbe, ja
+            static_assert(std::size(codes) == +x86_mnemonic::_range_conditional_jumps_end - +x86_mnemonic::_range_conditional_jumps_begin);
+            return codes[+mnemonic - +x86_mnemonic::_range_conditional_jumps_begin];
+        }
+
+        [[nodiscard]] constexpr bool is_int8(std::uint64_t value) noexcept
+        {
+            return static_cast<std::int64_t>(value) >= INT8_MIN && static_cast<std::int64_t>(value) <= INT8_MAX;
+        }
+
+        [[nodiscard]] constexpr bool is_int32(std::uint64_t value) noexcept
+        {
+            return static_cast<std::int64_t>(value) >= INT32_MIN && static_cast<std::int64_t>(value) <= INT32_MAX;
+        }
+    } // namespace
+
+    auto object_code::find(std::string_view name) const noexcept -> const symbol*
+    {
+        auto it = std::ranges::find(symbols, name, &symbol::name);
+        return it != symbols.end() ? &*it : nullptr;
+    }
+
+    object_code assembler::operator()()
+    {
+        for (auto& line : _assembly.get_lines())
+        {
+            ++_line_number;
+            assemble_line(line);
+        }
+
+        // Resolve references within text, and relocate the rest.
+        for (auto& reference : _references)
+        {
+            auto& symbol = _code.symbols[reference.symbol];
+            if (symbol.section == section_kind::text)
+            {
+                auto displacement = static_cast<std::uint32_t>(symbol.offset + reference.addend - reference.offset);
+                for (std::size_t i = 0; i < 4; ++i)
+                    _code.text[reference.offset + i] = static_cast<std::uint8_t>(displacement >> (i * 8));
+            }
+            else
+                _code.relocations.push_back({reference.offset, reference.symbol, reference.addend});
+        }
+
+        // Size functions in the order they're in text.
+        std::vector<object_code::symbol*> functions;
+        for (auto& symbol : _code.symbols)
+        {
+            if (symbol.is_function && symbol.section != section_kind::text)
+                error("Function " + symbol.name + " isn't in .text");
+            if (symbol.is_function)
+                functions.push_back(&symbol);
+        }
+        std::ranges::sort(functions, {}, &object_code::symbol::offset);
+        for (std::size_t i = 0; i < functions.size(); ++i)
+            functions[i]->size = (i + 1 < functions.size() ? functions[i + 1]->offset : _code.text.size()) - functions[i]->offset;
+
+        return std::move(_code);
+    }
+
+    void assembler::assemble_line(const assembly_line& line)
+    {
+        switch (line.kind)
+        {
+        case assembly_line_kind::blank:
+        case assembly_line_kind::comment:
+            break;
+        case assembly_line_kind::section:
+            _section = line.section;
+            break;
+        case assembly_line_kind::global:
+        {
+            auto& symbol = _code.symbols[get_symbol(line.symbol)];
+            symbol.is_global = true;
+            symbol.is_function |= line.is_function;
+            break;
+        }
+        case assembly_line_kind::label:
+            define_symbol(line.symbol);
+            break;
+        case assembly_line_kind::quad:
+            if (_section != section_kind::data)
+                error("dq is only supported in .data");
+            define_symbol(line.symbol);
+            for (std::size_t i = 0; i < 8; ++i)
+                _code.data.push_back(static_cast<std::uint8_t>(line.value >> (i * 8)));
+            break;
+        case assembly_line_kind::reserve:
+            if (_section != section_kind::bss)
+                error("resq is only supported in .bss");
+            define_symbol(line.symbol);
+            _code.bss_size += line.value * 8;
+            break;
+        case assembly_line_kind::instruction:
+        {
+            if (_section != section_kind::text)
+                error("Instructions are only supported in .text");
+            std::size_t operand_count = 0;
+            while (operand_count < line.operands.size() && line.operands[operand_count].kind != x86_operand_kind::none)
+                ++operand_count;
+            for (std::size_t i = 0; i < operand_count; ++i)
+            {
+                auto& operand = line.operands[i];
+                if (operand.kind != x86_operand_kind::mem)
+                    continue;
+                if (operand.symbol == symbol_id::empty && !is_qword_register(operand.reg))
+                    error("Invalid base register");
+                if (!is_int32(operand.value))
+                    error("Invalid displacement");
+            }
+            assemble_instruction(line.mnemonic, std::span(line.operands.data(), operand_count));
+            break;
+        }
+        }
+    }
+
+    void assembler::assemble_instruction(x86_mnemonic mnemonic, std::span<const x86_operand> operands)
+    {
+        using enum x86_operand_kind;
+        using enum x86_mnemonic;
+
+        auto is = [&operands](auto... kinds)
+        {
+            std::size_t i = 0;
+            return operands.size() == sizeof...(kinds) && ((operands[i++].kind == kinds) && ...);
+        };
+        auto size = [&operands](std::size_t i) { return get_size(operands[i].reg); };
+        auto encoding = [&operands](std::size_t i) { return get_encoding(operands[i].reg); };
+
+        switch (mnemonic)
+        {
+        case mov:
+            if (is(reg, reg) && size(0) == size(1))
+            {
+                emit_rex(size(0) == 8, encoding(1), encoding(0));
+                emit(0x89);
+                emit_modrm(encoding(1), operands[0]);
+            }
+            else if (is(reg, imm))
+            {
+                // Like NASM, moves of values that fit in 32 bits write the 32-bit register, which zero extends.
+                bool is_wide = operands[1].value > UINT32_MAX;
+                if (is_wide && size(0) != 8)
+                    error("Immediate too large");
+                emit_rex(is_wide, 0, encoding(0));
+                emit(0xB8 + (encoding(0) & 7));
+                if (is_wide)
+                    emit_u64(operands[1].value);
+                else
+                    emit_u32(static_cast<std::uint32_t>(operands[1].value));
+            }
+            else if (is(reg, mem) && size(0) == 8)
+            {
+                emit_rex(true, encoding(0), encoding(1));
+                emit(0x8B);
+                emit_modrm(encoding(0), operands[1]);
+            }
+            else if (is(mem, reg) && size(1) == 8)
+            {
+                emit_rex(true, encoding(1), encoding(0));
+                emit(0x89);
+                emit_modrm(encoding(1), operands[0]);
+            }
+            else
+                error("Unsupported operands");
+            break;
+        case add:
+        case sub:
+        case xor_:
+        case cmp:
+        case test:
+        {
+            // The opcode with a register source, and the ModRM reg field with an immediate source.
+            std::uint8_t opcode = mnemonic == add ? 0x01 : mnemonic == sub ? 0x29 : mnemonic == xor_ ? 0x31 : mnemonic == cmp ? 0x39 : 0x85;
+            std::uint8_t extension = mnemonic == add ? 0 : mnemonic == sub ? 5 : mnemonic == xor_ ? 6 : 7;
+            if (is(reg, reg) && size(0) == size(1))
+            {
+                emit_rex(size(0) == 8, encoding(1), encoding(0));
+                emit(opcode);
+                emit_modrm(encoding(1), operands[0]);
+            }
+            else if (is(reg, imm) && mnemonic != test && is_int32(operands[1].value))
+            {
+                bool is_short = is_int8(operands[1].value);
+                emit_rex(size(0) == 8, 0, encoding(0));
+                emit(is_short ? 0x83 : 0x81);
+                emit_modrm(extension, operands[0]);
+                if (is_short)
+                    emit(static_cast<std::uint8_t>(operands[1].value));
+                else
+                    emit_u32(static_cast<std::uint32_t>(operands[1].value));
+            }
+            else
+                error("Unsupported operands");
+            break;
+        }
+        case mul:
+        case div:
+            if (!is(reg))
+                error("Unsupported operands");
+            emit_rex(size(0) == 8, 0, encoding(0));
+            emit(0xF7);
+            emit_modrm(mnemonic == mul ? 4 : 6, operands[0]);
+            break;
+        case push:
+        case pop:
+            if (is(reg) && size(0) == 8)
+            {
+                emit_rex(false, 0, encoding(0));
+                emit((mnemonic == push ? 0x50 : 0x58) + (encoding(0) & 7));
+            }
+            else if (is(imm) && mnemonic == push && is_int32(operands[0].value))
+            {
+                // Pushes the immediate sign extended to 64 bits.
+                if (is_int8(operands[0].value))
+                {
+                    emit(0x6A);
+                    emit(static_cast<std::uint8_t>(operands[0].value));
+                }
+                else
+                {
+                    emit(0x68);
+                    emit_u32(static_cast<std::uint32_t>(operands[0].value));
+                }
+            }
+            else
+                error("Unsupported operands");
+            break;
+        case ret:
+            if (!operands.empty())
+                error("Unsupported operands");
+            emit(0xC3);
+            break;
+        case syscall:
+            if (!operands.empty())
+                error("Unsupported operands");
+            if (_syscall_symbol != symbol_id::empty)
+            {
+                emit(0xE8);
+                emit_displacement(_syscall_symbol, 0);
+            }
+            else
+            {
+                emit(0x0F);
+                emit(0x05);
+            }
+            break;
+        default:
+            // The conditional jumps, jmp and call.
+            if (!is(label))
+                error("Unsupported operands");
+            // Always the rel32 forms, so every instruction's size is known as soon as it's assembled.
+            if (is_conditional_jump(mnemonic))
+            {
+                emit(0x0F);
+                emit(0x80 + get_condition_code(mnemonic));
+            }
+            else
+                emit(mnemonic == jmp ? 0xE9 : 0xE8);
+            emit_displacement(operands[0].symbol, 0);
+            break;
+        }
+    }
+
+    std::uint32_t assembler::get_symbol(symbol_id symbol)
+    {
+        auto [it, inserted] = _symbol_table.try_emplace(symbol, static_cast<std::uint32_t>(_code.symbols.size()));
+        if (inserted)
+            _code.symbols.push_back({.name = std::string(get_interner().get(symbol))});
+        return it->second;
+    }
+
+    void assembler::define_symbol(symbol_id symbol_)
+    {
+        auto& symbol = _code.symbols[get_symbol(symbol_)];
+        if (symbol.section != section_kind::undefined)
+            error("Symbol redefined");
+        symbol.section = _section;
+        switch (_section)
+        {
+        case section_kind::text: symbol.offset = _code.text.size(); break;
+        case section_kind::data: symbol.offset = _code.data.size(); break;
+        case section_kind::bss:  symbol.offset = _code.bss_size;    break;
+        default: break;
+        }
+    }
+
+    void assembler::emit_u32(std::uint32_t value)
+    {
+        for (std::size_t i = 0; i < 4; ++i)
+            emit(static_cast<std::uint8_t>(value >> (i * 8)));
+    }
+
+    void assembler::emit_u64(std::uint64_t value)
+    {
+        for (std::size_t i = 0; i < 8; ++i)
+            emit(static_cast<std::uint8_t>(value >> (i * 8)));
+    }
+
+    void assembler::emit_rex(bool w, std::uint8_t reg, std::uint8_t rm)
+    {
+        std::uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+        if (rex != 0x40)
+            emit(rex);
+    }
+
+    void assembler::emit_modrm(std::uint8_t reg, const x86_operand& rm, std::uint8_t immediate_size)
+    {
+        reg = (reg & 7) << 3;
+        if (rm.kind == x86_operand_kind::reg)
+            emit(0xC0 | reg | (get_encoding(rm.reg) & 7));
+        else if (rm.symbol != symbol_id::empty)
+        {
+            emit(0x05 | reg); // RIP-relative
+            emit_displacement(rm.symbol, static_cast<std::int64_t>(rm.value), immediate_size);
+        }
+        else
+        {
+            std::uint8_t base = get_encoding(rm.reg) & 7;
+            // rbp and r13 as a base always need a displacement, since without one they mean RIP-relative.
+            std::uint8_t mod = rm.value == 0 && base != 5 ? 0x00 : is_int8(rm.value) ? 0x40 : 0x80;
+            emit(mod | reg | base);
+            if (base == 4) // rsp and r12 as a base need a SIB byte.
+                emit(0x24);
+            if (mod == 0x40)
+                emit(static_cast<std::uint8_t>(rm.value));
+            else if (mod == 0x80)
+                emit_u32(static_cast<std::uint32_t>(rm.value));
+        }
+    }
+
+    void assembler::emit_displacement(symbol_id symbol, std::int64_t addend, std::uint8_t immediate_size)
+    {
+        // The displacement is relative to the end of the instruction, which is after it and any immediate.
+        _references.push_back({_code.text.size(), get_symbol(symbol), addend - 4 - immediate_size});
+        emit_u32(0);
+    }
+
+    void assembler::error(std::string_view message) const
+    {
+        error_exit("Assembler", message, _line_number);
+    }
+} // namespace shl
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "back/assembly.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace shl
+{
+    // Machine code and data assembled from one assembly file, before it's placed in memory.
+    struct object_code
+    {
+        struct symbol
+        {
+            std::string name;
+            section_kind section = section_kind::undefined;
+            // The offset into its section.
+            std::uint64_t offset = 0;
+            // Functions are the symbols declared with global name:function, which must be in text. Every other label in text
+            // is in a function, so a function's size is the number of bytes up to the next function, or the end of text.
+            std::uint64_t size = 0;
+            bool is_global = false;
+            bool is_function = false;
+        };
+
+        // A 32-bit displacement in text, which must be set to the symbol's address plus the addend minus the displacement's address
+        // once the sections are placed. References from text to text are already resolved, so they're never relocated.
+        struct relocation
+        {
+            std::uint64_t offset;
+            std::uint32_t symbol;
+            std::int64_t addend;
+        };
+
+        std::vector<std::uint8_t> text;
+        std::vector<std::uint8_t> data;
+        std::uint64_t bss_size = 0;
+        std::vector<symbol> symbols;
+        std::vector<relocation> relocations;
+
+        // Returns the symbol, or nullptr if there's no symbol by that name.
+        [[nodiscard]] const symbol* find(std::string_view name) const noexcept;
+    };
+
+    // Encodes assembly into x86-64 machine code, so the generated code can be run or linked without an external assembler.
+    // Memory operands naming a symbol are RIP-relative, so the code runs wherever it's placed,
+    // as long as each section is within 2 GiB of text.
+    class assembler
+    {
+    public:
+        // If syscall_symbol isn't empty, syscall instructions call it instead, so whoever places the code can handle them.
+        [[nodiscard]] explicit assembler(const assembly& assembly, symbol_id syscall_symbol = symbol_id::empty) noexcept
+            : _assembly(assembly), _syscall_symbol(syscall_symbol) {}
+
+        assembler(const assembler&) = delete;
+        assembler(assembler&&) = delete;
+        assembler& operator=(const assembler&) = delete;
+        assembler& operator=(assembler&&) = delete;
+
+        [[nodiscard]] object_code operator()();
+
+    private:
+        // A 32-bit displacement in text to a symbol, resolved once every symbol is defined.
+        struct reference
+        {
+            std::uint64_t offset;
+            std::uint32_t symbol;
+            std::int64_t addend;
+        };
+
+    private:
+        void assemble_line(const assembly_line& line);
+        void assemble_instruction(x86_mnemonic mnemonic, std::span<const x86_operand> operands);
+
+        // Returns the symbol's index, adding it undefined if it's new.
+        [[nodiscard]] std::uint32_t get_symbol(symbol_id symbol);
+        void define_symbol(symbol_id symbol);
+
+        void emit(std::uint8_t byte) { _code.text.push_back(byte); }
+        void emit_u32(std::uint32_t value);
+        void emit_u64(std::uint64_t value);
+        // Emits a REX prefix, if any of its bits are needed.
+        void emit_rex(bool w, std::uint8_t reg, std::uint8_t rm);
+        // Emits the ModRM byte and whatever follows it for the operand, with immediate_size bytes of immediate still to follow.
+        void emit_modrm(std::uint8_t reg, const x86_operand& rm, std::uint8_t immediate_size = 0);
+        // Emits a 32-bit displacement to the symbol plus the addend, relative to the end of the instruction.
+        void emit_displacement(symbol_id symbol, std::int64_t addend, std::uint8_t immediate_size = 0);
+
+        [[noreturn]] void error(std::string_view message) const;
+
+    private:
+        const assembly& _assembly;
+        symbol_id _syscall_symbol;
+
+        object_code _code;
+        section_kind _section = section_kind::text;
+        // The line being assembled, counting from 1 like the lines of the assembly written as text.
+        std::uint32_t _line_number = 0;
+        std::unordered_map<symbol_id, std::uint32_t> _symbol_table;
+        std::vector<reference> _references;
+    };
+} // namespace shl
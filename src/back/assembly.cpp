@@ -0,0 +1,168 @@
+#include "assembly.hpp"
+#include <iterator>
+#include <string_view>
+
+namespace shl
+{
+    namespace
+    {
+        constexpr std::string_view register_names[]
+        {
+            "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+            "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+        };
+        static_assert(std::size(register_names) == +x86_register::_count);
+
+        constexpr std::string_view mnemonic_names[]
+        {
+            "mov", "add", "sub", "xor", "cmp", "test", "mul", "div", "push", "pop",
+            "jb", "jae", "je", "jz", "jne", "jnz", "jbe", "ja",
+            "jmp", "call", "ret", "syscall",
+        };
+        static_assert(std::size(mnemonic_names) == +x86_mnemonic::_count);
+
+        constexpr std::string_view section_names[]{"", ".text", ".data", ".bss"};
+        static_assert(std::size(section_names) == +section_kind::_count);
+
+        void append_operand(std::string& text, const x86_operand& operand)
+        {
+            switch (operand.kind)
+            {
+            case x86_operand_kind::reg:
+                text += register_names[+operand.reg];
+                break;
+            case x86_operand_kind::imm:
+                text += std::to_string(operand.value);
+                break;
+            case x86_operand_kind::mem:
+            {
+                if (operand.is_qword)
+                    text += "QWORD ";
+                text += '[';
+                text += operand.symbol != symbol_id::empty ? get_interner().get(operand.symbol) : register_names[+operand.reg];
+                auto displacement = static_cast<std::int64_t>(operand.value);
+                if (displacement)
+                {
+                    text += displacement > 0 ? " + " : " - ";
+                    text += std::to_string(displacement > 0 ? operand.value : -operand.value);
+                }
+                text += ']';
+                break;
+            }
+            case x86_operand_kind::label:
+                text += get_interner().get(operand.symbol);
+                break;
+            default:
+                break;
+            }
+        }
+    } // namespace
+
+    void assembly::section(section_kind section)
+    {
+        _lines.push_back({.kind = assembly_line_kind::section, .section = section});
+    }
+
+    void assembly::global(symbol_id symbol, bool is_function)
+    {
+        _lines.push_back({.kind = assembly_line_kind::global, .is_function = is_function, .symbol = symbol});
+    }
+
+    void assembly::label(symbol_id symbol, std::uint32_t indent, std::string comment)
+    {
+        _lines.push_back({.kind = assembly_line_kind::label, .indent = indent, .symbol = symbol, .comment = std::move(comment)});
+    }
+
+    void assembly::quad(symbol_id symbol, std::uint64_t value)
+    {
+        _lines.push_back({.kind = assembly_line_kind::quad, .symbol = symbol, .value = value});
+    }
+
+    void assembly::reserve(symbol_id symbol, std::uint64_t count)
+    {
+        _lines.push_back({.kind = assembly_line_kind::reserve, .symbol = symbol, .value = count});
+    }
+
+    void assembly::instruction(x86_mnemonic mnemonic, x86_operand first, x86_operand second, std::uint32_t indent, std::string comment)
+    {
+        _lines.push_back({.kind = assembly_line_kind::instruction, .mnemonic = mnemonic, .indent = indent, .operands{first, second}, .comment = std::move(comment)});
+    }
+
+    void assembly::comment(std::string text, std::uint32_t indent)
+    {
+        _lines.push_back({.kind = assembly_line_kind::comment, .indent = indent, .comment = std::move(text)});
+    }
+
+    void assembly::blank()
+    {
+        _lines.emplace_back();
+    }
+
+    void assembly::append(assembly&& other)
+    {
+        if (_lines.empty())
+            _lines = std::move(other._lines);
+        else
+            _lines.insert(_lines.end(), std::make_move_iterator(other._lines.begin()), std::make_move_iterator(other._lines.end()));
+        other._lines.clear();
+    }
+
+    std::string assembly::to_string() const
+    {
+        std::string text;
+        for (auto& line : _lines)
+        {
+            text += to_string(line);
+            text += '\n';
+        }
+        return text;
+    }
+
+    std::string assembly::to_string(const assembly_line& line)
+    {
+        std::string text(line.indent * 4, ' ');
+        switch (line.kind)
+        {
+        case assembly_line_kind::blank:
+            return text;
+        case assembly_line_kind::comment:
+            text += "; ";
+            text += line.comment;
+            return text;
+        case assembly_line_kind::section:
+            text += "section ";
+            text += section_names[+line.section];
+            break;
+        case assembly_line_kind::global:
+            text += "global ";
+            text += get_interner().get(line.symbol);
+            if (line.is_function)
+                text += ":function";
+            break;
+        case assembly_line_kind::label:
+            text += get_interner().get(line.symbol);
+            text += ':';
+            break;
+        case assembly_line_kind::quad:
+        case assembly_line_kind::reserve:
+            text += get_interner().get(line.symbol);
+            text += line.kind == assembly_line_kind::quad ? ": dq " : ": resq ";
+            text += std::to_string(line.value);
+            break;
+        case assembly_line_kind::instruction:
+            text += mnemonic_names[+line.mnemonic];
+            for (std::size_t i = 0; i < line.operands.size() && line.operands[i].kind != x86_operand_kind::none; ++i)
+            {
+                text += i == 0 ? " " : ", ";
+                append_operand(text, line.operands[i]);
+            }
+            break;
+        }
+        if (!line.comment.empty())
+        {
+            text += " ; ";
+            text += line.comment;
+        }
+        return text;
+    }
+} // namespace shl
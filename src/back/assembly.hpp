@@ -0,0 +1,167 @@
+#pragma once
+
+#include "common/interner.hpp"
+#include "common/ranged_enum.hpp"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace shl
+{
+    DEFINE_RANGED_ENUM(section_kind,
+        (
+            undefined, // Symbols used but not defined, which whoever places the code provides.
+            text,
+            data,
+            bss
+        ),
+        // Ranges
+        ()
+    );
+
+    // The general purpose registers the generators use, numbered so the low 4 bits are their encoding.
+    DEFINE_RANGED_ENUM(x86_register,
+        (
+            rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15,
+            eax, ecx, edx, ebx, esp, ebp, esi, edi, r8d, r9d, r10d, r11d, r12d, r13d, r14d, r15d
+        ),
+        // Ranges
+        (
+            (qword_register, rax, r15 + 1),
+            (dword_register, eax, r15d + 1)
+        )
+    );
+
+    // The instructions the generators emit.
+    DEFINE_RANGED_ENUM(x86_mnemonic,
+        (
+            mov, add, sub, xor_, cmp, test, mul, div, push, pop,
+            // Jumps taken on a condition, the unsigned ones, and what's tested after test.
+            jb, jae, je, jz, jne, jnz, jbe, ja,
+            jmp, call, ret, syscall
+        ),
+        // Ranges
+        (
+            (conditional_jump, jb, ja + 1)
+        )
+    );
+
+    enum class x86_operand_kind : std::uint8_t { none, reg, imm, mem, label };
+
+    // An instruction's operand. Memory operands naming a symbol are RIP-relative.
+    struct x86_operand
+    {
+        x86_operand_kind kind = x86_operand_kind::none;
+        // If a memory operand is written with its size, as QWORD.
+        bool is_qword = false;
+        // The register, or the base register of a memory operand that doesn't name a symbol.
+        x86_register reg = x86_register::rax;
+        // The immediate, or the displacement of a memory operand.
+        std::uint64_t value = 0;
+        // The symbol of a label or memory operand, or empty.
+        symbol_id symbol = symbol_id::empty;
+
+        [[nodiscard]] constexpr x86_operand() noexcept = default;
+        [[nodiscard]] constexpr x86_operand(x86_register reg) noexcept : kind(x86_operand_kind::reg), reg(reg) {}
+        [[nodiscard]] constexpr x86_operand(std::uint64_t value) noexcept : kind(x86_operand_kind::imm), value(value) {}
+
+        [[nodiscard]] static constexpr x86_operand memory(x86_register base, std::int64_t displacement = 0, bool is_qword = false) noexcept
+        {
+            x86_operand operand(base);
+            operand.kind = x86_operand_kind::mem;
+            operand.is_qword = is_qword;
+            operand.value = static_cast<std::uint64_t>(displacement);
+            return operand;
+        }
+
+        [[nodiscard]] static constexpr x86_operand memory(symbol_id symbol, bool is_qword = false) noexcept
+        {
+            x86_operand operand;
+            operand.kind = x86_operand_kind::mem;
+            operand.is_qword = is_qword;
+            operand.symbol = symbol;
+            return operand;
+        }
+
+        // A memory operand like this one, written with its size.
+        [[nodiscard]] constexpr x86_operand qword() const noexcept
+        {
+            x86_operand operand = *this;
+            operand.is_qword = true;
+            return operand;
+        }
+
+        // The target of a jump or call.
+        [[nodiscard]] static constexpr x86_operand label(symbol_id symbol) noexcept
+        {
+            x86_operand operand;
+            operand.kind = x86_operand_kind::label;
+            operand.symbol = symbol;
+            return operand;
+        }
+    };
+
+    enum class assembly_line_kind : std::uint8_t
+    {
+        blank,
+        comment,
+        section,     // section .name
+        global,      // global name, or global name:function
+        label,       // name:
+        quad,        // name: dq value
+        reserve,     // name: resq value
+        instruction,
+    };
+
+    // One line of assembly, as it's written in NASM's syntax.
+    struct assembly_line
+    {
+        assembly_line_kind kind = assembly_line_kind::blank;
+        section_kind section = section_kind::undefined;
+        x86_mnemonic mnemonic = x86_mnemonic::ret;
+        // If a global symbol is a function, as NASM's ELF extension marks them.
+        bool is_function = false;
+        // The number of levels of 4 spaces the line is indented by.
+        std::uint32_t indent = 0;
+        // The symbol defined or declared.
+        symbol_id symbol = symbol_id::empty;
+        // The value of a quad, or the number of quads reserved.
+        std::uint64_t value = 0;
+        std::array<x86_operand, 2> operands;
+        // A comment line's text, or the comment after anything else.
+        std::string comment;
+    };
+
+    // Code the generators emit for the assembler to encode, in the NASM subset it supports: x86-64 instructions,
+    // and the labels and directives around them. It's only written out as NASM source when that's what's wanted,
+    // so building or running a program never formats assembly only to parse it again.
+    // Symbols are interned, so assembly can be generated in pieces and appended together.
+    class assembly
+    {
+    public:
+        void section(section_kind section);
+        void global(symbol_id symbol, bool is_function = true);
+        void label(symbol_id symbol, std::uint32_t indent = 0, std::string comment = {});
+        void quad(symbol_id symbol, std::uint64_t value);
+        void reserve(symbol_id symbol, std::uint64_t count);
+        void instruction(x86_mnemonic mnemonic, x86_operand first = {}, x86_operand second = {}, std::uint32_t indent = 1, std::string comment = {});
+        void comment(std::string text, std::uint32_t indent = 0);
+        void blank();
+
+        // Moves the other assembly's lines to the end of this one's.
+        void append(assembly&& other);
+
+        [[nodiscard]] std::span<const assembly_line> get_lines() const noexcept { return _lines; }
+
+        // Returns the assembly as NASM source, one line of text per line.
+        [[nodiscard]] std::string to_string() const;
+
+        // Returns the line as NASM source, without a line break.
+        [[nodiscard]] static std::string to_string(const assembly_line& line);
+
+    private:
+        std::vector<assembly_line> _lines;
+    };
+} // namespace shl
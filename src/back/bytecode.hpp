@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common/ranged_enum.hpp"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace shl
+{
+    // Operations. Unless noted otherwise, a, b and c are register indices.
+    DEFINE_RANGED_ENUM(bytecode_op,
+        (
+            move,         // a = b
+            load,         // a = [b]
+            store,        // [a] = b
+            div,          // a = b / c, which traps if c is 0
+            mod,          // a = b % c, which traps if c is 0
+            mul,          // a = b * c
+            add,          // a = b + c
+            sub,          // a = b - c
+            jump,         // goto instruction a
+            jump_if_zero, // if a == 0 goto instruction b
+            exit          // exit with status a
+        ),
+        // Ranges
+        ()
+    );
+
+    struct bytecode_instruction
+    {
+        bytecode_op op;
+        std::uint32_t a = 0;
+        std::uint32_t b = 0;
+        std::uint32_t c = 0;
+    };
+
+    // A program compiled to compact, register-based bytecode, to be run in process.
+    // Every object, constant and temporary is one of a flat array of 64-bit registers.
+    // The instructions initialize the global objects that weren't initialized at compile time, then run the entry point.
+    struct bytecode
+    {
+        std::vector<bytecode_instruction> instructions;
+        // The value of each register before the first instruction runs.
+        // Constants and global objects initialized at compile time are set, and the rest are 0.
+        std::vector<std::uint64_t> registers;
+        // The entry point's argc and argv parameters, if it has them.
+        std::optional<std::uint32_t> argc_register;
+        std::optional<std::uint32_t> argv_register;
+    };
+} // namespace shl
@@ -0,0 +1,125 @@
+#include "bytecode_generator.hpp"
+#include "common/error.hpp"
+#include "middle/arithmetic.hpp"
+#include <cassert>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace shl
+{
+    namespace
+    {
+        // The op computing each arithmetic ir_op, in the same order.
+        constexpr bytecode_op arithmetic_ops[]{bytecode_op::div, bytecode_op::mod, bytecode_op::mul, bytecode_op::add, bytecode_op::sub};
+        static_assert(std::size(arithmetic_ops) == +ir_op::_range_arithmetics_end - +ir_op::_range_arithmetics_begin);
+    } // namespace
+
+    bytecode bytecode_generator::operator()()
+    {
+        auto start = _code.get_start();
+        if (!start)
+            error_exit("Run", "The entry point is not defined");
+        if (_code.get_object_count() > std::numeric_limits<std::uint32_t>::max())
+            error_exit("Run", "Too many objects to run");
+
+        // Constants and global objects initialized at compile time start with their values, and the rest with 0.
+        _bytecode.registers.resize(_code.get_object_count());
+        _functions.resize(_code.get_object_count());
+        _labels.resize(_code.get_object_count());
+        for (std::size_t id = 0; id < _code.get_object_count(); ++id)
+        {
+            if (_code.get_object_kind(id) == ir_object_kind::constant)
+                _bytecode.registers[id] = *get_value(_code.get_object(id));
+            else if (auto value = _code.get_initial_value(id))
+                _bytecode.registers[id] = *value;
+        }
+        auto functions = _code.get_functions();
+        for (std::size_t i = 0; i < functions.size(); ++i)
+            _functions[functions[i].name] = i;
+        _is_generating.resize(functions.size());
+
+        if (!start->parameters.empty())
+        {
+            _bytecode.argc_register = get_register(start->parameters[0]);
+            _bytecode.argv_register = get_register(start->parameters[1]);
+        }
+        // _start always exits, so nothing runs past its lines.
+        generate(*start);
+        return std::move(_bytecode);
+    }
+
+    void bytecode_generator::generate(const ir_function& function)
+    {
+        std::size_t index = &function - _code.get_functions().data();
+        assert(!_is_generating[index] && "functions can't call themselves.");
+        _is_generating[index] = true;
+
+        // Jumps are patched once every label in the function is placed.
+        std::vector<std::pair<std::size_t, std::size_t>> jumps;
+        std::vector<std::size_t> returns;
+        for (std::size_t i = 0; i < function.lines.size(); ++i)
+        {
+            std::visit([&]<typename T>(const T* line)
+            {
+                if constexpr (std::is_same_v<T, ir_assign>)
+                    emit(bytecode_op::move, get_register(line->dst), get_register(line->src));
+                else if constexpr (std::is_same_v<T, ir_assign_op>)
+                {
+                    assert(is_arithmetic(line->op) && "comparisons are only lowered to ifs.");
+                    emit(arithmetic_ops[+line->op - +ir_op::_range_arithmetics_begin], get_register(line->dst), get_register(line->lhs), get_register(line->rhs));
+                }
+                else if constexpr (std::is_same_v<T, ir_assign_indirect>)
+                    emit(bytecode_op::load, get_register(line->dst), get_register(line->src));
+                else if constexpr (std::is_same_v<T, ir_indirect_assign>)
+                    emit(bytecode_op::store, get_register(line->dst), get_register(line->src));
+                else if constexpr (std::is_same_v<T, ir_if>)
+                {
+                    // Conditions are only lowered to a comparison with 0.
+                    assert(line->op == ir_op::eq && _code.get_object_kind(line->rhs) == ir_object_kind::constant && _code.get_object(line->rhs) == "0");
+                    jumps.emplace_back(emit(bytecode_op::jump_if_zero, get_register(line->lhs)), line->lbl);
+                }
+                else if constexpr (std::is_same_v<T, ir_goto>)
+                    jumps.emplace_back(emit(bytecode_op::jump), line->lbl);
+                else if constexpr (std::is_same_v<T, ir_label>)
+                    _labels[line->lbl] = _bytecode.instructions.size();
+                else if constexpr (std::is_same_v<T, ir_call>)
+                {
+                    // Like the native code, the callee gets copies of the arguments, and its return values are copied back.
+                    const ir_function& callee = _code.get_functions()[_functions[line->func]];
+                    assert(callee.return_values.size() == line->return_values.size() && callee.parameters.size() == line->parameters.size());
+                    for (std::size_t j = 0; j < line->return_values.size(); ++j)
+                        emit(bytecode_op::move, get_register(callee.return_values[j]), get_register(line->return_values[j]));
+                    for (std::size_t j = 0; j < line->parameters.size(); ++j)
+                        emit(bytecode_op::move, get_register(callee.parameters[j]), get_register(line->parameters[j]));
+                    generate(callee);
+                    for (std::size_t j = 0; j < line->return_values.size(); ++j)
+                        emit(bytecode_op::move, get_register(line->return_values[j]), get_register(callee.return_values[j]));
+                }
+                else if constexpr (std::is_same_v<T, ir_return>)
+                {
+                    // The last line returns by falling through.
+                    if (i + 1 != function.lines.size())
+                        returns.push_back(emit(bytecode_op::jump));
+                }
+                else
+                    emit(bytecode_op::exit, get_register(line->status));
+            }, function.lines[i]);
+        }
+
+        for (auto [jump, label] : jumps)
+        {
+            auto& instruction = _bytecode.instructions[jump];
+            (instruction.op == bytecode_op::jump ? instruction.a : instruction.b) = static_cast<std::uint32_t>(_labels[label]);
+        }
+        for (std::size_t jump : returns)
+            _bytecode.instructions[jump].a = static_cast<std::uint32_t>(_bytecode.instructions.size());
+        _is_generating[index] = false;
+    }
+
+    std::size_t bytecode_generator::emit(bytecode_op op, std::uint32_t a, std::uint32_t b, std::uint32_t c)
+    {
+        _bytecode.instructions.push_back({op, a, b, c});
+        return _bytecode.instructions.size() - 1;
+    }
+} // namespace shl
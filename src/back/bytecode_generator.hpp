@@ -0,0 +1,46 @@
+#pragma once
+
+#include "back/bytecode.hpp"
+#include "back/ir_code.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace shl
+{
+    // Compiles a program's IR to bytecode, to run in process instead of being assembled and linked.
+    // Each line is one instruction, and each object is the register with its id, so constants and global objects
+    // start with their values. Only _start and the functions it calls are compiled, since nothing else can run.
+    class bytecode_generator
+    {
+    public:
+        [[nodiscard]] explicit bytecode_generator(const ir_code& code) noexcept : _code(code) {}
+
+        bytecode_generator(const bytecode_generator&) = delete;
+        bytecode_generator(bytecode_generator&&) = delete;
+        bytecode_generator& operator=(const bytecode_generator&) = delete;
+        bytecode_generator& operator=(bytecode_generator&&) = delete;
+
+        [[nodiscard]] bytecode operator()();
+
+    private:
+        // Compiles the function's lines in place, so a call to it is the lines themselves, and returning jumps past them.
+        void generate(const ir_function& function);
+
+        // Returns the index of the new instruction.
+        std::size_t emit(bytecode_op op, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0);
+
+        [[nodiscard]] static std::uint32_t get_register(std::size_t object) noexcept { return static_cast<std::uint32_t>(object); }
+
+    private:
+        const ir_code& _code;
+        bytecode _bytecode;
+
+        // The index of the function named by each function object.
+        std::vector<std::size_t> _functions;
+        // The instruction at each label, in the functions compiled so far.
+        std::vector<std::size_t> _labels;
+        // Whether each function is being compiled, to catch calls that could only be run with a stack.
+        std::vector<bool> _is_generating;
+    };
+} // namespace shl
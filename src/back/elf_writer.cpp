@@ -0,0 +1,275 @@
+#include "elf_writer.hpp"
+#include "common/error.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <elf.h>
+#include <string_view>
+
+namespace shl
+{
+    namespace
+    {
+        // Where static executables are loaded, like ld's default.
+        constexpr std::uint64_t base_address = 0x400000;
+        constexpr std::uint64_t page_size = 0x1000;
+
+        // Section header indices. Relocatable object files have .rela.text after .bss, which shifts the rest by one.
+        constexpr std::uint16_t text_index = 1;
+        constexpr std::uint16_t data_index = 2;
+        constexpr std::uint16_t bss_index = 3;
+        constexpr std::uint16_t relocations_index = 4;
+
+        [[nodiscard]] constexpr std::uint64_t align_up(std::uint64_t size, std::uint64_t alignment) noexcept
+        {
+            return (size + alignment - 1) / alignment * alignment;
+        }
+
+        template <typename T>
+        void append(std::string& file, const T& value)
+        {
+            file.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void overwrite(std::string& file, std::uint64_t offset, const T& value)
+        {
+            std::memcpy(file.data() + offset, &value, sizeof(T));
+        }
+
+        void append(std::string& file, const std::vector<std::uint8_t>& bytes)
+        {
+            file.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        }
+
+        void pad(std::string& file, std::uint64_t alignment)
+        {
+            file.resize(align_up(file.size(), alignment));
+        }
+
+        // Returns the offset of the string in the string table, adding it.
+        [[nodiscard]] std::uint32_t add_string(std::string& table, std::string_view string)
+        {
+            auto offset = static_cast<std::uint32_t>(table.size());
+            table += string;
+            table += '\0';
+            return offset;
+        }
+
+        [[nodiscard]] Elf64_Ehdr make_header(std::uint16_t type) noexcept
+        {
+            Elf64_Ehdr header{};
+            std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+            header.e_ident[EI_CLASS] = ELFCLASS64;
+            header.e_ident[EI_DATA] = ELFDATA2LSB;
+            header.e_ident[EI_VERSION] = EV_CURRENT;
+            header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+            header.e_type = type;
+            header.e_machine = EM_X86_64;
+            header.e_version = EV_CURRENT;
+            header.e_ehsize = sizeof(Elf64_Ehdr);
+            header.e_shentsize = sizeof(Elf64_Shdr);
+            return header;
+        }
+    } // namespace
+
+    std::string elf_writer::relocatable() const
+    {
+        std::string file;
+        append(file, make_header(ET_REL));
+
+        layout layout;
+        pad(file, 16);
+        layout.text_offset = file.size();
+        append(file, _code.text);
+        pad(file, 8);
+        layout.data_offset = file.size();
+        append(file, _code.data);
+
+        // Only references out of text are left to relocate, and they're all 32-bit and RIP-relative.
+        pad(file, 8);
+        layout.relocations_offset = file.size();
+        auto symbol_indices = get_symbol_indices();
+        for (auto& relocation : _code.relocations)
+        {
+            Elf64_Rela rela{};
+            rela.r_offset = relocation.offset;
+            rela.r_info = ELF64_R_INFO(symbol_indices[relocation.symbol], R_X86_64_PC32);
+            rela.r_addend = relocation.addend;
+            append(file, rela);
+        }
+
+        write_tables(file, layout, false);
+        return file;
+    }
+
+    std::string elf_writer::executable() const
+    {
+        // Text is loaded with the headers in one read-only segment, and data and bss in a writable one after it.
+        // A segment's address and offset must be equal modulo the page size, so data starts on a new page in memory
+        // without leaving a gap in the file.
+        std::uint64_t headers_size = sizeof(Elf64_Ehdr) + 2 * sizeof(Elf64_Phdr);
+        layout layout;
+        layout.text_offset = headers_size;
+        layout.text_address = base_address + layout.text_offset;
+        layout.data_offset = align_up(layout.text_offset + _code.text.size(), 8);
+        layout.data_address = align_up(base_address + layout.data_offset, page_size) + layout.data_offset % page_size;
+        layout.bss_address = layout.data_address + _code.data.size();
+
+        auto start = std::ranges::find(_code.symbols, "_start", &object_code::symbol::name);
+        if (start == _code.symbols.end() || start->section != section_kind::text)
+            error_exit("Linker", "There's no entry point to start at");
+
+        Elf64_Ehdr header = make_header(ET_EXEC);
+        header.e_entry = get_value(*start, layout);
+        header.e_phoff = sizeof(Elf64_Ehdr);
+        header.e_phentsize = sizeof(Elf64_Phdr);
+        header.e_phnum = 2;
+
+        Elf64_Phdr text_segment{};
+        text_segment.p_type = PT_LOAD;
+        text_segment.p_flags = PF_R | PF_X;
+        text_segment.p_vaddr = text_segment.p_paddr = base_address;
+        text_segment.p_filesz = text_segment.p_memsz = layout.text_offset + _code.text.size();
+        text_segment.p_align = page_size;
+
+        Elf64_Phdr data_segment{};
+        data_segment.p_type = PT_LOAD;
+        data_segment.p_flags = PF_R | PF_W;
+        data_segment.p_offset = layout.data_offset;
+        data_segment.p_vaddr = data_segment.p_paddr = layout.data_address;
+        data_segment.p_filesz = _code.data.size();
+        data_segment.p_memsz = _code.data.size() + _code.bss_size;
+        data_segment.p_align = page_size;
+
+        std::string file;
+        append(file, header);
+        append(file, text_segment);
+        append(file, data_segment);
+
+        // Every reference is resolved now, since there's nothing left to link with.
+        std::string text(reinterpret_cast<const char*>(_code.text.data()), _code.text.size());
+        for (auto& relocation : _code.relocations)
+        {
+            auto& symbol = _code.symbols[relocation.symbol];
+            if (symbol.section == section_kind::undefined)
+                error_exit("Linker", "Undefined symbol " + symbol.name);
+            auto displacement = static_cast<std::int32_t>(get_value(symbol, layout) + relocation.addend - (layout.text_address + relocation.offset));
+            overwrite(text, relocation.offset, displacement);
+        }
+        file += text;
+        pad(file, 8);
+        append(file, _code.data);
+
+        write_tables(file, layout, true);
+        return file;
+    }
+
+    void elf_writer::write_tables(std::string& file, const layout& layout, bool is_executable) const
+    {
+        std::uint16_t section_count = is_executable ? 7 : 8;
+        std::uint16_t symbols_index = section_count - 3;
+
+        // Symbols: the null symbol, a symbol for each loaded section, locals, then globals.
+        // Functions are exactly the symbols the assembly declared with global name:function, typed STT_FUNC and sized
+        // by the assembler. Every other label is untyped, like NASM leaves them.
+        auto symbol_indices = get_symbol_indices();
+        std::string strings(1, '\0');
+        std::vector<Elf64_Sym> symbols(4 + _code.symbols.size());
+        std::uint16_t section_indices[]{SHN_UNDEF, text_index, data_index, bss_index};
+        std::uint64_t section_addresses[]{0, layout.text_address, layout.data_address, layout.bss_address};
+        for (std::uint16_t i = 1; i < 4; ++i)
+        {
+            symbols[i].st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+            symbols[i].st_shndx = section_indices[i];
+            symbols[i].st_value = section_addresses[i];
+        }
+        std::uint32_t first_global = 4;
+        for (std::size_t i = 0; i < _code.symbols.size(); ++i)
+        {
+            auto& symbol = _code.symbols[i];
+            bool is_global = symbol.is_global || symbol.section == section_kind::undefined;
+            first_global += !is_global;
+            auto& elf_symbol = symbols[symbol_indices[i]];
+            elf_symbol.st_name = add_string(strings, symbol.name);
+            elf_symbol.st_info = ELF64_ST_INFO(is_global ? STB_GLOBAL : STB_LOCAL, symbol.is_function ? STT_FUNC : STT_NOTYPE);
+            elf_symbol.st_shndx = section_indices[+symbol.section];
+            elf_symbol.st_value = symbol.section != section_kind::undefined ? get_value(symbol, layout) : 0;
+            elf_symbol.st_size = symbol.size;
+        }
+
+        pad(file, 8);
+        std::uint64_t symbols_offset = file.size();
+        for (auto& symbol : symbols)
+            append(file, symbol);
+        std::uint64_t strings_offset = file.size();
+        file += strings;
+
+        std::string section_names(1, '\0');
+        std::uint64_t section_names_offset = file.size();
+
+        // Section headers, starting with the null section.
+        std::vector<Elf64_Shdr> sections(section_count);
+        auto add_section = [&](std::uint16_t index, std::string_view name, std::uint32_t type, std::uint64_t flags,
+            std::uint64_t address, std::uint64_t offset, std::uint64_t size, std::uint64_t alignment) -> Elf64_Shdr&
+        {
+            auto& section = sections[index];
+            section.sh_name = add_string(section_names, name);
+            section.sh_type = type;
+            section.sh_flags = flags;
+            section.sh_addr = address;
+            section.sh_offset = offset;
+            section.sh_size = size;
+            section.sh_addralign = alignment;
+            return section;
+        };
+        add_section(text_index, ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, layout.text_address, layout.text_offset, _code.text.size(), 16);
+        add_section(data_index, ".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, layout.data_address, layout.data_offset, _code.data.size(), 8);
+        add_section(bss_index, ".bss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE, layout.bss_address, layout.data_offset + _code.data.size(), _code.bss_size, 8);
+        if (!is_executable)
+        {
+            auto& relocations = add_section(relocations_index, ".rela.text", SHT_RELA, SHF_INFO_LINK, 0, layout.relocations_offset, _code.relocations.size() * sizeof(Elf64_Rela), 8);
+            relocations.sh_link = symbols_index;
+            relocations.sh_info = text_index;
+            relocations.sh_entsize = sizeof(Elf64_Rela);
+        }
+        auto& symbol_table = add_section(symbols_index, ".symtab", SHT_SYMTAB, 0, 0, symbols_offset, symbols.size() * sizeof(Elf64_Sym), 8);
+        symbol_table.sh_link = symbols_index + 1;
+        symbol_table.sh_info = first_global;
+        symbol_table.sh_entsize = sizeof(Elf64_Sym);
+        add_section(symbols_index + 1, ".strtab", SHT_STRTAB, 0, 0, strings_offset, strings.size(), 1);
+        auto& names = add_section(symbols_index + 2, ".shstrtab", SHT_STRTAB, 0, 0, section_names_offset, 0, 1);
+        names.sh_size = section_names.size(); // Only known once every section is named, including this one.
+        file += section_names;
+
+        pad(file, 8);
+        overwrite(file, offsetof(Elf64_Ehdr, e_shoff), static_cast<Elf64_Off>(file.size()));
+        overwrite(file, offsetof(Elf64_Ehdr, e_shnum), section_count);
+        overwrite(file, offsetof(Elf64_Ehdr, e_shstrndx), static_cast<std::uint16_t>(symbols_index + 2));
+        for (auto& section : sections)
+            append(file, section);
+    }
+
+    std::vector<std::uint32_t> elf_writer::get_symbol_indices() const
+    {
+        // After the null symbol and a symbol for each loaded section.
+        std::vector<std::uint32_t> indices(_code.symbols.size());
+        std::uint32_t index = 4;
+        for (bool globals : {false, true})
+            for (std::size_t i = 0; i < _code.symbols.size(); ++i)
+                if ((_code.symbols[i].is_global || _code.symbols[i].section == section_kind::undefined) == globals)
+                    indices[i] = index++;
+        return indices;
+    }
+
+    std::uint64_t elf_writer::get_value(const object_code::symbol& symbol, const layout& layout) noexcept
+    {
+        switch (symbol.section)
+        {
+        case section_kind::text: return layout.text_address + symbol.offset;
+        case section_kind::data: return layout.data_address + symbol.offset;
+        case section_kind::bss:  return layout.bss_address + symbol.offset;
+        default: return 0;
+        }
+    }
+} // namespace shl
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "back/assembler.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace shl
+{
+    // Writes object code as ELF64 files for x86-64 Linux, so programs can be built without an external assembler or linker.
+    class elf_writer
+    {
+    public:
+        [[nodiscard]] explicit elf_writer(const object_code& code) noexcept : _code(code) {}
+
+        elf_writer(const elf_writer&) = delete;
+        elf_writer(elf_writer&&) = delete;
+        elf_writer& operator=(const elf_writer&) = delete;
+        elf_writer& operator=(elf_writer&&) = delete;
+
+        // Returns a relocatable object file, like nasm -f elf64 writes, to be linked with others.
+        [[nodiscard]] std::string relocatable() const;
+
+        // Returns a static executable, like ld writes when linking the relocatable object file alone.
+        // It starts at _start, which must be defined, as must every symbol used.
+        [[nodiscard]] std::string executable() const;
+
+    private:
+        // Where each section goes in the file, and in memory if the file is executable.
+        struct layout
+        {
+            std::uint64_t text_offset = 0;
+            std::uint64_t data_offset = 0;
+            std::uint64_t text_address = 0;
+            std::uint64_t data_address = 0;
+            std::uint64_t bss_address = 0;
+            // Only in relocatable object files.
+            std::uint64_t relocations_offset = 0;
+        };
+
+    private:
+        // Appends the symbol and string tables, and the section headers, which both kinds of files end with,
+        // then sets the ELF header's section header fields. The file so far must end with its loaded contents.
+        void write_tables(std::string& file, const layout& layout, bool is_executable) const;
+
+        // Returns each symbol's index in the symbol table, where local symbols come first, as ELF requires.
+        [[nodiscard]] std::vector<std::uint32_t> get_symbol_indices() const;
+
+        // Returns the address of the symbol, or its offset into its section in a relocatable object file.
+        [[nodiscard]] static std::uint64_t get_value(const object_code::symbol& symbol, const layout& layout) noexcept;
+
+    private:
+        const object_code& _code;
+    };
+} // namespace shl
@@ -1,10 +1,10 @@
 #include "generator.hpp"
 #include "common/error.hpp"
-#include "common/util.hpp"
+#include "middle/arithmetic.hpp"
+#include "middle/function_evaluator.hpp"
 #include <algorithm>
 #include <cassert>
 #include <iostream> // DEBUG
-#include <sstream>
 #include <utility>
 
 // NOTE: How to write to stdout:
@@ -17,230 +17,350 @@
 // mov rdi, 1      ; select stdout
 // syscall         ; call the kernel
 
-#define VERBOSE_OUT(level, to_output, ...) \
-        (IS_VERBOSE(level) ? static_cast<std::stringstream&>(__VA_OPT__(g.)output(false) << to_output) : (*__VA_OPT__(g.)_output.current))
-
-#define VERBOSE_COMMENT(to_output, ...) VERBOSE_OUT(input::verbose_level::comments, " ; " << to_output __VA_OPT__(,) __VA_ARGS__)
-
 namespace shl
 {
-    struct generator_visitor
+    using enum x86_mnemonic;
+    using x86_register::rax, x86_register::rbx, x86_register::rdx, x86_register::edx, x86_register::rsp, x86_register::rbp, x86_register::rsi, x86_register::rdi;
+
+    // Generates as much of each node as it can without its children's code.
+    // Each node's assembly is indented one level more than its parent's, and commented with what the node is to its parent.
+    struct generator_visitor : node_walker<generator_visitor, generator::frame>
     {
         generator& g; // context
 
-        void operator()(std::monostate) {}
+        [[nodiscard]] explicit generator_visitor(generator& g) noexcept : node_walker(g._frames), g(g) {}
+
+        // Pushes a child of the current node, named for the comments. Returns false, since the current node isn't done yet.
+        bool push(std::string_view name, node_ref node)
+        {
+            node_walker::push(node);
+            frame().indent_level = g._output.indent_level++;
+            frame().name = name;
+            return false;
+        }
 
-        void operator()(const node_program* node)
+        // Replaces the current node with its only remaining child, named for the comments.
+        // Returns false, since the child isn't done yet.
+        bool replace(std::string_view name, node_ref node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "program\n", true);
-            for (auto node : node->declarations)
-                g.visit(this, "program", cast_variant<NODE_TYPES>(node->n_value));
+            ++g._output.indent_level;
+            std::uint32_t indent_level = frame().indent_level;
+            node_walker::replace(node);
+            frame().indent_level = indent_level;
+            frame().name = name;
+            return false;
         }
 
-        void operator()(const node_declaration* node)
+        // Comments what the current node is, and what it is to its parent, if indentation is wanted.
+        void describe(std::string_view kind)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "declaration\n", true);
-            g.visit(this, "declaration", cast_variant<NODE_TYPES>(node->n_value));
+            IF_VERBOSE(input::verbose_level::indentation)
+                if (g._output.current) // The root's comment would go nowhere.
+                    g._output.current->comment(std::string(frame().name) + ": " + std::string(kind), g._output.indent_level - 1);
         }
 
-        void operator()(const node_definition* node)
+        // Pops the current node, which is done, and goes back to its parent's indentation.
+        void pop()
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "definition\n", true);
-            g.visit(this, "definition", cast_variant<NODE_TYPES>(node->n_value));
+            g._output.indent_level = frame().indent_level;
+            node_walker::pop();
         }
 
-        void operator()(const node_declare_object* node)
+        // Returns the expression's integer literal, if that's all it is.
+        [[nodiscard]] static const node_integer_literal* get_literal(const node_expression* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "declare object\n", true);
+            auto n_term = std::get_if<node_term*>(&node->n_value);
+            auto n_literal = n_term ? std::get_if<node_integer_literal*>(&(*n_term)->n_value) : nullptr;
+            return n_literal ? *n_literal : nullptr;
+        }
+
+        // Returns the literal's value. Constant folding leaves literals too big for 64 bits for this to report.
+        [[nodiscard]] static std::uint64_t get_literal_value(const node_integer_literal* node)
+        {
+            auto value = get_value(node);
+            if (!value)
+                error_exit("Generator", "Integer literal doesn't fit in 64 bits");
+            return *value;
+        }
+
+        bool operator()(std::monostate) { return true; }
+
+        bool operator()(const node_program* node)
+        {
+            std::uint32_t i = frame().stage++;
+            if (i == 0)
+                describe("program");
+            if (i < node->declarations.size())
+                return push("program", node->declarations[i]->n_value);
+            return true;
+        }
+
+        bool operator()(const node_declaration* node)
+        {
+            describe("declaration");
+            return replace("declaration", node->n_value);
+        }
+
+        bool operator()(const node_definition* node)
+        {
+            describe("definition");
+            return replace("definition", node->n_value);
+        }
+
+        bool operator()(const node_declare_object* node)
+        {
+            describe("declare object");
             if (g.has_current_function())
-                g.create_object(node->n_name->value, false);
+                g.create_object(node->n_name, false);
             else
                 assert(false && "declaring static objects unimplemented.");
                 // TODO: if next defining an object with the same name, it must be made initialized.
                 // If it's not initialized by the end of generation, the program is ill-formed.
-                // g.create_uninitialized(node->n_name->value);
+                // g.create_uninitialized(node->n_name);
+            return true;
         }
 
-        void operator()(const node_define_object* node)
+        bool operator()(const node_define_object* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "define object\n", true);
+            auto& f = frame();
+            if (f.stage++ == 0)
+            {
+                describe("define object");
+                if (g.has_current_function())
+                    f.object_ = &g.create_object(node->n_name, false);
+                else if (auto n_literal = get_literal(node->n_expression))
+                {
+                    // Constant folding left a constant initializer as a literal, so it's initialized at compile time.
+                    g._output.initialized_static.quad(g.create_initialized(node->n_name).label, get_literal_value(n_literal));
+                    return true;
+                }
+                else
+                {
+                    // The initializer runs in _start, in source order. Initializers can only use
+                    // global objects defined before them, so those are always initialized first.
+                    f.object_ = &g.create_uninitialized(node->n_name);
+                    f.output_backup = std::exchange(g._output.current, &g._output.uninitialized_static_construct);
+                }
+                return push("expression", node->n_expression->n_value);
+            }
 
             if (g.has_current_function())
             {
-                auto& object = g.create_object(node->n_name->value, false);
-                g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression->n_value));
-                g.output() << "mov [" << object.get_address() << "], rax";
-                VERBOSE_COMMENT(node->n_name->value, true);
-                g.output(false) << '\n';
+                g.emit(mov, f.object_->get_address(), rax, node->n_name->value);
             }
             else
             {
-                // TODO: if the expression is constexpr, create an initialized object instead.
-                auto& object = g.create_uninitialized(node->n_name->value);
-                g.with_output(g._output.uninitialized_static_construct, [&]
-                {
-                    g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression->n_value));
-                    g.output() << "mov [" << object.get_address() << "], rax\n";
-                });
+                g.emit(mov, f.object_->get_address(), rax);
+                g._output.current = f.output_backup;
             }
+            return true;
         }
 
-        void operator()(const node_function* node)
+        bool operator()(const node_function* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "function\n", true);
+            describe("function");
             assert(false && "unnamed function unimplemented.");
+            return true;
         }
 
-        void operator()(const node_named_function* node)
+        bool operator()(const node_named_function* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "named function\n", true);
+            auto& f = frame();
+            if (f.stage++ == 0)
+            {
+                describe("named function");
 
-            std::stringstream s_namespace;
-            for (std::string_view nested_signature : g._nested_function_signatures)
-                s_namespace << nested_signature << ".."; // The .. replaces :: (namespace resolution operator).
-            std::string signature = g.create_function_signature(node);
-            if (g.get_function_from_signature(signature)) error_exit("Generator", "Redefined function");
+                std::stringstream s_namespace;
+                for (const generator::function* nested_function : g._function_stack)
+                    s_namespace << nested_function->signature << ".."; // The .. replaces :: (namespace resolution operator).
+                std::string signature(get_interner().get(node->signature));
 
-            auto& functions = g.has_current_function() ? g.get_current_function().nested_functions : g._functions;
-            auto& function = functions.emplace_back(node->n_name->value, std::move(signature), std::move(s_namespace).str());
-            g._nested_function_signatures.push_back(function.signature);
+                generator::function* function;
+                if (g.has_current_function())
+                    function = &g.get_current_function().nested_functions.emplace_back(node, node->n_name->symbol, node->n_name->value, std::move(signature), std::move(s_namespace).str());
+                else
+                {
+                    if (!g._function_name_table.find(node->n_name->symbol))
+                        g._function_name_table.insert(node->n_name->symbol, g._functions.size());
+                    function = &g._functions.emplace_back(node, node->n_name->symbol, node->n_name->value, std::move(signature), std::move(s_namespace).str());
+                }
+                g._function_stack.push_back(function);
 
-            std::ptrdiff_t return_value_count = node->n_function->return_values.size();
-            std::ptrdiff_t parameter_count = node->n_function->parameters.size();
-            std::ptrdiff_t stack_offset = return_value_count + parameter_count + 1; // + 1 only if push rbp
+                std::ptrdiff_t return_value_count = node->n_function->return_values.size();
+                std::ptrdiff_t parameter_count = node->n_function->parameters.size();
+                std::ptrdiff_t stack_offset = return_value_count + parameter_count + 1; // + 1 only if push rbp
 
-            // Convert the return values.
-            function.return_values.reserve(return_value_count);
-            for (auto n_return_value : node->n_function->return_values)
-                function.return_values.emplace_back(n_return_value->n_name->value, stack_offset--);
+                // Convert the return values.
+                function->return_values.reserve(return_value_count);
+                for (auto n_return_value : node->n_function->return_values)
+                {
+                    function->object_table.emplace(n_return_value->n_name, generator::object_ref{&function->return_values, function->return_values.size()});
+                    function->return_values.emplace_back(n_return_value->n_name, n_return_value->n_name->value, stack_offset--);
+                }
 
-            // Convert the parameters.
-            function.parameters.reserve(parameter_count);
-            for (auto n_parameter : node->n_function->parameters)
-                function.parameters.emplace_back(n_parameter->n_declare_object->n_name->value, stack_offset--);
+                // Convert the parameters.
+                function->parameters.reserve(parameter_count);
+                for (auto n_parameter : node->n_function->parameters)
+                {
+                    auto n_name = n_parameter->n_declare_object->n_name;
+                    function->object_table.emplace(n_name, generator::object_ref{&function->parameters, function->parameters.size()});
+                    function->parameters.emplace_back(n_name, n_name->value, stack_offset--);
+                }
 
-            g.with_output(function.output, [&]
-            {
+                f.output_backup = std::exchange(g._output.current, &function->output);
                 // TODO: dont allocate this
-                g.output_label(function.namespace_ + function.signature) << '\n';
-                g.output() << "push rbp\n";
-                g.output() << "mov rbp, rsp\n";
-                g.visit(this, "statement", cast_variant<NODE_TYPES>(node->n_function->n_statement->n_value));
-                g.output() << "pop rbp\n";
-                g.output() << "ret\n";
-            });
+                // Functions are global, so they're typed and sized in object files and perf maps.
+                symbol_id label = get_interner().intern(function->namespace_ + function->signature);
+                g._output.current->global(label);
+                g.emit_label(label);
+                g.emit(x86_mnemonic::push, rbp);
+                g.emit(mov, rbp, rsp);
+                return push("statement", node->n_function->n_statement->n_value);
+            }
 
-            g._nested_function_signatures.pop_back();
+            g.emit(x86_mnemonic::pop, rbp);
+            g.emit(ret);
+            g._output.current = f.output_backup;
+            // The function's table is only looked in while it's the current function, so free it.
+            g.get_current_function().object_table = {};
+            g._function_stack.pop_back();
+            return true;
         }
 
-        void operator()(const node_parameter* node)
+        bool operator()(const node_parameter* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "parameter\n", true);
+            describe("parameter");
             assert(false && "parameter unimplemented.");
+            return true;
         }
 
-        void operator()(const node_scope* node)
+        bool operator()(const node_scope* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "scope\n", true);
-            g.begin_scope();
-            for (auto n_scoped_statement : node->scoped_statements)
-                g.visit(this, "scoped statement", cast_variant<NODE_TYPES>(n_scoped_statement->n_value));
+            std::uint32_t i = frame().stage++;
+            if (i == 0)
+            {
+                describe("scope");
+                g.begin_scope();
+            }
+            if (i < node->scoped_statements.size())
+                return push("scoped statement", node->scoped_statements[i]->n_value);
             g.end_scope();
+            return true;
         }
 
-        void operator()(const node_statement* node)
+        bool operator()(const node_statement* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "statement\n", true);
+            describe("statement");
             if (!std::holds_alternative<std::monostate>(node->n_value))
-                g.visit(this, "statement", cast_variant<NODE_TYPES>(node->n_value));
+                return replace("statement", node->n_value);
+            return true;
         }
 
-        void operator()(const node_scoped_statement* node)
+        bool operator()(const node_scoped_statement* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "scoped statement\n", true);
-            g.visit(this, "scoped statement", cast_variant<NODE_TYPES>(node->n_value));
+            describe("scoped statement");
+            return replace("scoped statement", node->n_value);
         }
 
-        void operator()(const node_expression* node)
+        bool operator()(const node_expression* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "expression\n", true);
-            g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_value));
+            describe("expression");
+            return replace("expression", node->n_value);
         }
 
-        void operator()(const node_term* node)
+        bool operator()(const node_term* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "term\n", true);
-            g.visit(this, "term", cast_variant<NODE_TYPES>(node->n_value));
+            describe("term");
+            return replace("term", node->n_value);
         }
 
-        void operator()(const node_return* node)
+        bool operator()(const node_return* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "return\n", true);
-            g.output() << "pop rbp\n";
-            g.output() << "ret\n";
+            describe("return");
+            g.emit(mov, rsp, rbp); // Free the function's objects.
+            g.emit(x86_mnemonic::pop, rbp);
+            g.emit(ret);
+            return true;
         }
 
-        void operator()(const node_if* node)
+        bool operator()(const node_if* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "if\n", true);
-            g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression->n_value));
-            std::string label_end_if = g.create_label();
-            g.output() << "test rax, rax\n";
-            g.output() << "jz " << label_end_if << '\n';
-            g.visit(this, "statement", cast_variant<NODE_TYPES>(node->n_statement->n_value));
-            g.output_label(label_end_if);
-            VERBOSE_COMMENT("endif", true) << '\n';
+            auto& f = frame();
+            switch (f.stage++)
+            {
+            case 0:
+                describe("if");
+                return push("expression", node->n_expression->n_value);
+            case 1:
+                f.label_end = g.create_label();
+                g.emit(test, rax, rax);
+                g.emit(jz, x86_operand::label(f.label_end));
+                return push("statement", node->n_statement->n_value);
+            default:
+                g.emit_label(f.label_end, "endif");
+                return true;
+            }
         }
 
-        void operator()(const node_reassign* node)
+        bool operator()(const node_reassign* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "reassign\n", true);
+            auto& f = frame();
+            if (f.stage++ == 0)
+            {
+                describe("reassign");
+
+                f.object_ = g.get_object(node->n_identifier->declaration);
+                assert(f.object_ && "semantic analysis missed an undefined object.");
 
-            auto object = g.get_object(node->n_identifier->value);
-            if (!object) ERROR_EXIT("Generator", "Undefined object \"" << node->n_identifier->value << '"');
+                return push("expression", node->n_expression->n_value);
+            }
 
-            g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression->n_value));
-            g.output() << "mov [" << object->get_address() << "], rax";
-            if (!object->is_static())
-                VERBOSE_COMMENT(node->n_identifier->value, true);
-            g.output(false) << '\n';
+            g.emit(mov, f.object_->get_address(), rax, f.object_->is_static() ? std::string_view() : node->n_identifier->value);
+            return true;
         }
 
-        void operator()(const node_scoped_if* node)
+        bool operator()(const node_scoped_if* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "scoped if\n", true);
-
-            std::string label_end_if = g.create_label();
-            std::string label_next_if = node->ifs.size() == 1 ? label_end_if : g.create_label(); // Copy ok, won't allocate.
-
-            std::size_t i = 0;
-            do
+            // Each if takes two stages: one before its expression, and one before its statement.
+            auto& f = frame();
+            std::uint32_t stage = f.stage++;
+            std::size_t i = stage / 2;
+            if (stage == 0)
             {
-                auto n_if = node->ifs[i++];
-                if (n_if->n_expression) // Only else blocks won't enter here.
-                {
-                    g.visit(this, "expression", cast_variant<NODE_TYPES>(n_if->n_expression->n_value));
-                    g.output() << "test rax, rax\n";
-                    g.output() << "jz " << label_next_if << '\n';
-                }
-                g.visit(this, "statement", cast_variant<NODE_TYPES>(n_if->n_statement->n_value));
-                if (i < node->ifs.size())
+                describe("scoped if");
+                f.label_end = g.create_label();
+                f.label_next = node->ifs.size() == 1 ? f.label_end : g.create_label();
+            }
+            else if (stage % 2 == 0) // The previous if's statement is done.
+            {
+                if (i == node->ifs.size())
                 {
-                    g.output() << "jmp " << label_end_if << '\n';
-                    g.output_label(label_next_if);
-                    VERBOSE_COMMENT((node->ifs[i]->n_expression ? "elif" : "else"), true) << '\n';
-                    label_next_if = i + 1 < node->ifs.size() ? g.create_label() : label_end_if;
+                    g.emit_label(f.label_end, "endif");
+                    return true;
                 }
+                g.emit(jmp, x86_operand::label(f.label_end));
+                g.emit_label(f.label_next, node->ifs[i]->n_expression ? "elif" : "else");
+                f.label_next = i + 1 < node->ifs.size() ? g.create_label() : f.label_end;
             }
-            while (i < node->ifs.size());
 
-            g.output_label(label_end_if);
-            VERBOSE_COMMENT("endif", true) << '\n';
+            auto n_if = node->ifs[i];
+            if (n_if->n_expression) // Only else blocks won't enter here.
+            {
+                if (stage % 2 == 0)
+                    return push("expression", n_if->n_expression->n_value);
+                g.emit(test, rax, rax);
+                g.emit(jz, x86_operand::label(f.label_next));
+            }
+            else
+                ++f.stage; // There's no expression to wait for.
+            return push("statement", n_if->n_statement->n_value);
         }
 
-        void operator()(const node_binary_expression* node)
+        bool operator()(const node_binary_expression* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "binary expression\n", true);
+            std::uint32_t stage = frame().stage++;
+            if (stage == 0)
+                describe("binary expression");
 
             bool expand_lhs = std::holds_alternative<node_binary_expression*>(node->n_expression_lhs->n_value) ||
                 std::holds_alternative<node_expression*>(std::get<node_term*>(node->n_expression_lhs->n_value)->n_value);
@@ -249,194 +369,221 @@ namespace shl
 
             if (!expand_lhs && !expand_rhs) // both are leaves
             {
-                g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression_lhs->n_value));
-                g.output() << "mov rbx, rax\n";
-                g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression_rhs->n_value));
-                g.visit(this, "binary operator", cast_variant<NODE_TYPES>(node->n_binary_operator->n_value));
+                switch (stage)
+                {
+                case 0:
+                    return push("expression", node->n_expression_rhs->n_value); // compute rhs first
+                case 1:
+                    g.emit(mov, rbx, rax);
+                    return push("expression", node->n_expression_lhs->n_value);
+                }
             }
             else if (!expand_lhs) // lhs is a leaf, but rhs is not
             {
-                g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression_rhs->n_value)); // compute rhs first
-                g.output() << "push rax\n";
-                g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression_lhs->n_value));
-                g.output() << "pop rbx\n";
-                g.visit(this, "binary operator", cast_variant<NODE_TYPES>(node->n_binary_operator->n_value));
+                switch (stage)
+                {
+                case 0:
+                    return push("expression", node->n_expression_rhs->n_value); // compute rhs first
+                case 1:
+                    g.emit(x86_mnemonic::push, rax);
+                    return push("expression", node->n_expression_lhs->n_value);
+                case 2:
+                    g.emit(x86_mnemonic::pop, rbx);
+                    break;
+                }
             }
             else
             {
-                g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression_lhs->n_value));
-                g.output() << "push rax\n";
-                g.visit(this, "expression", cast_variant<NODE_TYPES>(node->n_expression_rhs->n_value));
-                g.output() << "mov rbx, rax\n";
-                g.output() << "pop rax\n";
-                g.visit(this, "binary operator", cast_variant<NODE_TYPES>(node->n_binary_operator->n_value));
+                switch (stage)
+                {
+                case 0:
+                    return push("expression", node->n_expression_lhs->n_value);
+                case 1:
+                    g.emit(x86_mnemonic::push, rax);
+                    return push("expression", node->n_expression_rhs->n_value);
+                case 2:
+                    g.emit(mov, rbx, rax);
+                    g.emit(x86_mnemonic::pop, rax);
+                    break;
+                }
             }
+            return replace("binary operator", node->n_binary_operator->n_value);
         }
 
-        void operator()(const node_binary_operator* node)
+        bool operator()(const node_binary_operator* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "binary operator\n", true);
-            g.visit(this, "binary operator", cast_variant<NODE_TYPES>(node->n_value));
+            describe("binary operator");
+            return replace("binary operator", node->n_value);
         }
 
-        void operator()(const node_parameter_pass* node)
+        bool operator()(const node_parameter_pass* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "parameter pass\n", true);
-            g.visit(this, "parameter pass", cast_variant<NODE_TYPES>(node->n_value));
+            describe("parameter pass");
+            return replace("parameter pass", node->n_value);
         }
 
-        void operator()(const node_integer_literal* node)
+        bool operator()(const node_integer_literal* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "integer literal\n", true);
-            g.output() << "mov rax, " << node->value << '\n';
+            describe("integer literal");
+            g.emit(mov, rax, get_literal_value(node));
+            return true;
         }
 
-        void operator()(const node_identifier* node)
+        bool operator()(const node_identifier* node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "identifier\n", true);
+            describe("identifier");
 
-            auto object = g.get_object(node->value);
-            if (!object) error_exit("Generator", "Undeclared identifier");
+            auto object = g.get_object(node->declaration);
+            assert(object && "semantic analysis missed an undeclared identifier.");
 
-            g.output() << "mov rax, QWORD [" << object->get_address() << "]";
-            if (!object->is_static())
-                VERBOSE_COMMENT(node->value, true);
-            g.output(false) << '\n';
+            g.emit(mov, rax, object->get_address().qword(), object->is_static() ? std::string_view() : node->value);
+            return true;
         }
 
-        void operator()(const node_forward_slash& node)
+        bool operator()(const node_forward_slash& node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "/\n", true);
-            g.output() << "div rbx\n";
+            describe("/");
+            g.emit(xor_, edx, edx); // div divides rdx:rax by reg
+            g.emit(div, rbx);
+            return true;
         }
 
-        void operator()(const node_percent& node)
+        bool operator()(const node_percent& node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "%\n", true);
-            g.output() << "div rbx\n";
-            g.output() << "mov rax, rdx\n"; // div puts reg1 % reg2 in rdx
+            describe("%");
+            g.emit(xor_, edx, edx); // div divides rdx:rax by reg
+            g.emit(div, rbx);
+            g.emit(mov, rax, rdx); // div puts reg1 % reg2 in rdx
+            return true;
         }
 
-        void operator()(const node_asterisk& node)
+        bool operator()(const node_asterisk& node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "*\n", true);
-            g.output() << "mul rbx\n";
+            describe("*");
+            g.emit(mul, rbx);
+            return true;
         }
 
-        void operator()(const node_plus& node)
+        bool operator()(const node_plus& node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "+\n", true);
-            g.output() << "add rax, rbx\n";
+            describe("+");
+            g.emit(add, rax, rbx);
+            return true;
         }
 
-        void operator()(const node_minus& node)
+        bool operator()(const node_minus& node)
         {
-            VERBOSE_OUT(input::verbose_level::indentation, "-\n", true);
-            g.output() << "sub rax, rbx\n";
+            describe("-");
+            g.emit(sub, rax, rbx);
+            return true;
         }
 
-        void operator()(const node_in& node)
+        bool operator()(const node_in& node)
         {
             assert(false && "in unimplemented.");
+            return true;
         }
 
-        void operator()(const node_out& node)
+        bool operator()(const node_out& node)
         {
             assert(false && "out unimplemented.");
+            return true;
         }
 
-        void operator()(const node_inout& node)
+        bool operator()(const node_inout& node)
         {
             assert(false && "inout unimplemented.");
+            return true;
         }
 
-        void operator()(const node_copy& node)
+        bool operator()(const node_copy& node)
         {
             assert(false && "copy unimplemented.");
+            return true;
         }
 
-        void operator()(const node_move& node)
+        bool operator()(const node_move& node)
         {
             assert(false && "move unimplemented.");
+            return true;
         }
     };
 
-    std::string generator::operator()()
+    assembly generator::operator()()
     {
         // Generate everything.
-        generator_visitor visitor(*this);
-        visit(&visitor, "program", nodes(_root));
+        generate("program", _root);
         generate_start();
 
         // Output bss.
-        _output.bss << "section .bss\n\n";
-        IF_VERBOSE(input::verbose_level::comments) _output.bss << "; Allocate UNinitialized global/static objects.\n";
+        _output.bss.section(section_kind::bss);
+        _output.bss.blank();
+        IF_VERBOSE(input::verbose_level::comments) _output.bss.comment("Allocate UNinitialized global/static objects.");
         for (auto& object : _uninitialized_static_objects)
-            _output.bss << object.get_address() << ": resq 1\n";
+            _output.bss.reserve(object.label, 1);
         for (auto& function : _functions)
             for (auto& object : function.static_objects)
-                _output.bss << object.get_address() << ": resq 1\n";
+                _output.bss.reserve(object.label, 1);
 
         // Output data.
-        _output.data << "section .data\n\n";
-        IF_VERBOSE(input::verbose_level::comments) _output.data << "; Allocate/define initialized global/static objects.\n";
-        output_stream(_output.data, _output.initialized_static);
+        _output.data.section(section_kind::data);
+        _output.data.blank();
+        IF_VERBOSE(input::verbose_level::comments) _output.data.comment("Allocate/define initialized global/static objects.");
+        _output.data.append(std::move(_output.initialized_static));
 
         // Output text.
-        _output.text << "section .text\n\n";
-        IF_VERBOSE(input::verbose_level::comments) _output.text << "; Allocate/define constant objects.\n";
-        output_stream(_output.text, _output.constants) << '\n';
+        _output.text.section(section_kind::text);
+        _output.text.blank();
+        IF_VERBOSE(input::verbose_level::comments) _output.text.comment("Allocate/define constant objects.");
+        _output.text.append(std::move(_output.constants));
+        _output.text.blank();
 
-        IF_VERBOSE(input::verbose_level::comments) _output.text << "; Define provided functions.\n";
+        IF_VERBOSE(input::verbose_level::comments) _output.text.comment("Define provided functions.");
         for (auto& function : _functions)
             generate_function(function);
-        IF_VERBOSE(input::verbose_level::comments) _output.text << "; Define the pre-entrypoint.\n";
-        output_stream(_output.text, _output._start);
+        IF_VERBOSE(input::verbose_level::comments) _output.text.comment("Define the pre-entrypoint.");
+        _output.text.append(std::move(_output._start));
 
         // Combine everything and return the final assembly.
-        std::stringstream output;
-        output_stream(output, _output.bss) << '\n';
-        output_stream(output, _output.data) << '\n';
-        output_stream(output, _output.text);
-        return std::move(output).str();
+        assembly output;
+        output.append(std::move(_output.bss));
+        output.blank();
+        output.append(std::move(_output.data));
+        output.blank();
+        output.append(std::move(_output.text));
+        return output;
     }
 
-    std::stringstream& generator::output(bool indent)
+    void generator::generate(std::string_view name, node_ref root)
     {
-        if (indent)
-        {
-            IF_VERBOSE(input::verbose_level::indentation)
-            {
-                for (std::size_t i = 0; i < _output.indent_level; ++i)
-                    *_output.current << "    ";
-            }
-            else
-                *_output.current << "    ";
-        }
-        return *_output.current;
+        // The root is pushed like a child, so it's named and indented like one.
+        generator_visitor visitor(*this);
+        visitor.push(name, root);
+        while (!_frames.empty())
+            visitor.step();
     }
 
-    std::stringstream& generator::output_label(std::string_view label)
+    void generator::emit(x86_mnemonic mnemonic, x86_operand first, x86_operand second, std::string_view comment)
     {
-        IF_VERBOSE(input::verbose_level::indentation)
-        {
-            for (std::size_t i = 0; i < _output.indent_level - 1; ++i)
-                *_output.current << "    ";
-        }
-        *_output.current << label << ':';
-        return *_output.current;
+        std::uint32_t indent = IS_VERBOSE(input::verbose_level::indentation) ? _output.indent_level : 1;
+        _output.current->instruction(mnemonic, first, second, indent, IS_VERBOSE(input::verbose_level::comments) ? std::string(comment) : std::string());
     }
 
-    std::stringstream& generator::exchange_current_output(std::stringstream& new_output)
+    void generator::emit_label(symbol_id label, std::string_view comment)
     {
-        return *std::exchange(_output.current, &new_output);
+        std::uint32_t indent = IS_VERBOSE(input::verbose_level::indentation) ? _output.indent_level - 1 : 0;
+        _output.current->label(label, indent, IS_VERBOSE(input::verbose_level::comments) ? std::string(comment) : std::string());
     }
 
-    std::stringstream& generator::output_stream(std::stringstream& destination, std::stringstream& source)
+    void generator::emit_comment(std::string_view comment)
     {
-        if (source.rdbuf()->in_avail() > 0)
-            destination << std::move(source).rdbuf();
-        return destination;
+        std::uint32_t indent = IS_VERBOSE(input::verbose_level::indentation) ? _output.indent_level : 1;
+        IF_VERBOSE(input::verbose_level::comments) _output.current->comment(std::string(comment), indent);
+    }
+
+    assembly& generator::exchange_current_output(assembly& new_output)
+    {
+        return *std::exchange(_output.current, &new_output);
     }
 
     void generator::begin_scope()
@@ -446,217 +593,185 @@ namespace shl
 
     void generator::end_scope()
     {
-        auto& objects = get_current_function().objects;
-        if (std::size_t pop_count = objects.size() - _scopes.back())
+        auto& function = get_current_function();
+        if (std::size_t pop_count = function.objects.size() - _scopes.back())
         {
-            output() << "add rsp, " << (pop_count * elem_size) << '\n';
-            objects.erase(objects.end() - pop_count, objects.end());
+            emit(add, rsp, pop_count * elem_size);
+            for (std::size_t i = _scopes.back(); i < function.objects.size(); ++i)
+                function.object_table.erase(function.objects[i].declaration);
+            function.objects.erase(function.objects.end() - pop_count, function.objects.end());
         }
         _scopes.pop_back();
     }
 
-    auto generator::create_uninitialized(std::string_view name) -> object&
+    auto generator::create_uninitialized(const node_identifier* n_name) -> object&
     {
-        if (get_object(name)) error_exit("Generator", "Redefined object");
-        return _uninitialized_static_objects.emplace_back(name, 0);
+        _static_object_table.emplace(n_name, object_ref{&_uninitialized_static_objects, _uninitialized_static_objects.size()});
+        return _uninitialized_static_objects.emplace_back(n_name, n_name->value, 0, get_interner().intern(std::string(n_name->value) + '_'));
     }
 
-    auto generator::create_initialized(std::string_view name) -> object&
+    auto generator::create_initialized(const node_identifier* n_name) -> object&
     {
-        if (get_object(name)) error_exit("Generator", "Redefined object");
-        return _initialized_static_objects.emplace_back(name, 0);
+        _static_object_table.emplace(n_name, object_ref{&_initialized_static_objects, _initialized_static_objects.size()});
+        return _initialized_static_objects.emplace_back(n_name, n_name->value, 0, get_interner().intern(std::string(n_name->value) + '_'));
     }
 
-    auto generator::create_constant(std::string_view name) -> object&
+    auto generator::create_constant(const node_identifier* n_name) -> object&
     {
-        if (get_object(name)) error_exit("Generator", "Redefined object");
-        return _constant_objects.emplace_back(name, 0);
+        return _constant_objects.emplace_back(n_name, n_name->value, 0, get_interner().intern(std::string(n_name->value) + '_'));
     }
 
-    auto generator::create_object(std::string_view name, bool is_static) -> object&
+    auto generator::create_object(const node_identifier* n_name, bool is_static) -> object&
     {
-        if (get_object(name)) error_exit("Generator", "Redefined object");
         assert(has_current_function());
 
+        auto& function = get_current_function();
         if (!is_static)
         {
-            auto& objects = get_current_function().objects;
-            auto& object = objects.emplace_back(name, -(1 + objects.size())); // +1 for push rbp
-            output() << "sub rsp, " << elem_size << '\n';
+            function.object_table.emplace(n_name, object_ref{&function.objects, function.objects.size()});
+            auto& object = function.objects.emplace_back(n_name, n_name->value, -(1 + function.objects.size())); // +1 for push rbp
+            emit(sub, rsp, elem_size);
             return object;
         }
         else
         {
-            auto& function = get_current_function();
             std::string object_address = function.signature;
             object_address += "::";
-            object_address += name;
-            return function.static_objects.emplace_back(object_address, 0);
+            object_address += n_name->value;
+            // Intern the address so the object's name outlives this function.
+            function.object_table.emplace(n_name, object_ref{&function.static_objects, function.static_objects.size()});
+            std::string_view name = get_interner().get(get_interner().intern(object_address));
+            return function.static_objects.emplace_back(n_name, name, 0, get_interner().intern(object_address + '_'));
         }
     }
 
-    auto generator::get_object(std::string_view name) -> object*
+    auto generator::get_object(const node_identifier* declaration) -> object*
     {
-        auto check = [=](const object& object) { return object.name == name; };
-        object* object_ = nullptr;
         if (has_current_function())
-        {
-            auto& function = get_current_function();
-                 if (auto it = std::ranges::find_if(function.parameters, check); it != function.parameters.end()) object_ = it.base();
-            else if (auto it = std::ranges::find_if(function.return_values, check); it != function.return_values.end()) object_ = it.base();
-            else if (auto it = std::ranges::find_if(function.objects, check); it != function.objects.end()) object_ = it.base();
-            else if (auto it = std::ranges::find_if(function.static_objects, check); it != function.static_objects.end()) object_ = it.base();
-        }
-        if (!object_)
-        {
-                 if (auto it = std::ranges::find_if(_uninitialized_static_objects, check); it != _uninitialized_static_objects.end()) object_ = it.base();
-            else if (auto it = std::ranges::find_if(_initialized_static_objects, check); it != _initialized_static_objects.end()) object_ = it.base();
-        }
-        return object_;
-    }
-
-    auto generator::get_function_from_name(std::string_view name) -> function*
-    {
-        auto check = [=](const function& function) { return function.name == name; };
-        if (auto it = std::ranges::find_if(_functions, check); it != _functions.end()) return it.base();
+            if (auto object_ = get_current_function().object_table.find(declaration); object_ != get_current_function().object_table.end())
+                return &object_->second.get();
+        if (auto object_ = _static_object_table.find(declaration); object_ != _static_object_table.end())
+            return &object_->second.get();
         return nullptr;
     }
 
-    auto generator::get_function_from_signature(std::string_view signature) -> function*
+    auto generator::get_function_from_name(symbol_id symbol) -> function*
     {
-        auto check = [=](const function& function) { return function.signature == signature; };
-        function* function = nullptr;
-        if (has_current_function())
-        {
-            auto& functions = get_current_function().nested_functions;
-            if (check(get_current_function())) function = &get_current_function();
-            else if (auto it = std::ranges::find_if(functions, check); it != functions.end()) function = it.base();
-        }
-        if (!function)
-            if (auto it = std::ranges::find_if(_functions, check); it != _functions.end()) function = it.base();
-        return function;
+        if (std::size_t* index = _function_name_table.find(symbol))
+            return &_functions[*index];
+        return nullptr;
     }
 
     auto generator::get_current_function() -> function&
     {
         assert(has_current_function());
-        function* function = &_functions.back();
-        while (!function->nested_functions.empty())
-            function = &function->nested_functions.back();
-        return *function;
+        return *_function_stack.back();
     }
 
     bool generator::has_current_function() const noexcept
     {
-        return !_nested_function_signatures.empty();
+        return !_function_stack.empty();
     }
 
-    std::string generator::create_label(std::string_view short_name) noexcept
+    symbol_id generator::create_label(std::string_view short_name)
     {
-        // As long as short_name is at most 5 characters:
-        // an upper bound for the number of characters this label will take is:
-        // "5 + ceil(log10(1 << 32)) == 15", which is exactly the capacity of
-        // std::string's SSBO, meaning this will never allocate.
         static std::uint32_t _label_count = 0;
-        return std::string(short_name) + std::to_string(_label_count++);
-    }
-
-    std::string generator::create_function_signature(const node_named_function* node)
-    {
-        std::stringstream s_signaure;
-        s_signaure << node->n_name->value;
-
-        s_signaure << '_';
-        for (auto n_return_value : node->n_function->return_values)
-            s_signaure << '_' << n_return_value->n_name->value; // TODO: When types are implemented, change "n_name" to "n_type".
-
-        s_signaure << '_';
-        for (auto n_parameter : node->n_function->parameters)
-            s_signaure << '_' << n_parameter->n_declare_object->n_name->value; // TODO: When types are implemented, change "n_name" to "n_type".
-
-        // Change asterisks (from pointer types) to periods to appease assembler.
-        std::string signature = s_signaure.str();
-        for (char& c : signature)
-            if (c == '*')
-                c = '.';
-        return signature;
+        return get_interner().intern(std::string(short_name) + std::to_string(_label_count++));
     }
 
     void generator::generate_start()
     {
-        // Verify correct state.
-
-        auto entry_point = get_function_from_name(get_input().entry_point);
+        auto entry_point_symbol = get_interner().find(get_input().entry_point);
+        if (!entry_point_symbol) return;
+        auto entry_point = get_function_from_name(*entry_point_symbol);
         if (!entry_point) return;
 
-        if (entry_point->return_values.size() > 1)
-            error_exit("Generator", "Ill-formed entry point. Incorrect return value count. Must be 0 or 1");
-        if (entry_point->parameters.size() != 2 && !entry_point->parameters.empty())
-            error_exit("Generator", "Ill-formed entry point. Incorrect parameter count. Must be 0 or 2");
+        // Semantic analysis checked the entry point is well-formed.
+        assert(entry_point->return_values.size() <= 1);
+        assert(entry_point->parameters.size() == 2 || entry_point->parameters.empty());
 
-        // Generate start.
+        // If the entry point is pure and doesn't use argc or argv, run it now instead, and just exit with its result.
+        // Its return value starts as the 0 pushed for it.
+        std::vector<std::optional<std::uint64_t>> initial_values(entry_point->return_values.size(), 0);
+        initial_values.resize(initial_values.size() + entry_point->parameters.size());
+        std::optional<std::vector<std::uint64_t>> results = function_evaluator()(entry_point->node, initial_values);
 
         auto& output_backup = exchange_current_output(_output._start);
-        output(false) << "global _start\n_start:\n";
+        symbol_id start = get_interner().intern("_start");
+        _output.current->global(start);
+        _output.current->label(start);
 
-        if (!_uninitialized_static_objects.empty())
+        // The kernel starts the process with argc at [rsp], followed by argv's pointers, so argv is rsp after popping argc.
+        if (!results && !entry_point->parameters.empty())
         {
-            IF_VERBOSE(input::verbose_level::comments) output() << "; Construct static objects.\n";
-            output_stream(*_output.current, _output.uninitialized_static_construct);
+            emit(pop, rdi, {}, "argc");
+            emit(mov, rsi, rsp, "argv");
         }
 
-        IF_VERBOSE(input::verbose_level::comments) output() << "; Call entrypoint.\n";
-        output() << "push 0"; VERBOSE_COMMENT("status") << '\n';
-        output() << "mov rbp, rsp\n";
+        if (!_uninitialized_static_objects.empty())
+        {
+            emit_comment("Construct static objects.");
+            _output.current->append(std::move(_output.uninitialized_static_construct));
+        }
 
-        if (!entry_point->parameters.empty())
+        if (results)
         {
-            output() << "push rdi"; VERBOSE_COMMENT("argc") << '\n';
-            output() << "push rsi"; VERBOSE_COMMENT("argv") << '\n';
+            emit_comment("The entrypoint was run at compile time.");
+            entry_point->is_evaluated = true;
         }
+        else
+        {
+            emit_comment("Call entrypoint.");
+            emit(push, 0, {}, "status");
+            emit(mov, rbp, rsp);
+
+            if (!entry_point->parameters.empty())
+            {
+                emit(push, rdi, {}, "argc");
+                emit(push, rsi, {}, "argv");
+            }
 
-        output() << "call " << entry_point->signature << '\n';
+            emit(call, x86_operand::label(entry_point->node->signature));
+        }
 
         if (!_uninitialized_static_objects.empty())
         {
-            IF_VERBOSE(input::verbose_level::comments) output() << "; Destruct static objects.\n";
-            output_stream(*_output.current, _output.uninitialized_static_destruct);
+            emit_comment("Destruct static objects.");
+            _output.current->append(std::move(_output.uninitialized_static_destruct));
         }
 
-        IF_VERBOSE(input::verbose_level::comments) output() << "; Exit with return code [rbp].\n";
-        output() << "mov rax, 60\n";
-        output() << "mov rdi, [rbp]\n";
-        output() << "syscall\n";
+        if (results)
+        {
+            emit_comment("Exit with its return code.");
+            emit(mov, rax, 60);
+            emit(mov, rdi, results->empty() ? 0 : results->front());
+        }
+        else
+        {
+            emit_comment("Exit with return code [rbp].");
+            emit(mov, rax, 60);
+            emit(mov, rdi, x86_operand::memory(rbp));
+        }
+        emit(syscall);
 
         exchange_current_output(output_backup);
     }
 
     void generator::generate_function(function& function)
     {
-        output_stream(_output.text, function.output) << '\n';
+        // Nothing can call it or the functions nested in it.
+        if (function.is_evaluated)
+            return;
+        _output.text.append(std::move(function.output));
+        _output.text.blank();
         for (auto& nested_function : function.nested_functions)
             generate_function(nested_function);
     }
 
-    std::string generator::object::get_address() const
+    x86_operand generator::object::get_address() const
     {
-        std::string address;
         if (!is_static())
-        {
-            address = "rbp";
-            if (std::ptrdiff_t rsp_offset = std::abs(stack_offset * elem_size))
-            {
-                address += ' ';
-                address += (stack_offset > 0 ? '+' : '-');
-                address += ' ';
-                address += std::to_string(rsp_offset);
-            }
-        }
-        else
-        {
-            address = name;
-            address += '_';
-        }
-        return address;
+            return x86_operand::memory(rbp, stack_offset * elem_size);
+        return x86_operand::memory(label);
     }
 } // namespace shl
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "input.hpp"
+#include "back/assembly.hpp"
+#include "common/symbol_table.hpp"
 #include "middle/ast.hpp"
-#include <sstream>
+#include "middle/node_ref.hpp"
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace shl
@@ -15,17 +18,20 @@ namespace shl
     public:
         [[nodiscard]] explicit generator(node_program* root) : _root(root) {}
 
-        [[nodiscard]] std::string operator()();
+        [[nodiscard]] assembly operator()();
 
     private:
         struct object
         {
+            // The name in the object's declaration, which uses of it are resolved to.
+            const node_identifier* declaration;
             // The name of the object.
-            // When stack_offset is zero, this also serves as its address (with an underscore appended).
             std::string_view name;
             // The offset into the stack where this object resides.
             // If zero, this object is not on the stack.
             std::ptrdiff_t stack_offset = 0;
+            // When stack_offset is zero, the label of its address, which is its name with an underscore appended.
+            symbol_id label = symbol_id::empty;
 
             // 0 (and 1 if rbp is pushed), are invalid stack offsets for functions.
             // 0 is guaranteed to be invalid, but not 1, so 0 is instead used to
@@ -34,14 +40,42 @@ namespace shl
             [[nodiscard]] constexpr bool is_static() const noexcept { return stack_offset == 0; }
 
             // Returns the address of the object.
-            // If this object is in a function, returns "rsp+/-stack_offset".
-            // Otherwise, returns the name of this object with an appended underscore,
-            // which is a label in the data section, i.e. an address to this object.
-            [[nodiscard]] std::string get_address() const;
+            // If this object is in a function, returns [rbp +/- stack_offset].
+            // Otherwise, returns [label], a label in the data section, i.e. an address to this object.
+            [[nodiscard]] x86_operand get_address() const;
+        };
+
+        // A node being generated, and what's needed to resume it once its children are generated.
+        struct frame
+        {
+            node_ref node;
+            // The number of times the node has been resumed.
+            std::uint32_t stage = 0;
+            // The indentation level to restore once the node is generated.
+            std::uint32_t indent_level = 0;
+            // What the node is to its parent, for the comments.
+            std::string_view name;
+            // State carried between stages.
+            symbol_id label_end = symbol_id::empty;
+            symbol_id label_next = symbol_id::empty;
+            assembly* output_backup = nullptr;
+            object* object_ = nullptr;
+        };
+
+        // An object by its index in a list of objects, since the list may reallocate.
+        // The list must outlive the reference, which only holds for the current function's lists and the global ones.
+        struct object_ref
+        {
+            std::vector<object>* list;
+            std::size_t index;
+
+            [[nodiscard]] object& get() const noexcept { return (*list)[index]; }
         };
 
         struct function
         {
+            const node_named_function* node;
+            symbol_id symbol;
             std::string_view name;
             std::string signature;
             std::string namespace_;
@@ -50,45 +84,34 @@ namespace shl
             std::vector<object> objects;
             std::vector<object> static_objects;
             std::vector<function> nested_functions;
-            std::stringstream output;
+            assembly output;
+            // If it's the entry point and was run at compile time, so it's never called and isn't output.
+            bool is_evaluated = false;
+            // Every object in scope in the function, by the name in its declaration.
+            // This is only used while the function is current, and freed after.
+            std::unordered_map<const node_identifier*, object_ref> object_table;
         };
 
     private:
-        // Optionally outputs appropriate indentation for instructions to the current output stream.
-        // Returns the current output stream for convenience.
-        [[nodiscard]] std::stringstream& output(bool indent = true);
+        // Outputs the instruction to the current output, with appropriate indentation.
+        // The comment is only output if comments are wanted.
+        void emit(x86_mnemonic mnemonic, x86_operand first = {}, x86_operand second = {}, std::string_view comment = {});
+
+        // Outputs the label to the current output, with appropriate indentation.
+        // The comment is only output if comments are wanted.
+        void emit_label(symbol_id label, std::string_view comment = {});
 
-        // Optionally outputs appropriate indentation for the label to the current output stream,
-        // followed by the label itself and a colon. Returns the current output stream for convenience.
-        std::stringstream& output_label(std::string_view label);
+        // Outputs the comment to the current output, indented like instructions, if comments are wanted.
+        void emit_comment(std::string_view comment);
 
         // Sets the current output to the new output and returns a reference to the old output.
         // Pass that reference back to this function to undo after you're done outputting.
         // The return value from the second call may be completely ignored.
-        std::stringstream& exchange_current_output(std::stringstream& new_output);
-
-        // Move-appends source to destination. Returns destination for convenience.
-        static std::stringstream& output_stream(std::stringstream& destination, std::stringstream& source);
-
-        // Calls a function with the specific output stream.
-        template <typename Func>
-        void with_output(std::stringstream& output, const Func& func)
-        {
-            auto& output_backup = exchange_current_output(output);
-            func();
-            exchange_current_output(output_backup);
-        }
+        assembly& exchange_current_output(assembly& new_output);
 
     private:
-        // Selects which generation function to call next.
-        template <class Visitor>
-        void visit(Visitor* visitor, std::string_view name, const nodes& variant)
-        {
-            IF_VERBOSE(input::verbose_level::indentation) output() << "; " << name << ": ";
-            ++_output.indent_level;
-            std::visit(*visitor, variant);
-            --_output.indent_level;
-        }
+        // Generates the node and everything under it.
+        void generate(std::string_view name, node_ref root);
 
         // Allocates a new scope frame.
         void begin_scope();
@@ -98,29 +121,25 @@ namespace shl
 
     private:
         // Creates a global object in bss.
-        object& create_uninitialized(std::string_view name);
+        object& create_uninitialized(const node_identifier* n_name);
 
         // Creates a global object in data.
-        object& create_initialized(std::string_view name);
+        object& create_initialized(const node_identifier* n_name);
 
         // Creates a global constant in text.
-        object& create_constant(std::string_view name);
+        object& create_constant(const node_identifier* n_name);
 
         // Creates a local object the current function's stack frame (also in text).
-        object& create_object(std::string_view name, bool is_static);
+        object& create_object(const node_identifier* n_name, bool is_static);
 
-        [[nodiscard]] object* get_object(std::string_view name);
-        [[nodiscard]] function* get_function_from_name(std::string_view name);
-        [[nodiscard]] function* get_function_from_signature(std::string_view name);
+        // Returns the object declared with the name, if it's in scope.
+        [[nodiscard]] object* get_object(const node_identifier* declaration);
+        [[nodiscard]] function* get_function_from_name(symbol_id symbol);
         [[nodiscard]] inline function& get_current_function();
         [[nodiscard]] inline bool has_current_function() const noexcept;
 
-        // Creates a label string.
-        // As long as short_name is at most 5 characters, this never allocates due to std::string's SSBO.
-        [[nodiscard]] static std::string create_label(std::string_view short_name = "label") noexcept;
-
-        // Creates a function's signature. This likely allocates.
-        [[nodiscard]] std::string create_function_signature(const node_named_function* node);
+        // Creates a new label.
+        [[nodiscard]] static symbol_id create_label(std::string_view short_name = "label");
 
     private:
         // Generates the pre-entrypoint function if main is defined.
@@ -140,34 +159,41 @@ namespace shl
         struct
         {
             // Code segments
-            std::stringstream bss, data, text;
+            assembly bss, data, text;
             // Not code segments, just used to order assembly.
-            std::stringstream _start;
-            std::stringstream uninitialized_static_construct;
-            std::stringstream uninitialized_static_destruct;
-            std::stringstream initialized_static;
-            std::stringstream constants;
-            // Points to different existing streams.
-            std::stringstream* current = nullptr;
+            assembly _start;
+            assembly uninitialized_static_construct;
+            assembly uninitialized_static_destruct;
+            assembly initialized_static;
+            assembly constants;
+            // Points to different existing outputs.
+            assembly* current = nullptr;
             // Number of indentation levels to indent the assembly by, in sets of 4 spaces.
             std::uint32_t indent_level = 1;
         } _output;
 
         // Compilation state.
 
-        // List of nested function signatures.
-        std::vector<std::string_view> _nested_function_signatures;
+        // Stack of the functions being generated, innermost last.
+        // Only the innermost function's nested functions are ever added to, so none of these move.
+        std::vector<function*> _function_stack;
         // List of functions generated/being generated thus far.
         std::vector<function> _functions;
+        // Indices into _functions of the first function with each name.
+        symbol_table<std::size_t> _function_name_table;
         // List of uninitialized aka static objects.
         std::vector<object> _uninitialized_static_objects;
         // List of initialized static static objects.
         std::vector<object> _initialized_static_objects;
         // List of constant objects.
         std::vector<object> _constant_objects;
+        // Uninitialized and initialized static objects, by the name in their declaration.
+        std::unordered_map<const node_identifier*, object_ref> _static_object_table;
         // List of stack offsets.
         // Used to deallocate stack objects.
         std::vector<std::size_t> _scopes;
+        // Stack of nodes being generated.
+        std::vector<frame> _frames;
 
     private:
         static constexpr std::ptrdiff_t elem_size = sizeof(std::uint64_t);
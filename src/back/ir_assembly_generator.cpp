@@ -0,0 +1,278 @@
+#include "ir_assembly_generator.hpp"
+#include "input.hpp"
+#include "middle/arithmetic.hpp"
+#include <cassert>
+#include <string>
+#include <type_traits>
+
+namespace shl
+{
+    using enum x86_mnemonic;
+    using x86_register::rax, x86_register::rbx, x86_register::rdx, x86_register::edx, x86_register::rsp, x86_register::rbp, x86_register::rsi, x86_register::rdi;
+
+    namespace
+    {
+        constexpr std::size_t elem_size = sizeof(std::uint64_t);
+
+        // The unsigned conditional jump taken when lhs op rhs, indexed by the boolean ir_op.
+        constexpr x86_mnemonic jumps[]{ja, jae, jb, jbe, je, jne};
+        static_assert(std::size(jumps) == +ir_op::_range_booleans_end - +ir_op::_range_booleans_begin);
+    } // namespace
+
+    assembly ir_assembly_generator::operator()()
+    {
+        assembly bss, data;
+        bss.section(section_kind::bss);
+        bss.blank();
+        data.section(section_kind::data);
+        data.blank();
+        IF_VERBOSE(input::verbose_level::comments)
+        {
+            bss.comment("Allocate UNinitialized global/static objects.");
+            data.comment("Allocate/define initialized global/static objects.");
+        }
+
+        _offsets.resize(_code.get_object_count());
+        for (std::size_t id = 0; id < _code.get_object_count(); ++id)
+        {
+            if (_code.get_object_kind(id) != ir_object_kind::global)
+                continue;
+            if (auto value = _code.get_initial_value(id))
+                data.quad(get_address(id).symbol, *value);
+            else
+                bss.reserve(get_address(id).symbol, 1);
+        }
+
+        _text.section(section_kind::text);
+        _text.blank();
+        IF_VERBOSE(input::verbose_level::comments) _text.comment("Define provided functions.");
+        for (const ir_function& function : _code.get_functions())
+            if (&function != _code.get_start())
+                generate_function(function);
+        // Without an entry point, there's nothing to start, like in the native code.
+        if (auto start = _code.get_start())
+        {
+            IF_VERBOSE(input::verbose_level::comments) _text.comment("Define the pre-entrypoint.");
+            generate_start(*start);
+        }
+
+        // Combine everything and return the final assembly.
+        assembly output;
+        output.append(std::move(bss));
+        output.blank();
+        output.append(std::move(data));
+        output.blank();
+        output.append(std::move(_text));
+        return output;
+    }
+
+    void ir_assembly_generator::generate_function(const ir_function& function)
+    {
+        // Like the native code, the caller pushes the return values, then the parameters, then calls,
+        // so they're above the return address and the saved rbp, the last parameter first.
+        std::size_t argument_count = function.return_values.size() + function.parameters.size();
+        for (std::size_t i = 0; i < function.return_values.size(); ++i)
+            _offsets[function.return_values[i]] = static_cast<std::ptrdiff_t>(argument_count + 1 - i);
+        for (std::size_t i = 0; i < function.parameters.size(); ++i)
+            _offsets[function.parameters[i]] = static_cast<std::ptrdiff_t>(argument_count + 1 - function.return_values.size() - i);
+        set_local_offsets(function);
+
+        // Functions are global, so they're typed and sized in object files and perf maps.
+        symbol_id name = get_interner().intern(_code.get_object(function.name));
+        _text.global(name);
+        _text.label(name);
+        _text.instruction(push, rbp);
+        _text.instruction(mov, rbp, rsp);
+        if (!function.locals.empty())
+            _text.instruction(sub, rsp, function.locals.size() * elem_size);
+        for (auto& line : function.lines)
+            generate_line(line);
+        _text.blank();
+    }
+
+    void ir_assembly_generator::generate_start(const ir_function& start)
+    {
+        // The kernel starts the process with argc at [rsp], followed by argv's pointers, so argv is rsp after popping argc.
+        // _start has no caller, so its parameters are in its frame too.
+        symbol_id name = get_interner().intern("_start");
+        _text.global(name);
+        _text.label(name);
+        if (!start.parameters.empty())
+        {
+            _text.instruction(pop, rdi);
+            _text.instruction(mov, rsi, rsp);
+        }
+        _text.instruction(mov, rbp, rsp);
+        set_local_offsets(start, start.parameters.size());
+        std::size_t slot_count = start.parameters.size() + start.locals.size();
+        if (slot_count)
+            _text.instruction(sub, rsp, slot_count * elem_size);
+        if (!start.parameters.empty())
+        {
+            store(start.parameters[0], rdi);
+            store(start.parameters[1], rsi);
+        }
+        for (auto& line : start.lines)
+            generate_line(line);
+    }
+
+    void ir_assembly_generator::set_local_offsets(const ir_function& function, std::size_t first_slot)
+    {
+        for (std::size_t i = 0; i < function.locals.size(); ++i)
+            _offsets[function.locals[i]] = -static_cast<std::ptrdiff_t>(first_slot + i + 1);
+        for (std::size_t i = 0; i < first_slot; ++i)
+            _offsets[function.parameters[i]] = -static_cast<std::ptrdiff_t>(i + 1);
+    }
+
+    void ir_assembly_generator::generate_line(const ir_line& line)
+    {
+        // Labels are output as they are, so they aren't commented.
+        if (IS_VERBOSE(input::verbose_level::comments) && !std::holds_alternative<ir_label*>(line))
+            _text.comment(_code.to_string(line), 1);
+
+        std::visit([this]<typename T>(const T* line)
+        {
+            if constexpr (std::is_same_v<T, ir_assign>)
+            {
+                load(rax, line->src);
+                store(line->dst, rax);
+            }
+            else if constexpr (std::is_same_v<T, ir_assign_op>)
+            {
+                load(rax, line->lhs);
+                load(rbx, line->rhs);
+                switch (line->op)
+                {
+                case ir_op::div:
+                    _text.instruction(xor_, edx, edx);
+                    _text.instruction(div, rbx);
+                    break;
+                case ir_op::mod:
+                    _text.instruction(xor_, edx, edx);
+                    _text.instruction(div, rbx);
+                    _text.instruction(mov, rax, rdx);
+                    break;
+                case ir_op::mul:
+                    _text.instruction(mul, rbx);
+                    break;
+                case ir_op::add:
+                    _text.instruction(add, rax, rbx);
+                    break;
+                case ir_op::sub:
+                    _text.instruction(sub, rax, rbx);
+                    break;
+                default:
+                {
+                    // Moves don't change the flags, so the result is set between the compare and the jump.
+                    assert(is_boolean(line->op));
+                    symbol_id label = get_interner().intern("cmp" + std::to_string(_label_count++));
+                    _text.instruction(cmp, rax, rbx);
+                    _text.instruction(mov, rax, 1);
+                    _text.instruction(jumps[+line->op], x86_operand::label(label));
+                    _text.instruction(mov, rax, 0);
+                    _text.label(label);
+                    break;
+                }
+                }
+                store(line->dst, rax);
+            }
+            else if constexpr (std::is_same_v<T, ir_assign_indirect>)
+            {
+                load(rbx, line->src);
+                _text.instruction(mov, rax, x86_operand::memory(rbx, 0, true));
+                store(line->dst, rax);
+            }
+            else if constexpr (std::is_same_v<T, ir_indirect_assign>)
+            {
+                load(rbx, line->dst);
+                load(rax, line->src);
+                _text.instruction(mov, x86_operand::memory(rbx), rax);
+            }
+            else if constexpr (std::is_same_v<T, ir_if>)
+            {
+                assert(is_boolean(line->op));
+                load(rax, line->lhs);
+                if (line->op == ir_op::eq && _code.get_object_kind(line->rhs) == ir_object_kind::constant && _code.get_object(line->rhs) == "0")
+                    _text.instruction(test, rax, rax);
+                else
+                {
+                    load(rbx, line->rhs);
+                    _text.instruction(cmp, rax, rbx);
+                }
+                _text.instruction(jumps[+line->op], x86_operand::label(get_interner().intern(_code.get_object(line->lbl))));
+            }
+            else if constexpr (std::is_same_v<T, ir_goto>)
+                _text.instruction(jmp, x86_operand::label(get_interner().intern(_code.get_object(line->lbl))));
+            else if constexpr (std::is_same_v<T, ir_label>)
+                _text.label(get_interner().intern(_code.get_object(line->lbl)));
+            else if constexpr (std::is_same_v<T, ir_call>)
+            {
+                for (std::size_t argument : line->return_values)
+                {
+                    load(rax, argument);
+                    _text.instruction(push, rax);
+                }
+                for (std::size_t argument : line->parameters)
+                {
+                    load(rax, argument);
+                    _text.instruction(push, rax);
+                }
+                _text.instruction(call, x86_operand::label(get_interner().intern(_code.get_object(line->func))));
+                // Copy the return values back, then pop everything that was pushed.
+                std::size_t argument_count = line->return_values.size() + line->parameters.size();
+                for (std::size_t i = 0; i < line->return_values.size(); ++i)
+                {
+                    _text.instruction(mov, rax, x86_operand::memory(rsp, (argument_count - 1 - i) * elem_size, true));
+                    store(line->return_values[i], rax);
+                }
+                if (argument_count)
+                    _text.instruction(add, rsp, argument_count * elem_size);
+            }
+            else if constexpr (std::is_same_v<T, ir_return>)
+            {
+                _text.instruction(mov, rsp, rbp);
+                _text.instruction(pop, rbp);
+                _text.instruction(ret);
+            }
+            else
+            {
+                _text.instruction(mov, rax, 60);
+                load(rdi, line->status);
+                _text.instruction(syscall);
+            }
+        }, line);
+    }
+
+    void ir_assembly_generator::load(x86_register reg, std::size_t object)
+    {
+        if (_code.get_object_kind(object) == ir_object_kind::constant)
+        {
+            // Constants are named by their value, which the IR checked fits in 64 bits.
+            auto value = get_value(_code.get_object(object));
+            assert(value);
+            _text.instruction(mov, reg, *value);
+        }
+        else
+            _text.instruction(mov, reg, get_address(object).qword());
+    }
+
+    void ir_assembly_generator::store(std::size_t object, x86_register reg)
+    {
+        _text.instruction(mov, get_address(object), reg);
+    }
+
+    x86_operand ir_assembly_generator::get_address(std::size_t object) const
+    {
+        switch (_code.get_object_kind(object))
+        {
+        case ir_object_kind::local:
+        case ir_object_kind::temporary:
+            return x86_operand::memory(rbp, _offsets[object] * static_cast<std::ptrdiff_t>(elem_size));
+        case ir_object_kind::global:
+            return x86_operand::memory(get_interner().intern(std::string(_code.get_object(object)) + '_'));
+        default:
+            assert(false && "constants, labels and functions have no address.");
+            return {};
+        }
+    }
+} // namespace shl
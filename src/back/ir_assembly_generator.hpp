@@ -0,0 +1,58 @@
+#pragma once
+
+#include "back/assembly.hpp"
+#include "back/ir_code.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace shl
+{
+    // Generates assembly from three-address code, with the same instructions the generator emits.
+    // Each line loads its operands into rax and rbx, and stores its result from rax.
+    // Each function has a stack frame, like the native code's, with a slot for each of its local objects and temporaries,
+    // below its return values and parameters. Global objects are in data or bss.
+    class ir_assembly_generator
+    {
+    public:
+        [[nodiscard]] explicit ir_assembly_generator(const ir_code& code) noexcept : _code(code) {}
+
+        ir_assembly_generator(const ir_assembly_generator&) = delete;
+        ir_assembly_generator(ir_assembly_generator&&) = delete;
+        ir_assembly_generator& operator=(const ir_assembly_generator&) = delete;
+        ir_assembly_generator& operator=(ir_assembly_generator&&) = delete;
+
+        [[nodiscard]] assembly operator()();
+
+    private:
+        // Generates the function, with its own stack frame.
+        void generate_function(const ir_function& function);
+
+        // Generates _start, which takes argc and argv from the kernel instead of a caller, and exits instead of returning.
+        void generate_start(const ir_function& start);
+
+        // Gives the function's local objects and temporaries their slots in its stack frame,
+        // after the given number of slots for its first parameters.
+        void set_local_offsets(const ir_function& function, std::size_t first_slot = 0);
+
+        // Generates the instructions for the line.
+        void generate_line(const ir_line& line);
+
+        // Loads the object's value into the register.
+        void load(x86_register reg, std::size_t object);
+
+        // Stores the register's value into the object, which must not be a constant or label.
+        void store(std::size_t object, x86_register reg);
+
+        // Returns the address of the object, which must be a local object, temporary or global object.
+        [[nodiscard]] x86_operand get_address(std::size_t object) const;
+
+    private:
+        const ir_code& _code;
+        assembly _text;
+        // The offset of each object in the current function's stack frame from rbp, in slots.
+        std::vector<std::ptrdiff_t> _offsets;
+        // The number of labels generated for comparisons.
+        std::size_t _label_count = 0;
+    };
+} // namespace shl
@@ -1,27 +1,29 @@
 #include "ir_code.hpp"
+#include <algorithm>
+#include <type_traits>
 
 namespace shl
 {
-    std::size_t ir_code::append_line(ir_line&& line)
+    std::span<const std::size_t> ir_code::allocate_objects(std::span<const std::size_t> objects)
     {
-        std::size_t index = _lines.size();
-        _lines.push_back(std::move(line));
-        return index;
+        if (objects.empty())
+            return {};
+        auto copy = static_cast<std::size_t*>(_allocator->allocate_bytes(objects.size_bytes(), alignof(std::size_t)));
+        std::ranges::copy(objects, copy);
+        return std::span(copy, objects.size());
     }
 
-    void ir_code::insert_line(std::size_t index, ir_line&& line)
+    std::size_t ir_code::add_function(std::size_t name)
     {
-        _lines.insert(_lines.begin() + index, std::move(line));
+        _functions.push_back({name, std::pmr::vector<std::size_t>(_allocator.get()), std::pmr::vector<std::size_t>(_allocator.get()),
+            std::pmr::vector<std::size_t>(_allocator.get()), std::pmr::vector<ir_line>(_allocator.get())});
+        return _functions.size() - 1;
     }
 
-    void ir_code::remove_line(std::size_t index)
-    {
-        _lines.erase(_lines.begin() + index);
-    }
-
-    std::size_t ir_code::add_object(std::string_view object)
+    std::size_t ir_code::add_object(std::string_view object, ir_object_kind kind)
     {
         std::size_t id = _objects.size();
+        std::size_t begin = _storage.size();
 
         if (object.empty())
         {
@@ -31,13 +33,136 @@ namespace shl
         else
             _storage += object;
 
-        _objects.emplace_back(_storage.size() - object.size(), _storage.size());
+        _objects.push_back({begin, _storage.size(), kind});
         return id;
     }
 
-    std::string_view ir_code::get_object(std::size_t id)
+    std::string_view ir_code::get_object(std::size_t id) const
     {
         auto& object = _objects.at(id);
         return std::string_view(_storage.begin() + object.begin, _storage.begin() + object.end);
     }
+
+    ir_object_kind ir_code::get_object_kind(std::size_t id) const
+    {
+        return _objects.at(id).kind;
+    }
+
+    void ir_code::set_initial_value(std::size_t id, std::uint64_t value)
+    {
+        auto& object = _objects.at(id);
+        object.has_initial_value = true;
+        object.initial_value = value;
+    }
+
+    std::optional<std::uint64_t> ir_code::get_initial_value(std::size_t id) const
+    {
+        auto& object = _objects.at(id);
+        return object.has_initial_value ? std::optional(object.initial_value) : std::nullopt;
+    }
+
+    std::string ir_code::to_string(const ir_line& line) const
+    {
+        static constexpr std::string_view op_names[]{">", ">=", "<", "<=", "==", "!=", "/", "%", "*", "+", "-"};
+        static_assert(std::size(op_names) == +ir_op::_count);
+
+        std::string text;
+        auto append = [this, &text](auto... parts)
+        {
+            ([this, &text](auto part)
+            {
+                if constexpr (std::is_same_v<decltype(part), std::size_t>)
+                    text += get_object(part);
+                else if constexpr (std::is_same_v<decltype(part), ir_op>)
+                    text += op_names[+part];
+                else
+                    text += part;
+            }(parts), ...);
+        };
+
+        std::visit([this, &text, &append]<typename T>(const T* line)
+        {
+            if constexpr (std::is_same_v<T, ir_assign>)
+                append(line->dst, " = ", line->src);
+            else if constexpr (std::is_same_v<T, ir_assign_op>)
+                append(line->dst, " = ", line->lhs, " ", line->op, " ", line->rhs);
+            else if constexpr (std::is_same_v<T, ir_assign_indirect>)
+                append(line->dst, " = [", line->src, "]");
+            else if constexpr (std::is_same_v<T, ir_indirect_assign>)
+                append("[", line->dst, "] = ", line->src);
+            else if constexpr (std::is_same_v<T, ir_if>)
+                append("if ", line->lhs, " ", line->op, " ", line->rhs, " goto ", line->lbl);
+            else if constexpr (std::is_same_v<T, ir_goto>)
+                append("goto ", line->lbl);
+            else if constexpr (std::is_same_v<T, ir_label>)
+                append(line->lbl, ":");
+            else if constexpr (std::is_same_v<T, ir_call>)
+            {
+                append("call ");
+                append_signature(text, line->func, line->return_values, line->parameters);
+            }
+            else if constexpr (std::is_same_v<T, ir_return>)
+                append("return");
+            else
+                append("exit ", line->status);
+        }, line);
+        return text;
+    }
+
+    void ir_code::append_signature(std::string& text, std::size_t function, std::span<const std::size_t> return_values, std::span<const std::size_t> parameters) const
+    {
+        auto append_objects = [this, &text](std::span<const std::size_t> objects)
+        {
+            for (std::size_t i = 0; i < objects.size(); ++i)
+            {
+                if (i)
+                    text += ", ";
+                text += get_object(objects[i]);
+            }
+        };
+
+        text += get_object(function);
+        text += '(';
+        append_objects(return_values);
+        text += parameters.empty() ? ";" : "; ";
+        append_objects(parameters);
+        text += ')';
+    }
+
+    std::string ir_code::to_string() const
+    {
+        std::string text;
+        for (std::size_t id = 0; id < _objects.size(); ++id)
+        {
+            if (get_object_kind(id) != ir_object_kind::global)
+                continue;
+            text += "global ";
+            text += get_object(id);
+            if (auto value = get_initial_value(id))
+            {
+                text += " = ";
+                text += std::to_string(*value);
+            }
+            text += '\n';
+        }
+
+        // Each function starts with its name and objects, like its signature: name(r1, ..., rN; a1, ..., aN).
+        for (const ir_function& function : _functions)
+        {
+            if (!text.empty())
+                text += '\n';
+            append_signature(text, function.name, function.return_values, function.parameters);
+            text += ":\n";
+
+            for (auto& line : function.lines)
+            {
+                // Labels are outdented, like in assembly.
+                if (!std::holds_alternative<ir_label*>(line))
+                    text += "    ";
+                text += to_string(line);
+                text += '\n';
+            }
+        }
+        return text;
+    }
 } // namespace shl
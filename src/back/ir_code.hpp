@@ -1,46 +1,108 @@
 #pragma once
 
 #include "common/arena_allocator.hpp"
+#include "common/ranged_enum.hpp"
 #include "common/util.hpp"
 #include "back/ir_line.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
 namespace shl
 {
+    // What an object in the code is.
+    DEFINE_RANGED_ENUM(ir_object_kind,
+        (
+            local,     // An object in a function, including its return values and parameters.
+            temporary, // An intermediate value, named __T#.
+            global,    // A global object.
+            constant,  // An integer, named by its value.
+            label,     // A place in the code to go to, named L#.
+            function   // A function to call, named like the native code's label for it.
+        ),
+        // Ranges
+        ()
+    );
+
+    // A function's objects and lines.
+    // _start is one too, whose parameters are the program's argc and argv, and which exits instead of returning.
+    struct ir_function
+    {
+        // The function object naming it.
+        std::size_t name;
+        std::pmr::vector<std::size_t> return_values;
+        std::pmr::vector<std::size_t> parameters;
+        // Every other object in the function, i.e. its local objects and temporaries.
+        std::pmr::vector<std::size_t> locals;
+        // Each line, in sequential order.
+        std::pmr::vector<ir_line> lines;
+    };
+
     class ir_code
     {
     public:
         template <typename T, typename... Args> requires(is_any_of_v<T*, IR_TYPES>)
         T* allocate_line(Args&&... args)
-        { return _allocator.allocate<T>(std::forward<Args>(args)...); }
+        { return _allocator->allocate<T>(std::forward<Args>(args)...); }
+
+        // Copies the objects, for lines that refer to a list of them.
+        [[nodiscard]] std::span<const std::size_t> allocate_objects(std::span<const std::size_t> objects);
+
+        // Adds an empty function, named after the function object, and returns its index.
+        std::size_t add_function(std::size_t name);
+        [[nodiscard]] ir_function& get_function(std::size_t index) { return _functions.at(index); }
+        [[nodiscard]] std::span<const ir_function> get_functions() const noexcept { return _functions; }
 
-        std::size_t append_line(ir_line&& line);
-        void insert_line(std::size_t index, ir_line&& line);
-        void remove_line(std::size_t index);
+        // _start is one of the functions, if there's an entry point to start.
+        void set_start(std::size_t index) noexcept { _start = index; }
+        [[nodiscard]] const ir_function* get_start() const noexcept { return _start ? &_functions[*_start] : nullptr; }
 
-        std::size_t add_object(std::string_view object);
-        std::string_view get_object(std::size_t id);
+        // Temporaries are named after their id, so their name should be empty.
+        std::size_t add_object(std::string_view object, ir_object_kind kind = ir_object_kind::local);
+        [[nodiscard]] std::string_view get_object(std::size_t id) const;
+        [[nodiscard]] ir_object_kind get_object_kind(std::size_t id) const;
+        [[nodiscard]] std::size_t get_object_count() const noexcept { return _objects.size(); }
+
+        // Global objects with an initial value start with it, and the rest are initialized by the code.
+        void set_initial_value(std::size_t id, std::uint64_t value);
+        [[nodiscard]] std::optional<std::uint64_t> get_initial_value(std::size_t id) const;
+
+        // Returns the line as text, e.g. "a = b + c".
+        [[nodiscard]] std::string to_string(const ir_line& line) const;
+        // Returns the whole code as text: the global objects, then each function's objects and lines.
+        [[nodiscard]] std::string to_string() const;
+
+    private:
+        // Appends the function and its objects, like its signature: name(r1, ..., rN; a1, ..., aN).
+        void append_signature(std::string& text, std::size_t function, std::span<const std::size_t> return_values, std::span<const std::size_t> parameters) const;
 
     private:
-        // Each IR code line, in sequential order.
-        std::vector<ir_line> _lines;
+        // Allocator for ir_line's, and for the containers below.
+        // Declared first, so it outlives them. It's on the heap, so the code can be moved.
+        std::unique_ptr<arena_allocator> _allocator = std::make_unique<arena_allocator>(1024 * 1024); // 1 MiB first block.
+
+        // Each function, in the order they were added.
+        std::pmr::vector<ir_function> _functions{_allocator.get()};
+        std::optional<std::size_t> _start;
 
         // Contiguous storage for variable names, constant values, labels, temp vars/labels, etc.
-        std::string _storage;
+        std::pmr::string _storage{_allocator.get()};
 
         // Two indices into _storage instead of a std::string_view (whose pointer would be invalidated).
         struct object
         {
             std::size_t begin;
             std::size_t end;
+            ir_object_kind kind;
+            bool has_initial_value = false;
+            std::uint64_t initial_value = 0;
         };
 
         // List of what objects are in the above storage.
         // This is what the ir_line's index into.
-        std::vector<object> _objects;
-
-        // Allocator for ir_line's.
-        arena_allocator _allocator{1024 * 1024}; // 1 MiB blocks.
+        std::pmr::vector<object> _objects{_allocator.get()};
     };
 } // namespace shl
@@ -1,9 +1,450 @@
 #include "ir_code_generator.hpp"
+#include "input.hpp"
+#include "common/error.hpp"
+#include "middle/arithmetic.hpp"
+#include <cassert>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
 
 namespace shl
 {
+    // Lowers as much of each node as it can without its children.
+    // Every expression leaves the object holding its value on the generator's results for whatever it's in to use.
+    struct ir_visitor : node_walker<ir_visitor, ir_code_generator::frame>
+    {
+        ir_code_generator& g; // context
+
+        [[nodiscard]] explicit ir_visitor(ir_code_generator& g) noexcept : node_walker(g._frames), g(g) {}
+
+        bool visit(node_handle node) { return g._ast.visit(*this, node); }
+
+        bool operator()(const flat::program& node)
+        {
+            assert(false && "programs are lowered by the generator.");
+            return true;
+        }
+
+        bool operator()(const flat::declaration& node) { return replace(node.n_value); }
+        bool operator()(const flat::definition& node) { return replace(node.n_value); }
+
+        bool operator()(const flat::declare_object& node)
+        {
+            g._objects[+node.n_name] = g.add_local_object(get_interner().get(get_symbol(node.n_name)));
+            return true;
+        }
+
+        bool operator()(const flat::define_object& node)
+        {
+            auto& f = frame();
+            if (f.stage++ == 0)
+            {
+                // The object is in scope in its own initializer, like in the native code.
+                f.object = g.add_local_object(get_interner().get(get_symbol(node.n_name)));
+                f.temporary_count = g.get_context().temporary_count;
+                g._objects[+node.n_name] = f.object;
+                return push(node.n_expression);
+            }
+            g.assign(f.object, pop_result());
+            g.free_temporaries(f.temporary_count);
+            return true;
+        }
+
+        bool operator()(const flat::function& node)
+        {
+            assert(false && "unnamed function unimplemented.");
+            return true;
+        }
+
+        bool operator()(const flat::named_function& node)
+        {
+            if (frame().stage++ == 0)
+            {
+                g.begin_function(node);
+                return push(g._ast.get<flat::function>(node.n_function).n_statement);
+            }
+            // Like the native code, the end of a function returns.
+            auto& lines = g.get_function().lines;
+            if (lines.empty() || !std::holds_alternative<ir_return*>(lines.back()))
+                g.emit<ir_return>();
+            g.end_function();
+            return true;
+        }
+
+        bool operator()(const flat::parameter& node)
+        {
+            assert(false && "parameters are lowered with their function.");
+            return true;
+        }
+
+        bool operator()(const flat::scope& node)
+        {
+            std::uint32_t i = frame().stage++;
+            if (i < node.scoped_statements.count)
+                return push(g._ast.get_children(node.scoped_statements)[i]);
+            return true;
+        }
+
+        bool operator()(const flat::statement& node) { return replace(node.n_value); }
+        bool operator()(const flat::scoped_statement& node) { return replace(node.n_value); }
+        bool operator()(const flat::expression& node) { return replace(node.n_value); }
+        bool operator()(const flat::term& node) { return replace(node.n_value); }
+
+        bool operator()(const flat::if_& node)
+        {
+            auto& f = frame();
+            switch (f.stage++)
+            {
+            case 0:
+                f.temporary_count = g.get_context().temporary_count;
+                return push(node.n_expression);
+            case 1:
+                f.label_end = g.add_label();
+                g.emit<ir_if>(pop_result(), g.get_constant(0), ir_op::eq, f.label_end);
+                g.free_temporaries(f.temporary_count);
+                return push(node.n_statement);
+            default:
+                g.emit<ir_label>(f.label_end);
+                return true;
+            }
+        }
+
+        bool operator()(const flat::reassign& node)
+        {
+            auto& f = frame();
+            if (f.stage++ == 0)
+            {
+                f.temporary_count = g.get_context().temporary_count;
+                return push(node.n_expression);
+            }
+            g.assign(g.get_object(g._ast.get<flat::identifier>(node.n_identifier)), pop_result());
+            g.free_temporaries(f.temporary_count);
+            return true;
+        }
+
+        bool operator()(const flat::scoped_if& node)
+        {
+            // Each if takes two stages: one before its expression, and one before its statement.
+            auto ifs = g._ast.get_children(node.ifs);
+            auto& f = frame();
+            std::uint32_t stage = f.stage++;
+            std::size_t i = stage / 2;
+            if (stage == 0)
+            {
+                f.temporary_count = g.get_context().temporary_count;
+                f.label_end = g.add_label();
+            }
+            else if (stage % 2 == 0) // The previous if's statement is done.
+            {
+                bool has_next = g._ast.get<flat::if_>(ifs[i - 1]).n_expression != node_handle::none;
+                if (i < ifs.size())
+                    g.emit<ir_goto>(f.label_end);
+                if (has_next)
+                    g.emit<ir_label>(f.label_next);
+                if (i == ifs.size())
+                {
+                    g.emit<ir_label>(f.label_end);
+                    return true;
+                }
+            }
+
+            auto& n_if = g._ast.get<flat::if_>(ifs[i]);
+            if (n_if.n_expression != node_handle::none) // Only else blocks won't enter here.
+            {
+                if (stage % 2 == 0)
+                    return push(n_if.n_expression);
+                f.label_next = g.add_label();
+                g.emit<ir_if>(pop_result(), g.get_constant(0), ir_op::eq, f.label_next);
+                g.free_temporaries(f.temporary_count);
+            }
+            else
+                ++f.stage; // There's no expression to wait for.
+            return push(n_if.n_statement);
+        }
+
+        bool operator()(const flat::binary_expression& node)
+        {
+            auto& f = frame();
+            switch (f.stage++)
+            {
+            case 0:
+                f.temporary_count = g.get_context().temporary_count;
+                return push(node.n_expression_lhs);
+            case 1:
+                return push(node.n_expression_rhs);
+            }
+            std::size_t rhs = pop_result();
+            std::size_t lhs = pop_result();
+            // The operands' temporaries are read before the result is written, so the result can reuse them.
+            g.free_temporaries(f.temporary_count);
+            std::size_t result = g.allocate_temporary();
+            g.emit<ir_assign_op>(result, lhs, rhs, get_op(node.n_binary_operator));
+            g._results.push_back(result);
+            return true;
+        }
+
+        bool operator()(const flat::binary_operator& node) { return true; }
+        bool operator()(const flat::parameter_pass& node) { return true; }
+
+        bool operator()(const flat::integer_literal& node)
+        {
+            auto value = get_value(g._ast.get_string(node.value));
+            if (!value)
+                error_exit("IR", "Integer literal doesn't fit in 64 bits");
+            g._results.push_back(g.get_constant(*value));
+            return true;
+        }
+
+        bool operator()(const flat::identifier& node)
+        {
+            g._results.push_back(g.get_object(node));
+            return true;
+        }
+
+        // Nodes without fields, i.e. empty statements, returns, operators and parameter passes.
+        bool operator()(node_kind kind)
+        {
+            if (kind == node_kind::return_)
+                g.emit<ir_return>();
+            return true;
+        }
+
+    private:
+        [[nodiscard]] ir_op get_op(node_handle n_binary_operator) const noexcept
+        {
+            switch (g._ast.get_kind(g._ast.get<flat::binary_operator>(n_binary_operator).n_value))
+            {
+            case node_kind::forward_slash:
+                return ir_op::div;
+            case node_kind::percent:
+                return ir_op::mod;
+            case node_kind::asterisk:
+                return ir_op::mul;
+            case node_kind::plus:
+                return ir_op::add;
+            default:
+                return ir_op::sub;
+            }
+        }
+
+        [[nodiscard]] symbol_id get_symbol(node_handle n_identifier) const noexcept
+        {
+            return g._ast.get<flat::identifier>(n_identifier).symbol;
+        }
+
+        [[nodiscard]] std::size_t pop_result()
+        {
+            std::size_t result = g._results.back();
+            g._results.pop_back();
+            return result;
+        }
+    };
+
     ir_code ir_code_generator::operator()()
     {
-        return {};
+        auto entry_point_symbol = get_interner().find(get_input().entry_point);
+        std::optional<std::size_t> entry_point;
+        auto get_symbol = [this](node_handle n_identifier) { return _ast.get<flat::identifier>(n_identifier).symbol; };
+        // Global objects which are initialized by _start, and their initializers, in source order.
+        std::vector<std::pair<std::size_t, node_handle>> initializers;
+        _objects.resize(_ast.size());
+
+        for (node_handle n_declaration : _ast.get_children(_ast.get<flat::program>(_ast.get_root()).declarations))
+        {
+            node_handle n_value = _ast.get<flat::declaration>(n_declaration).n_value;
+            if (_ast.get_kind(n_value) == node_kind::definition)
+            {
+                node_handle n_definition = _ast.get<flat::definition>(n_value).n_value;
+                if (_ast.get_kind(n_definition) == node_kind::define_object)
+                {
+                    auto& n_define_object = _ast.get<flat::define_object>(n_definition);
+                    auto name = get_interner().get(get_symbol(n_define_object.n_name));
+                    ++_global_name_counts[name];
+                    std::size_t object = _code.add_object(name, ir_object_kind::global);
+                    _objects[+n_define_object.n_name] = object;
+                    // Constant folding left a constant initializer as a literal.
+                    node_handle n_term = _ast.get<flat::expression>(n_define_object.n_expression).n_value;
+                    node_handle n_literal = _ast.get_kind(n_term) == node_kind::term ? _ast.get<flat::term>(n_term).n_value : node_handle::none;
+                    if (auto value = _ast.get_kind(n_literal) == node_kind::integer_literal
+                        ? get_value(_ast.get_string(_ast.get<flat::integer_literal>(n_literal).value)) : std::nullopt)
+                        _code.set_initial_value(object, *value);
+                    else
+                        initializers.emplace_back(object, n_define_object.n_expression);
+                }
+                else
+                {
+                    // The entry point is the first top-level function with its name.
+                    std::size_t function = _code.get_functions().size();
+                    generate(n_definition);
+                    if (entry_point_symbol && get_symbol(_ast.get<flat::named_function>(n_definition).n_name) == *entry_point_symbol && !entry_point)
+                        entry_point = function;
+                }
+            }
+            else
+            {
+                node_handle n_name = _ast.get<flat::declare_object>(n_value).n_name;
+                auto name = get_interner().get(get_symbol(n_name));
+                ++_global_name_counts[name];
+                _objects[+n_name] = _code.add_object(name, ir_object_kind::global);
+            }
+        }
+
+        // Without an entry point, there's nothing to start, like in the native code.
+        if (!entry_point)
+            return std::move(_code);
+
+        // Semantic analysis checked the entry point is well-formed.
+        std::size_t entry_point_name = _code.get_function(*entry_point).name;
+        std::size_t return_value_count = _code.get_function(*entry_point).return_values.size();
+        std::size_t parameter_count = _code.get_function(*entry_point).parameters.size();
+        assert(return_value_count <= 1);
+        assert(parameter_count == 2 || parameter_count == 0);
+
+        begin_function("_start");
+        _code.set_start(get_context().function);
+        // _start's parameters are the program's argc and argv, which the entry point is called with.
+        if (parameter_count)
+        {
+            std::size_t argc = add_named_object("argc");
+            std::size_t argv = add_named_object("argv");
+            get_function().parameters.assign({argc, argv});
+        }
+
+        // Initializers can only use global objects defined before them, so those are always initialized first.
+        for (auto [object, n_expression] : initializers)
+        {
+            generate(n_expression);
+            assign(object, _results.back());
+            _results.pop_back();
+            free_temporaries(0);
+        }
+
+        // Like the native code's, the return value starts as 0, and _start exits with it.
+        std::size_t status = get_constant(0);
+        if (return_value_count)
+        {
+            status = add_local_object("status");
+            emit<ir_assign>(status, get_constant(0));
+        }
+        auto& parameters = get_function().parameters;
+        emit<ir_call>(entry_point_name, _code.allocate_objects(std::span(&status, return_value_count)), _code.allocate_objects(parameters));
+        emit<ir_exit>(status);
+        end_function();
+        return std::move(_code);
+    }
+
+    void ir_code_generator::generate(node_handle root)
+    {
+        ir_visitor(*this).walk(root);
+    }
+
+    void ir_code_generator::begin_function(std::string&& label)
+    {
+        std::size_t function = _code.add_function(_code.add_object(label, ir_object_kind::function));
+        _contexts.emplace_back(function, std::move(label));
+    }
+
+    void ir_code_generator::begin_function(const flat::named_function& node)
+    {
+        // Nested functions are namespaced by the functions they're in, with .. in place of ::.
+        std::string label;
+        if (!_contexts.empty())
+        {
+            label = get_context().label;
+            label += "..";
+        }
+        label += _ast.get_string(node.signature);
+        begin_function(std::move(label));
+
+        auto& n_function = _ast.get<flat::function>(node.n_function);
+        auto return_values = _ast.get_children(n_function.return_values);
+        auto parameters = _ast.get_children(n_function.parameters);
+        auto add_object = [this](node_handle n_declare_object)
+        {
+            node_handle n_name = _ast.get<flat::declare_object>(n_declare_object).n_name;
+            return _objects[+n_name] = add_named_object(get_interner().get(_ast.get<flat::identifier>(n_name).symbol));
+        };
+        auto& function = get_function();
+        for (node_handle n_return_value : return_values)
+            function.return_values.push_back(add_object(n_return_value));
+        for (node_handle n_parameter : parameters)
+            function.parameters.push_back(add_object(_ast.get<flat::parameter>(n_parameter).n_declare_object));
+    }
+
+    void ir_code_generator::end_function()
+    {
+        _contexts.pop_back();
+    }
+
+    void ir_code_generator::assign(std::size_t object, std::size_t value)
+    {
+        // Only binary expressions compute into temporaries, and their line is always the last one lowered.
+        if (_code.get_object_kind(value) == ir_object_kind::temporary)
+        {
+            auto line = std::get<ir_assign_op*>(get_function().lines.back());
+            assert(line->dst == value);
+            line->dst = object;
+        }
+        else
+            emit<ir_assign>(object, value);
+    }
+
+    void ir_code_generator::free_temporaries(std::size_t temporary_count) noexcept
+    {
+        assert(temporary_count <= get_context().temporary_count);
+        get_context().temporary_count = temporary_count;
+    }
+
+    std::size_t ir_code_generator::allocate_temporary()
+    {
+        auto& context = get_context();
+        if (context.temporary_count == context.temporaries.size())
+        {
+            std::size_t temporary = _code.add_object("", ir_object_kind::temporary);
+            context.temporaries.push_back(temporary);
+            get_function().locals.push_back(temporary);
+        }
+        return context.temporaries[context.temporary_count++];
+    }
+
+    std::size_t ir_code_generator::add_named_object(std::string_view name)
+    {
+        std::string unique_name(name);
+        std::uint32_t count = get_context().name_counts[name]++;
+        if (auto global_count = _global_name_counts.find(name); global_count != _global_name_counts.end())
+            count += global_count->second;
+        if (count)
+        {
+            unique_name += '.';
+            unique_name += std::to_string(count);
+        }
+        return _code.add_object(unique_name, ir_object_kind::local);
+    }
+
+    std::size_t ir_code_generator::add_local_object(std::string_view name)
+    {
+        std::size_t object = add_named_object(name);
+        get_function().locals.push_back(object);
+        return object;
+    }
+
+    std::size_t ir_code_generator::get_constant(std::uint64_t value)
+    {
+        auto [it, inserted] = _constants.try_emplace(value);
+        if (inserted)
+            it->second = _code.add_object(std::to_string(value), ir_object_kind::constant);
+        return it->second;
+    }
+
+    std::size_t ir_code_generator::add_label()
+    {
+        return _code.add_object("L" + std::to_string(_label_count++), ir_object_kind::label);
+    }
+
+    std::size_t ir_code_generator::get_object(const flat::identifier& node) const noexcept
+    {
+        assert(node.declaration != node_handle::none && "semantic analysis missed an undefined object.");
+        return _objects[+node.declaration];
     }
 } // namespace shl
@@ -1,17 +1,129 @@
 #pragma once
 
-#include "middle/ast.hpp"
+#include "middle/flat_ast.hpp"
 #include "back/ir_code.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace shl
 {
+    struct ir_visitor; // implementation
+
+    // Lowers a program, flattened after constant folding, to three-address code.
+    // Every named function, including nested ones, is lowered to a function of its own, named like the native code's.
+    // If there's an entry point, _start is lowered last: global objects whose initializers were folded to constants
+    // start with their values, the rest are initialized in source order, and then it calls the entry point and exits.
+    // Temporaries are reused once the expression they're in is done,
+    // and an expression's last operation writes straight to the object it's assigned to.
     class ir_code_generator
     {
     public:
-        [[nodiscard]] explicit ir_code_generator(node_program* ast) : _ast(ast) {}
+        [[nodiscard]] explicit ir_code_generator(const flat_ast& ast) noexcept : _ast(ast) {}
+
+        ir_code_generator(const ir_code_generator&) = delete;
+        ir_code_generator(ir_code_generator&&) = delete;
+        ir_code_generator& operator=(const ir_code_generator&) = delete;
+        ir_code_generator& operator=(ir_code_generator&&) = delete;
 
         [[nodiscard]] ir_code operator()();
+
+    private:
+        // A node being lowered, and what's needed to resume it once its children are lowered.
+        struct frame
+        {
+            node_handle node;
+            // The number of times the node has been resumed.
+            std::uint32_t stage = 0;
+            // The number of temporaries in use when the node began, to free any it used after.
+            std::size_t temporary_count = 0;
+            // The object being assigned to.
+            std::size_t object = 0;
+            // The label after the node, and the label after the current if of a scoped if.
+            std::size_t label_end = 0;
+            std::size_t label_next = 0;
+        };
+
+        // A function being lowered. Nested functions are lowered on top of the function they're in.
+        struct function_context
+        {
+            // The function's index in the code.
+            std::size_t function;
+            // Its label, which the labels of the functions nested in it start with.
+            std::string label;
+            // Every temporary, and the number of them in use.
+            std::vector<std::size_t> temporaries;
+            std::size_t temporary_count = 0;
+            // The number of its objects with each name so far.
+            std::unordered_map<std::string_view, std::uint32_t> name_counts;
+        };
+
+    private:
+        // Lowers the node and everything under it.
+        void generate(node_handle root);
+
+        // Adds a function with the label, and lowers into it until it's ended.
+        void begin_function(std::string&& label);
+
+        // Adds a function for the named function, with its return values and parameters, and lowers into it.
+        void begin_function(const flat::named_function& node);
+
+        // Goes back to lowering into the function the current one is in, if any.
+        void end_function();
+
+        [[nodiscard]] function_context& get_context() noexcept { return _contexts.back(); }
+        [[nodiscard]] ir_function& get_function() { return _code.get_function(get_context().function); }
+
+        template <typename T, typename... Args>
+        void emit(Args&&... args) { get_function().lines.push_back(_code.allocate_line<T>(std::forward<Args>(args)...)); }
+
+        // Assigns the value to the object. If the value was just computed into a temporary,
+        // the line that computed it writes to the object instead.
+        void assign(std::size_t object, std::size_t value);
+
+        // Frees the temporaries allocated since the count was taken.
+        void free_temporaries(std::size_t temporary_count) noexcept;
+
+        // Returns a temporary not in use, which is freed when the frame that allocated it is done.
+        [[nodiscard]] std::size_t allocate_temporary();
+
+        // Returns a new local object, named after the object, with a suffix if the name's taken
+        // in the current function or by a global object, so every object in scope has a name of its own.
+        [[nodiscard]] std::size_t add_named_object(std::string_view name);
+
+        // Returns a new local object, like add_named_object, in the current function's locals.
+        [[nodiscard]] std::size_t add_local_object(std::string_view name);
+
+        // Returns the object naming the constant, shared by every use of it.
+        [[nodiscard]] std::size_t get_constant(std::uint64_t value);
+
+        // Returns a new label.
+        [[nodiscard]] std::size_t add_label();
+
+        // Returns the object the identifier uses.
+        [[nodiscard]] std::size_t get_object(const flat::identifier& node) const noexcept;
+
+        friend struct ir_visitor;
+
     private:
-        node_program* _ast;
+        const flat_ast& _ast;
+        ir_code _code;
+
+        // The object naming each constant.
+        std::unordered_map<std::uint64_t, std::size_t> _constants;
+        // The number of global objects with each name so far.
+        std::unordered_map<std::string_view, std::uint32_t> _global_name_counts;
+        std::size_t _label_count = 0;
+        // The object each name in a declaration declares, by its handle, once it's declared.
+        std::vector<std::size_t> _objects;
+
+        // The function being lowered, on top of each function it's nested in.
+        std::vector<function_context> _contexts;
+        // The objects of the expressions lowered so far and not yet used.
+        std::vector<std::size_t> _results;
+        std::vector<frame> _frames;
     };
 } // namespace shl
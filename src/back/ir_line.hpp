@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common/ranged_enum.hpp"
+#include <cstddef>
+#include <span>
 #include <string_view>
 #include <variant>
 #include <vector>
@@ -43,7 +45,9 @@ namespace shl
     struct ir_if;              // if a op b goto L# // where op in ir_op::boolean
     struct ir_goto;            // goto L#
     struct ir_label;           // L#:
-    // struct ir_call;            // func(r1, ..., rN; a1, ..., aN)
+    struct ir_call;            // call func(r1, ..., rN; a1, ..., aN)
+    struct ir_return;          // return
+    struct ir_exit;            // exit a
 
 
     // All line types.
@@ -54,7 +58,10 @@ namespace shl
         ir_indirect_assign*, \
         ir_if*, \
         ir_goto*, \
-        ir_label*
+        ir_label*, \
+        ir_call*, \
+        ir_return*, \
+        ir_exit*
 
     // Variant of all line types.
     using ir_line = std::variant<IR_TYPES>;
@@ -93,6 +100,7 @@ namespace shl
         std::size_t lhs;
         std::size_t rhs;
         ir_op op;
+        std::size_t lbl;
     };
 
     struct ir_goto
@@ -104,4 +112,23 @@ namespace shl
     {
         std::size_t lbl;
     };
+
+    // Like the native code, the function reads and writes the return values and parameters in place,
+    // so the return values are copied back once it returns.
+    struct ir_call
+    {
+        std::size_t func;
+        std::span<const std::size_t> return_values;
+        std::span<const std::size_t> parameters;
+    };
+
+    struct ir_return
+    {
+    };
+
+    // Exits the process with the object's value as its status.
+    struct ir_exit
+    {
+        std::size_t status;
+    };
 } // namespace shl
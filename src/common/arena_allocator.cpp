@@ -0,0 +1,116 @@
+#include "arena_allocator.hpp"
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace shl
+{
+    // Blocks at least this big are aligned to it, so they can be backed by huge pages.
+    static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+    [[nodiscard]] static std::size_t round_up(std::size_t size, std::size_t alignment) noexcept
+    {
+        return (size + (alignment - 1)) & ~(alignment - 1);
+    }
+
+    arena_allocator::arena_allocator(std::size_t block_size)
+        : _block_size(block_size)
+    {
+        next_block();
+    }
+
+    arena_allocator::~arena_allocator() noexcept
+    {
+        // Destruct all the objects that need it, newest first.
+        for (auto it = _objects.rbegin(); it != _objects.rend(); ++it)
+            it->destructor(it->address);
+        // Unmap all the blocks.
+        for (const block& block : _blocks)
+            unmap_block(block);
+        for (const block& block : _large_blocks)
+            unmap_block(block);
+    }
+
+    void arena_allocator::rewind(const checkpoint& checkpoint) noexcept
+    {
+        for (std::size_t i = _objects.size(); i > checkpoint.object_count; --i)
+            _objects[i - 1].destructor(_objects[i - 1].address);
+        _objects.resize(checkpoint.object_count);
+
+        for (std::size_t i = checkpoint.large_block_count; i < _large_blocks.size(); ++i)
+            unmap_block(_large_blocks[i]);
+        _large_blocks.resize(checkpoint.large_block_count);
+
+        _block_index = checkpoint.block_index;
+        _cursor = checkpoint.cursor;
+        _end = _blocks[_block_index].address + _blocks[_block_index].size;
+    }
+
+    void* arena_allocator::allocate_bytes_slow(std::size_t size, std::size_t alignment)
+    {
+        // Padding for alignments beyond what a block's start guarantees.
+        std::size_t padded_size = size + (alignment > alignof(std::max_align_t) ? alignment - 1 : 0);
+
+        // Allocations too big to share a block get their own, so the rest of the current block isn't wasted.
+        if (padded_size > _blocks[_block_index].size / 4)
+        {
+            _large_blocks.push_back(map_block(padded_size));
+            return reinterpret_cast<void*>(round_up(reinterpret_cast<std::uintptr_t>(_large_blocks.back().address), alignment));
+        }
+
+        // Every later block is at least as big as the current one, so the allocation fits in the next one.
+        next_block();
+        return allocate_bytes(size, alignment);
+    }
+
+    void arena_allocator::next_block()
+    {
+        if (!_blocks.empty())
+            ++_block_index;
+        if (_block_index == _blocks.size())
+        {
+            _blocks.push_back(map_block(_block_size));
+            _block_size = std::min(_block_size * 2, max_block_size);
+        }
+        _cursor = _blocks[_block_index].address;
+        _end = _cursor + _blocks[_block_index].size;
+    }
+
+    arena_allocator::block arena_allocator::map_block(std::size_t size)
+    {
+        static const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+        // Smaller blocks aren't worth a huge page, so they're only page aligned.
+        if (size < huge_page_size)
+        {
+            size = round_up(size, page_size);
+            void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (address == MAP_FAILED)
+                throw std::bad_alloc();
+            return {static_cast<std::uint8_t*>(address), size};
+        }
+
+        // Map an extra huge page, then unmap the excess on either side to align the block.
+        size = round_up(size, huge_page_size);
+        std::size_t mapped_size = size + huge_page_size;
+        void* address = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (address == MAP_FAILED)
+            throw std::bad_alloc();
+        std::uint8_t* mapped = static_cast<std::uint8_t*>(address);
+        std::uint8_t* aligned = reinterpret_cast<std::uint8_t*>(round_up(reinterpret_cast<std::uintptr_t>(mapped), huge_page_size));
+        if (aligned != mapped)
+            munmap(mapped, aligned - mapped);
+        if (std::uint8_t* aligned_end = aligned + size; aligned_end != mapped + mapped_size)
+            munmap(aligned_end, mapped + mapped_size - aligned_end);
+#ifdef MADV_HUGEPAGE
+        madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        return {aligned, size};
+    }
+
+    void arena_allocator::unmap_block(const block& block) noexcept
+    {
+        munmap(block.address, block.size);
+    }
+} // namespace shl
@@ -1,73 +1,138 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <type_traits>
 #include <vector>
 
 namespace shl
 {
-    class arena_allocator
+    // A monotonic arena: allocations bump a pointer through blocks, and nothing is freed until the arena is, or is rewound.
+    // Blocks are mapped straight from the OS, each twice the size of the last up to max_block_size,
+    // and big blocks are backed by huge pages where available.
+    // It's also a std::pmr::memory_resource, so containers inside arena objects can allocate from it too.
+    // Deallocating through it does nothing; the memory is reclaimed all at once when the arena is destroyed.
+    class arena_allocator : public std::pmr::memory_resource
     {
+    public:
+        // Blocks stop growing once they reach this size.
+        static constexpr std::size_t max_block_size = 64 * 1024 * 1024;
+
+        // A position in the arena, to rewind back to.
+        class checkpoint
+        {
+        private:
+            friend class arena_allocator;
+
+            std::size_t block_index;
+            std::uint8_t* cursor;
+            std::size_t large_block_count;
+            std::size_t object_count;
+        };
+
     public:
         arena_allocator(const arena_allocator&) = delete;
         arena_allocator(arena_allocator&&) = delete;
         arena_allocator& operator=(const arena_allocator&) = delete;
         arena_allocator& operator=(arena_allocator&&) = delete;
 
-        [[nodiscard]] inline explicit arena_allocator(std::size_t block_size) noexcept
-            : _block_size(block_size)
+        // The first block is block_size bytes, rounded up to a whole number of pages.
+        [[nodiscard]] explicit arena_allocator(std::size_t block_size);
+
+        ~arena_allocator() noexcept override;
+
+        // Only objects that aren't trivially destructible are remembered to be destructed.
+        template <typename T, typename... Args> requires(std::is_constructible_v<T, Args...>)
+        [[nodiscard]] T* allocate(Args&&... construct_args)
         {
-            allocate_new_buffer();
+            void* address = allocate_bytes(sizeof(T), alignof(T));
+            T* object = new(address) T(std::forward<Args>(construct_args)...);
+            if constexpr (!std::is_trivially_destructible_v<T>)
+                _objects.emplace_back(object, [](void* address) noexcept { static_cast<T*>(address)->~T(); });
+            return object;
         }
 
-        ~arena_allocator() noexcept
+        // Returns an empty vector whose elements are allocated from this arena.
+        template <typename T>
+        [[nodiscard]] std::pmr::vector<T> make_vector() noexcept
         {
-            // Destruct all the objects.
-            for (object_metadata& object : _objects)
-                object.destructor(object.address);
-            // Deallocate all the blocks.
-            for (std::uint8_t* block : _blocks)
-                delete[] block;
+            return std::pmr::vector<T>(this);
         }
 
-        template <typename T, typename... Args> requires(std::is_constructible_v<T, Args...>)
-        [[nodiscard]] T* allocate(Args&&... construct_args)
+        // Returns uninitialized memory. Alignment must be a power of two.
+        [[nodiscard]] inline void* allocate_bytes(std::size_t size, std::size_t alignment)
+        {
+            std::uintptr_t address = (reinterpret_cast<std::uintptr_t>(_cursor) + (alignment - 1)) & ~(alignment - 1);
+            if (address + size <= reinterpret_cast<std::uintptr_t>(_end)) [[likely]]
+            {
+                _cursor = reinterpret_cast<std::uint8_t*>(address + size);
+                return reinterpret_cast<void*>(address);
+            }
+            return allocate_bytes_slow(size, alignment);
+        }
+
+        // Returns the current position, to later rewind to.
+        [[nodiscard]] checkpoint get_checkpoint() const noexcept
         {
-            std::size_t size_remaning_before = _block_size_remaining;
-
-            // Get the object's address and size (accounting for alignment).
-            void* address = _blocks.back() + (_block_size - _block_size_remaining);
-            address = std::align(alignof(T), sizeof(T), address, _block_size_remaining);
-            if (!address || _block_size_remaining < sizeof(T))
-                allocate_new_buffer();
-            _block_size_remaining -= sizeof(T);
-
-            // Create the object metadata.
-            std::size_t size_remaning_after = _block_size_remaining;
-            std::size_t object_size = size_remaning_before - size_remaning_after;
-            _objects.emplace_back(address, object_size, [](const void* address) noexcept { static_cast<const T*>(address)->~T(); });
-
-            // Create and return the object.
-            return new(address) T(std::forward<Args>(construct_args)...);
+            checkpoint checkpoint;
+            checkpoint.block_index = _block_index;
+            checkpoint.cursor = _cursor;
+            checkpoint.large_block_count = _large_blocks.size();
+            checkpoint.object_count = _objects.size();
+            return checkpoint;
         }
 
+        // Releases everything allocated after the checkpoint, which must be from this arena and not after a later rewind.
+        // Aside from destructing objects that need it, this takes constant time; the released blocks are kept to be reused.
+        // Nothing allocated after the checkpoint may be used afterwards, including memory that containers grew into.
+        void rewind(const checkpoint& checkpoint) noexcept;
+
     private:
-        inline void allocate_new_buffer()
+        void* do_allocate(std::size_t size, std::size_t alignment) override
         {
-            _block_size_remaining = _block_size;
-            _blocks.push_back(new std::uint8_t[_block_size]);
+            return allocate_bytes(size, alignment);
         }
 
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        // Called when the current block doesn't have enough room left.
+        void* allocate_bytes_slow(std::size_t size, std::size_t alignment);
+
+        // Moves on to the next block, reusing one that was rewound past if there is one.
+        void next_block();
+
+        struct block
+        {
+            std::uint8_t* address;
+            std::size_t size;
+        };
+
+        [[nodiscard]] static block map_block(std::size_t size);
+        static void unmap_block(const block& block) noexcept;
+
         struct object_metadata
         {
             void* address;
-            std::size_t size;
-            void(*destructor)(const void* address) noexcept;
+            void(*destructor)(void* address) noexcept;
         };
 
+        // The size of the next block to map.
         std::size_t _block_size;
-        std::size_t _block_size_remaining;
-        std::vector<std::uint8_t*> _blocks;
+        // The unused part of the current block.
+        std::uint8_t* _cursor;
+        std::uint8_t* _end;
+        // Blocks in the order they're filled. Those after the current one were rewound past, and are empty.
+        std::vector<block> _blocks;
+        std::size_t _block_index = 0;
+        // Blocks dedicated to allocations too big to share one.
+        std::vector<block> _large_blocks;
         std::vector<object_metadata> _objects;
     };
 } // namespace shl
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <span>
+
+namespace shl
+{
+    // Walks a contiguous range without owning or copying it.
+    // Values are returned by pointer, and bounds checks are a single pointer compare, or an assert.
+    template <typename T>
+    class cursor
+    {
+    public:
+        using value_type = T;
+
+    public:
+        [[nodiscard]] cursor() noexcept = default;
+        [[nodiscard]] explicit cursor(std::span<const T> range) noexcept
+            : _begin(range.data()), _it(range.data()), _end(range.data() + range.size()) {}
+
+        // If there is a value offset values after the current one, returns said value.
+        // Otherwise, returns nullptr.
+        [[nodiscard]] const T* peek(std::size_t offset = 0) const noexcept
+        {
+            return offset < static_cast<std::size_t>(_end - _it) ? _it + offset : nullptr;
+        }
+
+        // Returns the current value and advances past advance values.
+        // Call peek() first to see if the advance is valid.
+        const T* consume(std::size_t advance = 1) noexcept
+        {
+            assert(advance <= static_cast<std::size_t>(_end - _it) && "Consumed past the end of the cursor.");
+            const T* it = _it;
+            _it += advance;
+            return it;
+        }
+
+        // Returns the last consumed value, if any.
+        [[nodiscard]] const T* previous() const noexcept
+        {
+            return _it != _begin ? _it - 1 : nullptr;
+        }
+
+        // Moves the cursor to the value at position, which may be the end.
+        void seek(std::size_t position) noexcept
+        {
+            assert(position <= size() && "Sought past the end of the cursor.");
+            _it = _begin + position;
+        }
+
+        // Resets the cursor so its ready to consume from the start again.
+        void reset() noexcept
+        {
+            _it = _begin;
+        }
+
+        [[nodiscard]] bool is_at_end() const noexcept { return _it == _end; }
+        // The number of values consumed, i.e. the index of the current value.
+        [[nodiscard]] std::size_t position() const noexcept { return static_cast<std::size_t>(_it - _begin); }
+        [[nodiscard]] std::size_t size() const noexcept { return static_cast<std::size_t>(_end - _begin); }
+        [[nodiscard]] const T* data() const noexcept { return _begin; }
+
+    private:
+        const T* _begin = nullptr;
+        const T* _it = nullptr;
+        const T* _end = nullptr;
+    };
+
+    // A source of values for a ring_cursor, which writes its next value in place, if it has one.
+    template <typename S, typename T>
+    concept ring_cursor_source = requires(S& source, T& value)
+    {
+        { source.next(value) } -> std::same_as<bool>;
+    };
+
+    // Pulls values from a streaming source on demand, only keeping a small window of them alive at once.
+    // The window holds the previous value, the current value, and up to lookahead - 1 values after it.
+    // Values are written straight into the window and returned by pointer, so they're never copied.
+    template <typename T, std::size_t Lookahead, ring_cursor_source<T> S>
+    class ring_cursor
+    {
+    public:
+        using value_type = T;
+        using source_type = S;
+        // The number of values, starting at the current one, that can be peeked at.
+        static constexpr std::size_t lookahead = Lookahead;
+
+    public:
+        [[nodiscard]] explicit ring_cursor(source_type& source) noexcept : _source(source) {}
+
+        ring_cursor(const ring_cursor&) = delete;
+        ring_cursor(ring_cursor&&) = delete;
+        ring_cursor& operator=(const ring_cursor&) = delete;
+        ring_cursor& operator=(ring_cursor&&) = delete;
+
+        // If there is a value offset values after the current one, returns said value.
+        // Otherwise, returns nullptr.
+        // The returned value is valid until lookahead more values are pulled.
+        [[nodiscard]] const T* peek(std::size_t offset = 0)
+        {
+            assert(offset < lookahead && "Peeked past the ring cursor's lookahead.");
+            while (_end <= _begin + offset)
+            {
+                if (_exhausted || !_source.next(_window[_end % capacity]))
+                {
+                    _exhausted = true;
+                    return nullptr;
+                }
+                ++_end;
+            }
+            return &_window[(_begin + offset) % capacity];
+        }
+
+        // Returns the current value and advances to the next one.
+        // Call peek() first to see if the advance is valid.
+        // The returned value is valid until lookahead more values are pulled.
+        const T* consume() noexcept
+        {
+            assert(_begin < _end && "Consumed a value that was never peeked.");
+            return &_window[_begin++ % capacity];
+        }
+
+        // Returns the last consumed value, if any.
+        [[nodiscard]] const T* previous() const noexcept
+        {
+            return _begin ? &_window[(_begin - 1) % capacity] : nullptr;
+        }
+
+        // The number of values consumed, i.e. the index of the current value.
+        [[nodiscard]] std::size_t position() const noexcept { return _begin; }
+        [[nodiscard]] source_type& get_source() const noexcept { return _source; }
+
+    private:
+        // The previous value plus the lookahead, rounded up to a power of two.
+        static constexpr std::size_t capacity = std::bit_ceil(lookahead + 1);
+
+        source_type& _source;
+        std::array<T, capacity> _window{};
+        // Number of values consumed, i.e. the index of the current value.
+        std::size_t _begin = 0;
+        // Number of values pulled from the source.
+        std::size_t _end = 0;
+        // If the source has no more values.
+        bool _exhausted = false;
+    };
+} // namespace shl
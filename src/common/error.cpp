@@ -3,8 +3,24 @@
 
 namespace shl
 {
+    // If an error_trap is alive on this thread.
+    static thread_local bool _is_trapped = false;
+
+    error_trap::error_trap() noexcept : _was_trapped(_is_trapped)
+    {
+        _is_trapped = true;
+    }
+
+    error_trap::~error_trap() noexcept
+    {
+        _is_trapped = _was_trapped;
+    }
+
     void error_exit(std::string_view stage, std::string_view error_message, std::uint32_t line_number, std::uint32_t column_number)
     {
+        if (_is_trapped)
+            throw compile_error(std::string(stage), std::string(error_message), line_number, column_number);
+
         std::cerr << '[' << stage << " error]: " << error_message;
         if (line_number || column_number)
             std::cerr << " around " << line_number << ':' << column_number << " (+/- one token)";
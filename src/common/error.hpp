@@ -1,10 +1,37 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include <string_view>
 
 namespace shl
 {
+    // An error which error_exit threw instead of exiting, since an error_trap was alive.
+    struct compile_error
+    {
+        std::string stage;
+        std::string error_message;
+        std::uint32_t line_number;
+        std::uint32_t column_number;
+    };
+
+    // While alive, error_exit throws a compile_error on the constructing thread instead of exiting.
+    // Lets long-lived tools, like the incremental parser, recover from errors in code being edited.
+    class error_trap
+    {
+    public:
+        [[nodiscard]] error_trap() noexcept;
+        ~error_trap() noexcept;
+
+        error_trap(const error_trap&) = delete;
+        error_trap(error_trap&&) = delete;
+        error_trap& operator=(const error_trap&) = delete;
+        error_trap& operator=(error_trap&&) = delete;
+
+    private:
+        bool _was_trapped;
+    };
+
     [[noreturn]] void error_exit(std::string_view stage, std::string_view error_message, std::uint32_t line_number = 0, std::uint32_t column_number = 0);
 } // namespace shl
 
@@ -19,3 +19,8 @@
 #define _FOR_EACH_ARGS_HELPER(macro, args, arg, ...) macro(EXPAND args, arg) __VA_OPT__(_FOR_EACH_ARGS_AGAIN PARENS (macro, args, __VA_ARGS__))
 #define _FOR_EACH_ARGS_AGAIN() _FOR_EACH_ARGS_HELPER
 #define FOR_EACH_ARGS(macro, args, ...) __VA_OPT__(_FOR_EACH_EXPAND(_FOR_EACH_ARGS_HELPER(macro, args, __VA_ARGS__)))
+
+#define _FOR_EACH_COMMA_HELPER(macro, arg, ...) macro(arg) __VA_OPT__(, _FOR_EACH_COMMA_AGAIN PARENS (macro, __VA_ARGS__))
+#define _FOR_EACH_COMMA_AGAIN() _FOR_EACH_COMMA_HELPER
+// Like FOR_EACH, but with a comma between each expansion.
+#define FOR_EACH_COMMA(macro, ...) __VA_OPT__(_FOR_EACH_EXPAND(_FOR_EACH_COMMA_HELPER(macro, __VA_ARGS__)))
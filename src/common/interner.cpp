@@ -0,0 +1,77 @@
+#include "interner.hpp"
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+namespace shl
+{
+    string_interner::string_interner()
+    {
+        _ids.emplace(std::string_view(), symbol_id::empty);
+        _strings.emplace_back();
+    }
+
+    symbol_id string_interner::intern(std::string_view string)
+    {
+        // Most strings have already been interned, so only read at first.
+        if (auto symbol = find(string))
+            return *symbol;
+
+        std::unique_lock lock(_mutex);
+        // Another thread may have interned it in the meantime.
+        if (auto it = _ids.find(string); it != _ids.end())
+            return it->second;
+        auto symbol = static_cast<symbol_id>(_strings.size());
+        auto stored = store(string);
+        _strings.push_back(stored);
+        _ids.emplace(stored, symbol);
+        return symbol;
+    }
+
+    std::optional<symbol_id> string_interner::find(std::string_view string) const
+    {
+        std::shared_lock lock(_mutex);
+        if (auto it = _ids.find(string); it != _ids.end())
+            return it->second;
+        return std::nullopt;
+    }
+
+    std::string_view string_interner::get(symbol_id symbol) const
+    {
+        std::shared_lock lock(_mutex);
+        return _strings[std::to_underlying(symbol)];
+    }
+
+    std::size_t string_interner::size() const
+    {
+        std::shared_lock lock(_mutex);
+        return _strings.size();
+    }
+
+    std::string_view string_interner::store(std::string_view string)
+    {
+        if (string.size() > _block_size_remaining)
+        {
+            // Strings larger than a block get their own, so the current block isn't wasted.
+            if (string.size() > block_size / 4)
+            {
+                char* storage = _blocks.emplace_back(std::make_unique_for_overwrite<char[]>(string.size())).get();
+                std::ranges::copy(string, storage);
+                return {storage, string.size()};
+            }
+            _block_cursor = _blocks.emplace_back(std::make_unique_for_overwrite<char[]>(block_size)).get();
+            _block_size_remaining = block_size;
+        }
+        char* storage = _block_cursor;
+        std::ranges::copy(string, storage);
+        _block_cursor += string.size();
+        _block_size_remaining -= string.size();
+        return {storage, string.size()};
+    }
+
+    string_interner& get_interner() noexcept
+    {
+        static string_interner _interner;
+        return _interner;
+    }
+} // namespace shl
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace shl
+{
+    // A dense id of an interned string. Two ids are equal if and only if their strings are.
+    enum class symbol_id : std::uint32_t
+    {
+        empty = 0, // The empty string is always interned first.
+    };
+
+    // Maps strings to dense 32-bit ids, so later stages compare and hash integers instead of strings.
+    // All member functions are safe to call from multiple threads at once.
+    class string_interner
+    {
+    public:
+        [[nodiscard]] string_interner();
+
+        string_interner(const string_interner&) = delete;
+        string_interner(string_interner&&) = delete;
+        string_interner& operator=(const string_interner&) = delete;
+        string_interner& operator=(string_interner&&) = delete;
+
+        // Returns the string's id, interning a copy of the string first if need be.
+        [[nodiscard]] symbol_id intern(std::string_view string);
+
+        // Returns the string's id if it has been interned, without interning it.
+        [[nodiscard]] std::optional<symbol_id> find(std::string_view string) const;
+
+        // Returns the interned string, which stays valid for the interner's lifetime.
+        [[nodiscard]] std::string_view get(symbol_id symbol) const;
+
+        // Returns the number of interned strings, i.e. one more than the largest id.
+        [[nodiscard]] std::size_t size() const;
+
+    private:
+        // Copies the string into the interner's storage. The unique lock must be held.
+        [[nodiscard]] std::string_view store(std::string_view string);
+
+    private:
+        mutable std::shared_mutex _mutex;
+        std::unordered_map<std::string_view, symbol_id> _ids;
+        std::vector<std::string_view> _strings;
+
+        // Storage for the interned strings' characters, never reallocated.
+        std::vector<std::unique_ptr<char[]>> _blocks;
+        char* _block_cursor = nullptr;
+        std::size_t _block_size_remaining = 0;
+
+        static constexpr std::size_t block_size = 64 * 1024; // 64 KiB blocks.
+    };
+
+    // Returns the interner shared by the whole compilation.
+    [[nodiscard]] string_interner& get_interner() noexcept;
+} // namespace shl
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common/for_each.hpp"
+#include <cstdint>
 #include <utility>
 
 #define _DEFINE_RANGED_ENUM_NAME(name) name,
@@ -15,8 +16,9 @@
     { return +name::_range_##range##s_begin <= +e && +e < +name::_range_##range##s_end; }
 #define _DEFINE_RANGED_ENUM_RANGE_CHECK(name, args2) CALL(_DEFINE_RANGED_ENUM_RANGE_CHECK_, name, EXPAND args2)
 
+// Ranged enums are only ever small, so they're one byte to keep the structures and tables holding them compact.
 #define DEFINE_RANGED_ENUM(name, enums, ranges) \
-    enum class name \
+    enum class name : std::uint8_t \
     { \
         FOR_EACH(_DEFINE_RANGED_ENUM_NAME, EXPAND enums) \
         _count, \
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "common/interner.hpp"
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace shl
+{
+    // Maps symbols to values, in nested scopes. Ending a scope removes every symbol added since it began.
+    // Symbols are kept in an open-addressing hash table with linear probing, so finding, adding
+    // and removing one takes constant time on average, no matter how many are in scope.
+    template <typename T>
+    class symbol_table
+    {
+    public:
+        // Returns the symbol's value, or nullptr if it's not in scope.
+        // The pointer is invalidated by adding or removing symbols.
+        [[nodiscard]] T* find(symbol_id symbol) noexcept
+        {
+            return const_cast<T*>(std::as_const(*this).find(symbol));
+        }
+
+        // Safe to call from multiple threads at once, as long as none are adding or removing symbols.
+        [[nodiscard]] const T* find(symbol_id symbol) const noexcept
+        {
+            if (_slots.empty())
+                return nullptr;
+            for (std::size_t i = get_home(symbol); ; i = (i + 1) & (_slots.size() - 1))
+            {
+                if (_slots[i].symbol == symbol)
+                    return &_slots[i].value;
+                if (_slots[i].symbol == symbol_id::empty)
+                    return nullptr;
+            }
+        }
+
+        // Adds the symbol to the innermost scope, or permanently if there is none.
+        // The symbol must not be empty, nor already be in scope.
+        void insert(symbol_id symbol, T value)
+        {
+            assert(symbol != symbol_id::empty && !find(symbol));
+            // Keep the table at most 3/4 full, so probe sequences stay short.
+            if ((_size + 1) * 4 > _slots.size() * 3)
+                rehash(_slots.empty() ? 16 : _slots.size() * 2);
+            place(symbol, std::move(value));
+            ++_size;
+            if (!_scopes.empty())
+                _added.push_back(symbol);
+        }
+
+        void begin_scope()
+        {
+            _scopes.push_back(_added.size());
+        }
+
+        void end_scope() noexcept
+        {
+            for (std::size_t i = _added.size(); i > _scopes.back(); --i)
+                erase(_added[i - 1]);
+            _added.resize(_scopes.back());
+            _scopes.pop_back();
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept { return _size; }
+
+    private:
+        struct slot
+        {
+            // symbol_id::empty marks an empty slot; the empty string is never a symbol in scope.
+            symbol_id symbol = symbol_id::empty;
+            T value{};
+        };
+
+        // Returns the slot the symbol's probe sequence starts at. Symbols are dense,
+        // so they're spread across the table by Fibonacci hashing.
+        [[nodiscard]] std::size_t get_home(symbol_id symbol) const noexcept
+        {
+            std::uint64_t hash = std::to_underlying(symbol) * 0x9E3779B97F4A7C15ull;
+            return static_cast<std::size_t>(hash >> (64 - std::countr_zero(_slots.size())));
+        }
+
+        void place(symbol_id symbol, T&& value) noexcept
+        {
+            std::size_t i = get_home(symbol);
+            while (_slots[i].symbol != symbol_id::empty)
+                i = (i + 1) & (_slots.size() - 1);
+            _slots[i] = {symbol, std::move(value)};
+        }
+
+        void rehash(std::size_t capacity)
+        {
+            std::vector<slot> slots(capacity);
+            std::swap(slots, _slots);
+            for (slot& slot : slots)
+                if (slot.symbol != symbol_id::empty)
+                    place(slot.symbol, std::move(slot.value));
+        }
+
+        // Removes the symbol, which must be in the table.
+        // Later entries of the probe sequence are shifted back over it, so no tombstones are left behind.
+        void erase(symbol_id symbol) noexcept
+        {
+            std::size_t mask = _slots.size() - 1;
+            std::size_t hole = get_home(symbol);
+            while (_slots[hole].symbol != symbol)
+                hole = (hole + 1) & mask;
+            for (std::size_t i = (hole + 1) & mask; _slots[i].symbol != symbol_id::empty; i = (i + 1) & mask)
+            {
+                // An entry can fill the hole if its home isn't cyclically within (hole, i].
+                std::size_t home = get_home(_slots[i].symbol);
+                if (((i - home) & mask) >= ((i - hole) & mask))
+                {
+                    _slots[hole] = std::move(_slots[i]);
+                    hole = i;
+                }
+            }
+            _slots[hole] = {};
+            --_size;
+        }
+
+    private:
+        std::vector<slot> _slots; // The capacity is always zero or a power of two.
+        std::size_t _size = 0;
+        // The symbols added in any scope, in order, and how many had been added when each scope began.
+        std::vector<symbol_id> _added;
+        std::vector<std::size_t> _scopes;
+    };
+} // namespace shl
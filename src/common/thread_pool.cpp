@@ -0,0 +1,83 @@
+#include "thread_pool.hpp"
+#include "input.hpp"
+#include <algorithm>
+
+namespace shl
+{
+    thread_pool::thread_pool(std::size_t thread_count)
+    {
+        _workers.reserve(thread_count ? thread_count - 1 : 0);
+        for (std::size_t thread_index = 1; thread_index < thread_count; ++thread_index)
+            _workers.emplace_back(&thread_pool::work, this, thread_index);
+    }
+
+    thread_pool::~thread_pool() noexcept
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _is_stopping = true;
+        }
+        _jobs_available.notify_all();
+        for (std::thread& worker : _workers)
+            worker.join();
+    }
+
+    void thread_pool::run(std::size_t job_count, const job_function& job)
+    {
+        // Don't wake the workers if the calling thread would do all the work anyway.
+        if (job_count <= 1 || _workers.empty())
+        {
+            for (std::size_t job_index = 0; job_index < job_count; ++job_index)
+                job(job_index, 0);
+            return;
+        }
+
+        {
+            std::lock_guard lock(_mutex);
+            _job = &job;
+            _job_count = job_count;
+            _next_job_index.store(0, std::memory_order_relaxed);
+            _busy_count = _workers.size();
+            ++_generation;
+        }
+        _jobs_available.notify_all();
+
+        run_jobs(0);
+
+        std::unique_lock lock(_mutex);
+        _jobs_done.wait(lock, [this] { return _busy_count == 0; });
+        _job = nullptr;
+    }
+
+    void thread_pool::work(std::size_t thread_index)
+    {
+        for (std::uint64_t generation = 0; ; )
+        {
+            {
+                std::unique_lock lock(_mutex);
+                _jobs_available.wait(lock, [&] { return _is_stopping || _generation != generation; });
+                if (_is_stopping)
+                    return;
+                generation = _generation;
+            }
+
+            run_jobs(thread_index);
+
+            std::lock_guard lock(_mutex);
+            if (--_busy_count == 0)
+                _jobs_done.notify_one();
+        }
+    }
+
+    void thread_pool::run_jobs(std::size_t thread_index)
+    {
+        for (std::size_t job_index; (job_index = _next_job_index.fetch_add(1, std::memory_order_relaxed)) < _job_count; )
+            (*_job)(job_index, thread_index);
+    }
+
+    thread_pool& get_thread_pool()
+    {
+        static thread_pool _thread_pool(get_input().thread_count ? get_input().thread_count : std::max(std::thread::hardware_concurrency(), 1u));
+        return _thread_pool;
+    }
+} // namespace shl
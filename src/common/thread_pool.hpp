@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace shl
+{
+    // A fixed set of worker threads, which the calling thread joins while running a batch of jobs.
+    class thread_pool
+    {
+    public:
+        // The index of a job, and the index of the thread running it, in [0, get_thread_count()).
+        // Jobs must not throw.
+        using job_function = std::function<void(std::size_t job_index, std::size_t thread_index)>;
+
+    public:
+        // Includes the calling thread, so 1 means no worker threads at all.
+        [[nodiscard]] explicit thread_pool(std::size_t thread_count);
+        ~thread_pool() noexcept;
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool(thread_pool&&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+        thread_pool& operator=(thread_pool&&) = delete;
+
+        // Runs job_count jobs spread over every thread, and returns once they've all returned.
+        // Threads take the next job as soon as they finish one, so jobs may take uneven time.
+        void run(std::size_t job_count, const job_function& job);
+
+        [[nodiscard]] std::size_t get_thread_count() const noexcept { return _workers.size() + 1; }
+
+    private:
+        void work(std::size_t thread_index);
+        void run_jobs(std::size_t thread_index);
+
+    private:
+        std::vector<std::thread> _workers;
+
+        std::mutex _mutex;
+        std::condition_variable _jobs_available;
+        std::condition_variable _jobs_done;
+        // Incremented for every call to run, so workers know when there are new jobs.
+        std::uint64_t _generation = 0;
+        // The number of workers still running the current generation's jobs.
+        std::size_t _busy_count = 0;
+        bool _is_stopping = false;
+
+        const job_function* _job = nullptr;
+        std::size_t _job_count = 0;
+        std::atomic<std::size_t> _next_job_index = 0;
+    };
+
+    // Returns the pool shared by the whole compilation, with as many threads as the -j option says.
+    [[nodiscard]] thread_pool& get_thread_pool();
+} // namespace shl
@@ -1,9 +1,29 @@
 #include "fileio.hpp"
+#include <cerrno>
 #include <fstream>
 #include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace shl::fileio
 {
+    source_buffer::~source_buffer() noexcept
+    {
+        release();
+    }
+
+    void source_buffer::release() noexcept
+    {
+        if (_mapped)
+            munmap(const_cast<char*>(_data), _size);
+        _data = nullptr;
+        _size = 0;
+        _mapped = false;
+        _storage.clear();
+    }
+
     bool read(const std::filesystem::path& file_path, std::string& file_contents) noexcept
     {
         try
@@ -21,6 +41,61 @@ namespace shl::fileio
         return false;
     }
 
+    bool read(const std::filesystem::path& file_path, source_buffer& file_contents) noexcept
+    {
+        file_contents.release();
+
+        int file_descriptor = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file_descriptor < 0)
+            return false;
+
+        // Map regular files directly, so the source code is never copied.
+        struct stat file_status;
+        if (fstat(file_descriptor, &file_status) == 0 && S_ISREG(file_status.st_mode) && file_status.st_size > 0)
+        {
+            std::size_t size = file_status.st_size;
+            void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            if (address != MAP_FAILED)
+            {
+                madvise(address, size, MADV_SEQUENTIAL);
+                close(file_descriptor);
+                file_contents._data = static_cast<const char*>(address);
+                file_contents._size = size;
+                file_contents._mapped = true;
+                return true;
+            }
+        }
+
+        // Otherwise, read until the end of the file.
+        bool success = true;
+        try
+        {
+            char buffer[64 * 1024];
+            while (true)
+            {
+                ssize_t count = ::read(file_descriptor, buffer, sizeof(buffer));
+                if (count > 0)
+                    file_contents._storage.append(buffer, count);
+                else if (count == 0)
+                    break;
+                else if (errno != EINTR)
+                {
+                    success = false;
+                    break;
+                }
+            }
+        }
+        catch (...)
+        {
+            success = false;
+        }
+        close(file_descriptor);
+
+        file_contents._data = file_contents._storage.data();
+        file_contents._size = file_contents._storage.size();
+        return success;
+    }
+
     bool write(const std::filesystem::path& file_path, const std::string& file_contents, bool append) noexcept
     {
         try
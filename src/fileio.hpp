@@ -2,9 +2,41 @@
 
 #include <filesystem>
 #include <string>
+#include <string_view>
 
 namespace shl::fileio
 {
+    // The read-only contents of a file, memory mapped when possible.
+    // Files that can't be mapped, e.g. pipes, are read into memory instead.
+    // Views of the contents stay valid until the buffer is destroyed.
+    class source_buffer
+    {
+    public:
+        [[nodiscard]] source_buffer() noexcept = default;
+        ~source_buffer() noexcept;
+
+        source_buffer(const source_buffer&) = delete;
+        source_buffer(source_buffer&&) = delete;
+        source_buffer& operator=(const source_buffer&) = delete;
+        source_buffer& operator=(source_buffer&&) = delete;
+
+        [[nodiscard]] std::string_view view() const noexcept { return {_data, _size}; }
+        [[nodiscard]] bool is_mapped() const noexcept { return _mapped; }
+
+    private:
+        friend bool read(const std::filesystem::path& file_path, source_buffer& file_contents) noexcept;
+
+        void release() noexcept;
+
+    private:
+        const char* _data = nullptr;
+        std::size_t _size = 0;
+        bool _mapped = false;
+        // Only used when the file couldn't be mapped.
+        std::string _storage;
+    };
+
     [[nodiscard]] bool read(const std::filesystem::path& file_path, std::string& file_contents) noexcept;
+    [[nodiscard]] bool read(const std::filesystem::path& file_path, source_buffer& file_contents) noexcept;
     [[nodiscard]] bool write(const std::filesystem::path& file_path, const std::string& file_contents, bool append = false) noexcept;
 } // namespace shl::fileio
@@ -0,0 +1,368 @@
+#pragma once
+
+#include "common/ranged_enum.hpp"
+#include "front/token.hpp"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+
+namespace shl
+{
+    // The parser's grammar as data, so its FIRST and FOLLOW sets and its LL(1) prediction table
+    // are computed at compile time, and the parser picks each production with a single table lookup.
+    // The grammar must stay LL(1); any conflict is a compile error instead of silent backtracking.
+
+    DEFINE_RANGED_ENUM(nonterminal,
+        (
+            program,
+            declarations,
+            declaration,
+            declaration_value,
+            object_value,
+            object_type,
+            object_initializer,
+            function,
+            return_values,
+            return_values_tail,
+            parameter_list,
+            parameters,
+            parameters_tail,
+            parameter,
+            parameter_pass,
+            declare_object,
+            scope,
+            scoped_statements,
+            scoped_statement,
+            identifier_statement,
+            statement,
+            if_statement,
+            else_ifs,
+            return_statement,
+            reassign,
+            expression,
+            binary_operations,
+            term,
+            binary_operator
+        ),
+        // Ranges
+        ()
+    );
+
+    // Every production, in the same order as the grammar, named after its nonterminal and what sets it apart.
+    DEFINE_RANGED_ENUM(production,
+        (
+            program_declarations,
+            declarations_declaration,
+            declarations_end,
+            declaration_named,
+            declaration_value_function,
+            declaration_value_object,
+            object_value_declaration,
+            object_type_identifier,
+            object_type_auto,
+            object_initializer_expression,
+            object_initializer_none,
+            function_definition,
+            return_values_some,
+            return_values_none,
+            return_values_tail_comma,
+            return_values_tail_end,
+            parameter_list_some,
+            parameter_list_none,
+            parameters_some,
+            parameters_none,
+            parameters_tail_comma,
+            parameters_tail_end,
+            parameter_declaration,
+            parameter_pass_in,
+            parameter_pass_out,
+            parameter_pass_inout,
+            parameter_pass_copy,
+            parameter_pass_move,
+            parameter_pass_default,
+            declare_object_typed,
+            scope_braced,
+            scoped_statements_statement,
+            scoped_statements_end,
+            scoped_statement_empty,
+            scoped_statement_scope,
+            scoped_statement_if,
+            scoped_statement_return,
+            scoped_statement_identifier,
+            identifier_statement_declaration,
+            identifier_statement_reassign,
+            statement_empty,
+            statement_scope,
+            statement_if,
+            statement_return,
+            statement_reassign,
+            if_statement_conditional,
+            else_ifs_elif,
+            else_ifs_else,
+            else_ifs_end,
+            return_statement_bare,
+            reassign_identifier,
+            expression_term,
+            binary_operations_operator,
+            binary_operations_end,
+            term_integer_literal,
+            term_identifier,
+            term_parenthesized,
+            binary_operator_forward_slash,
+            binary_operator_percent,
+            binary_operator_asterisk,
+            binary_operator_plus,
+            binary_operator_minus
+        ),
+        // Ranges
+        ()
+    );
+
+    // Terminals are token types, plus one past them for the end of the tokens.
+    inline constexpr std::uint8_t terminal_end = +token_type::_count;
+    inline constexpr std::size_t terminal_count = terminal_end + 1;
+
+    // Either a terminal or a nonterminal, packed into one byte.
+    class grammar_symbol
+    {
+    public:
+        [[nodiscard]] constexpr grammar_symbol() noexcept = default;
+        [[nodiscard]] constexpr grammar_symbol(token_type terminal) noexcept : _value(+terminal) {}
+        [[nodiscard]] constexpr grammar_symbol(nonterminal nonterminal) noexcept : _value(terminal_count + +nonterminal) {}
+
+        [[nodiscard]] constexpr bool is_terminal() const noexcept { return _value < terminal_count; }
+        [[nodiscard]] constexpr std::uint8_t get_terminal() const noexcept { return _value; }
+        [[nodiscard]] constexpr nonterminal get_nonterminal() const noexcept { return static_cast<nonterminal>(_value - terminal_count); }
+
+    private:
+        std::uint8_t _value = 0;
+    };
+    static_assert(terminal_count + +nonterminal::_count <= 256);
+
+    struct grammar_rule
+    {
+        static constexpr std::size_t max_length = 6;
+
+        [[nodiscard]] constexpr grammar_rule(production id, nonterminal lhs, std::initializer_list<grammar_symbol> rhs) noexcept
+            : id(id), lhs(lhs), rhs_length(static_cast<std::uint8_t>(rhs.size()))
+        {
+            std::size_t i = 0;
+            for (grammar_symbol symbol : rhs)
+                this->rhs[i++] = symbol;
+        }
+
+        production id;
+        nonterminal lhs;
+        std::array<grammar_symbol, max_length> rhs{};
+        std::uint8_t rhs_length;
+    };
+
+    // Correspondence: The parser's parse functions, one per nonterminal (some nonterminals are loops in them).
+    inline constexpr auto grammar = []
+    {
+        using enum token_type;
+        using n = nonterminal;
+        using p = production;
+        return std::to_array<grammar_rule>
+        ({
+            {p::program_declarations,             n::program,              {n::declaration, n::declarations}},
+            {p::declarations_declaration,         n::declarations,         {n::declaration, n::declarations}},
+            {p::declarations_end,                 n::declarations,         {}},
+            {p::declaration_named,                n::declaration,          {identifier_, colon_, n::declaration_value}},
+            {p::declaration_value_function,       n::declaration_value,    {n::function}},
+            {p::declaration_value_object,         n::declaration_value,    {n::object_value}},
+            {p::object_value_declaration,         n::object_value,         {n::object_type, n::object_initializer, semicolon_}},
+            {p::object_type_identifier,           n::object_type,          {identifier_}},
+            {p::object_type_auto,                 n::object_type,          {}},
+            {p::object_initializer_expression,    n::object_initializer,   {equals_, n::expression}},
+            {p::object_initializer_none,          n::object_initializer,   {}},
+            {p::function_definition,              n::function,             {open_parenthesis_, n::return_values, n::parameter_list, close_parenthesis_, equals_, n::statement}},
+            {p::return_values_some,               n::return_values,        {n::declare_object, n::return_values_tail}},
+            {p::return_values_none,               n::return_values,        {}},
+            {p::return_values_tail_comma,         n::return_values_tail,   {comma_, n::declare_object, n::return_values_tail}},
+            {p::return_values_tail_end,           n::return_values_tail,   {}},
+            {p::parameter_list_some,              n::parameter_list,       {semicolon_, n::parameters}},
+            {p::parameter_list_none,              n::parameter_list,       {}},
+            {p::parameters_some,                  n::parameters,           {n::parameter, n::parameters_tail}},
+            {p::parameters_none,                  n::parameters,           {}},
+            {p::parameters_tail_comma,            n::parameters_tail,      {comma_, n::parameter, n::parameters_tail}},
+            {p::parameters_tail_end,              n::parameters_tail,      {}},
+            {p::parameter_declaration,            n::parameter,            {n::parameter_pass, n::declare_object}},
+            {p::parameter_pass_in,                n::parameter_pass,       {in_}},
+            {p::parameter_pass_out,               n::parameter_pass,       {out_}},
+            {p::parameter_pass_inout,             n::parameter_pass,       {inout_}},
+            {p::parameter_pass_copy,              n::parameter_pass,       {copy_}},
+            {p::parameter_pass_move,              n::parameter_pass,       {move_}},
+            {p::parameter_pass_default,           n::parameter_pass,       {}},
+            {p::declare_object_typed,             n::declare_object,       {identifier_, colon_, identifier_}},
+            {p::scope_braced,                     n::scope,                {open_brace_, n::scoped_statements, close_brace_}},
+            {p::scoped_statements_statement,      n::scoped_statements,    {n::scoped_statement, n::scoped_statements}},
+            {p::scoped_statements_end,            n::scoped_statements,    {}},
+            {p::scoped_statement_empty,           n::scoped_statement,     {semicolon_}},
+            {p::scoped_statement_scope,           n::scoped_statement,     {n::scope}},
+            {p::scoped_statement_if,              n::scoped_statement,     {n::if_statement, n::else_ifs}},
+            {p::scoped_statement_return,          n::scoped_statement,     {n::return_statement}},
+            // Declarations and reassignments both start with an identifier, so they're told apart after it.
+            {p::scoped_statement_identifier,      n::scoped_statement,     {identifier_, n::identifier_statement}},
+            {p::identifier_statement_declaration, n::identifier_statement, {colon_, n::declaration_value}},
+            {p::identifier_statement_reassign,    n::identifier_statement, {equals_, n::expression, semicolon_}},
+            {p::statement_empty,                  n::statement,            {semicolon_}},
+            {p::statement_scope,                  n::statement,            {n::scope}},
+            {p::statement_if,                     n::statement,            {n::if_statement}},
+            {p::statement_return,                 n::statement,            {n::return_statement}},
+            {p::statement_reassign,               n::statement,            {n::reassign}},
+            {p::if_statement_conditional,         n::if_statement,         {if_, n::expression, n::statement}},
+            {p::else_ifs_elif,                    n::else_ifs,             {elif_, n::expression, n::statement, n::else_ifs}},
+            {p::else_ifs_else,                    n::else_ifs,             {else_, n::statement}},
+            {p::else_ifs_end,                     n::else_ifs,             {}},
+            {p::return_statement_bare,            n::return_statement,     {return_, semicolon_}},
+            {p::reassign_identifier,              n::reassign,             {identifier_, equals_, n::expression, semicolon_}},
+            // Operator precedence decides how binary operations nest, the grammar only decides if there's another one.
+            {p::expression_term,                  n::expression,           {n::term, n::binary_operations}},
+            {p::binary_operations_operator,       n::binary_operations,    {n::binary_operator, n::term, n::binary_operations}},
+            {p::binary_operations_end,            n::binary_operations,    {}},
+            {p::term_integer_literal,             n::term,                 {integer_literal_}},
+            {p::term_identifier,                  n::term,                 {identifier_}},
+            {p::term_parenthesized,               n::term,                 {open_parenthesis_, n::expression, close_parenthesis_}},
+            {p::binary_operator_forward_slash,    n::binary_operator,      {forward_slash_}},
+            {p::binary_operator_percent,          n::binary_operator,      {percent_}},
+            {p::binary_operator_asterisk,         n::binary_operator,      {asterisk_}},
+            {p::binary_operator_plus,             n::binary_operator,      {plus_}},
+            {p::binary_operator_minus,            n::binary_operator,      {minus_}},
+        });
+    }();
+
+    static_assert([]
+    {
+        if (grammar.size() != +production::_count)
+            return false;
+        for (std::size_t i = 0; i < grammar.size(); ++i)
+            if (+grammar[i].id != i)
+                return false;
+        return true;
+    }(), "Productions must be in the same order as the grammar.");
+
+    // A set of terminals, one bit each.
+    using terminal_set = std::uint64_t;
+    static_assert(terminal_count <= 64);
+
+    struct grammar_analysis
+    {
+        std::array<bool, +nonterminal::_count> nullable{};
+        std::array<terminal_set, +nonterminal::_count> first{};
+        std::array<terminal_set, +nonterminal::_count> follow{};
+
+        // Returns the FIRST set of rhs[begin, end), and if it's nullable.
+        [[nodiscard]] constexpr terminal_set get_first(const grammar_rule& rule, std::size_t begin, bool& is_nullable) const noexcept
+        {
+            terminal_set set = 0;
+            for (std::size_t i = begin; i < rule.rhs_length; ++i)
+            {
+                grammar_symbol symbol = rule.rhs[i];
+                if (symbol.is_terminal())
+                {
+                    is_nullable = false;
+                    return set | terminal_set(1) << symbol.get_terminal();
+                }
+                set |= first[+symbol.get_nonterminal()];
+                if (!nullable[+symbol.get_nonterminal()])
+                {
+                    is_nullable = false;
+                    return set;
+                }
+            }
+            is_nullable = true;
+            return set;
+        }
+    };
+
+    // Iterates each set to a fixed point.
+    inline constexpr grammar_analysis grammar_sets = []
+    {
+        grammar_analysis sets;
+        sets.follow[+nonterminal::program] = terminal_set(1) << terminal_end;
+        for (bool changed = true; changed; )
+        {
+            changed = false;
+            for (const grammar_rule& rule : grammar)
+            {
+                bool is_nullable;
+                terminal_set first = sets.get_first(rule, 0, is_nullable);
+                changed |= (first & ~sets.first[+rule.lhs]) || (is_nullable && !sets.nullable[+rule.lhs]);
+                sets.first[+rule.lhs] |= first;
+                sets.nullable[+rule.lhs] |= is_nullable;
+
+                for (std::size_t i = 0; i < rule.rhs_length; ++i)
+                {
+                    if (rule.rhs[i].is_terminal())
+                        continue;
+                    terminal_set follow = sets.get_first(rule, i + 1, is_nullable);
+                    if (is_nullable)
+                        follow |= sets.follow[+rule.lhs];
+                    terminal_set& old_follow = sets.follow[+rule.rhs[i].get_nonterminal()];
+                    changed |= (follow & ~old_follow) != 0;
+                    old_follow |= follow;
+                }
+            }
+        }
+        return sets;
+    }();
+
+    // prediction_table[nonterminal][terminal] is the production to parse the nonterminal with when the terminal is next,
+    // or production::_count if there is none.
+    // Nullable nonterminals fall back to their nullable production, so errors are found by whatever comes after them,
+    // which knows best what was expected.
+    inline constexpr auto prediction_table = []
+    {
+        std::array<std::array<production, terminal_count>, +nonterminal::_count> table;
+        for (auto& row : table)
+            row.fill(production::_count);
+        std::array<production, +nonterminal::_count> fallbacks;
+        fallbacks.fill(production::_count);
+
+        for (const grammar_rule& rule : grammar)
+        {
+            bool is_nullable;
+            terminal_set predict = grammar_sets.get_first(rule, 0, is_nullable);
+            if (is_nullable)
+            {
+                predict |= grammar_sets.follow[+rule.lhs];
+                fallbacks[+rule.lhs] = rule.id;
+            }
+            for (; predict; predict &= predict - 1)
+                table[+rule.lhs][std::countr_zero(predict)] = rule.id;
+        }
+
+        for (std::size_t n = 0; n < table.size(); ++n)
+            if (fallbacks[n] != production::_count)
+                for (production& cell : table[n])
+                    if (cell == production::_count)
+                        cell = fallbacks[n];
+        return table;
+    }();
+
+    static_assert([]
+    {
+        // Every terminal must predict at most one production for each nonterminal.
+        std::array<terminal_set, +nonterminal::_count> predicted{};
+        for (const grammar_rule& rule : grammar)
+        {
+            bool is_nullable;
+            terminal_set predict = grammar_sets.get_first(rule, 0, is_nullable);
+            if (is_nullable)
+                predict |= grammar_sets.follow[+rule.lhs];
+            if (predicted[+rule.lhs] & predict)
+                return false;
+            predicted[+rule.lhs] |= predict;
+        }
+        return true;
+    }(), "The grammar isn't LL(1).");
+
+    // Returns the production to parse the nonterminal with, or production::_count if there is none.
+    // terminal is the next token's type, or terminal_end if there are no more tokens.
+    [[nodiscard]] constexpr production predict(nonterminal nonterminal, std::uint8_t terminal) noexcept
+    {
+        return prediction_table[+nonterminal][terminal];
+    }
+} // namespace shl
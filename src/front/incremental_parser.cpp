@@ -0,0 +1,311 @@
+#include "incremental_parser.hpp"
+#include "common/ctype.hpp"
+#include "front/lexer.hpp"
+#include "front/parser.hpp"
+#include <algorithm>
+#include <cassert>
+#include <tuple>
+
+namespace shl
+{
+    incremental_parser::parsed_source::parsed_source(std::string&& source_code)
+        // Most edits only touch a single declaration, so don't give it a whole 1 MiB block.
+        : source_code(std::move(source_code)), allocator(std::clamp<std::size_t>(this->source_code.size() * 16, 4 * 1024, 1024 * 1024))
+    {
+    }
+
+    incremental_parser::incremental_parser(std::string_view source_code)
+    {
+        edit(0, 0, source_code);
+    }
+
+    bool incremental_parser::edit(std::size_t offset, std::size_t length, std::string_view replacement)
+    {
+        assert(offset + length <= size() && "Edited past the end of the source code.");
+
+        // Split off the chunks before the first one the edit touches, preferring the later chunk at a boundary,
+        // since that's the one the replacement gets prepended to.
+        auto [before, rest] = split(_root, count_ending_by(_root, offset));
+        if (rest == no_node && before != no_node)
+            std::tie(before, rest) = split(before, get_count(before) - 1);
+        std::size_t first_begin = get_size(before);
+
+        // Split off every chunk the edit touches, i.e. the first one and every one starting before the edit's end,
+        // and apply the edit to their source code.
+        std::size_t edit_end = offset + length - first_begin;
+        std::size_t touched_count = std::min(get_count(rest), edit_end ? 1 + count_ending_by(rest, edit_end - 1) : 1);
+        auto [touched, after] = split(rest, touched_count);
+        std::string source_code;
+        source_code.reserve(get_size(touched) + replacement.size());
+        free_nodes(touched, source_code);
+        source_code.replace(offset - first_begin, length, replacement);
+
+        // Re-parse the edited source code, appending the next chunks whenever it can't be parsed on its own.
+        // Appending twice as many chunks each time keeps unclosed comments and scopes linear instead of quadratic.
+        std::optional<std::vector<chunk>> chunks;
+        std::optional<compile_error> error;
+        for (std::size_t append_count = 1; ; append_count *= 2)
+        {
+            auto source = std::make_shared<parsed_source>(std::move(source_code));
+            bool needs_more = false;
+            error.reset();
+            chunks = parse(source, error, needs_more);
+            bool is_last = after == no_node;
+            if (is_last || (chunks ? is_separable(source->source_code) : !needs_more))
+            {
+                if (error)
+                {
+                    // Keep the source code as one chunk with the error, until an edit touches it.
+                    std::string_view view = source->source_code;
+                    auto newline_count = static_cast<std::uint32_t>(std::ranges::count(view, '\n'));
+                    auto last_line_length = static_cast<std::uint32_t>(view.size() - (view.rfind('\n') + 1));
+                    chunks.emplace().emplace_back(source, 0, static_cast<std::uint32_t>(view.size()), nullptr, newline_count, last_line_length, std::move(error));
+                }
+                break;
+            }
+            source_code = std::move(source->source_code);
+            auto [appended, rest_after] = split(after, append_count);
+            free_nodes(appended, source_code);
+            after = rest_after;
+        }
+
+        // Put the new chunks between the ones around them.
+        _root = merge(merge(before, add_nodes(std::move(*chunks))), after);
+        _is_program_stale = true;
+
+        return !error;
+    }
+
+    const node_program& incremental_parser::get_program() const
+    {
+        if (_is_program_stale)
+        {
+            _program.declarations.clear();
+            for_each_chunk(_root, [this](const chunk& chunk)
+            {
+                if (chunk.n_declaration)
+                    _program.declarations.push_back(chunk.n_declaration);
+            });
+            _is_program_stale = false;
+        }
+        return _program;
+    }
+
+    std::vector<compile_error> incremental_parser::get_errors() const
+    {
+        std::vector<compile_error> errors;
+        std::uint32_t line_number = 1;
+        std::uint32_t column_number = 0;
+        for_each_chunk(_root, [&](const chunk& chunk)
+        {
+            if (chunk.error)
+            {
+                // Only the first line of the chunk doesn't start at column 0.
+                compile_error& error = errors.emplace_back(*chunk.error);
+                if (error.line_number)
+                {
+                    if (error.line_number == 1)
+                        error.column_number += column_number;
+                    error.line_number += line_number - 1;
+                }
+            }
+            if (chunk.newline_count)
+            {
+                line_number += chunk.newline_count;
+                column_number = chunk.last_line_length;
+            }
+            else
+                column_number += chunk.last_line_length;
+        });
+        return errors;
+    }
+
+    std::string incremental_parser::get_source_code() const
+    {
+        std::string source_code;
+        source_code.reserve(size());
+        for_each_chunk(_root, [&source_code](const chunk& chunk) { source_code += chunk.get_source_code(); });
+        return source_code;
+    }
+
+    std::uint32_t incremental_parser::add_node(chunk&& chunk)
+    {
+        // Xorshift is plenty random for balancing.
+        _random_state ^= _random_state << 13;
+        _random_state ^= _random_state >> 17;
+        _random_state ^= _random_state << 5;
+
+        std::size_t chunk_size = chunk.end - chunk.begin;
+        chunk_node node{std::move(chunk), _random_state, no_node, no_node, chunk_size, 1};
+        if (_free_nodes.empty())
+        {
+            _nodes.push_back(std::move(node));
+            return static_cast<std::uint32_t>(_nodes.size() - 1);
+        }
+        std::uint32_t index = _free_nodes.back();
+        _free_nodes.pop_back();
+        _nodes[index] = std::move(node);
+        return index;
+    }
+
+    std::uint32_t incremental_parser::add_nodes(std::vector<chunk>&& chunks)
+    {
+        std::uint32_t tree = no_node;
+        for (chunk& chunk : chunks)
+            tree = merge(tree, add_node(std::move(chunk)));
+        return tree;
+    }
+
+    void incremental_parser::free_nodes(std::uint32_t tree, std::string& source_code)
+    {
+        if (tree == no_node)
+            return;
+        chunk_node& node = _nodes[tree];
+        free_nodes(node.left, source_code);
+        source_code += node.data.get_source_code();
+        // Release the chunk's source, so it's freed once no chunk uses it.
+        node.data.source.reset();
+        node.data.error.reset();
+        _free_nodes.push_back(tree);
+        free_nodes(node.right, source_code);
+    }
+
+    void incremental_parser::update(std::uint32_t node) noexcept
+    {
+        chunk_node& n = _nodes[node];
+        n.size = n.data.end - n.data.begin + get_size(n.left) + get_size(n.right);
+        n.count = 1 + get_count(n.left) + get_count(n.right);
+    }
+
+    std::uint32_t incremental_parser::merge(std::uint32_t left, std::uint32_t right) noexcept
+    {
+        if (left == no_node)
+            return right;
+        if (right == no_node)
+            return left;
+        if (_nodes[left].priority > _nodes[right].priority)
+        {
+            _nodes[left].right = merge(_nodes[left].right, right);
+            update(left);
+            return left;
+        }
+        _nodes[right].left = merge(left, _nodes[right].left);
+        update(right);
+        return right;
+    }
+
+    std::pair<std::uint32_t, std::uint32_t> incremental_parser::split(std::uint32_t tree, std::size_t count) noexcept
+    {
+        if (tree == no_node)
+            return {no_node, no_node};
+        chunk_node& node = _nodes[tree];
+        std::size_t left_count = get_count(node.left);
+        if (count <= left_count)
+        {
+            auto [left, right] = split(node.left, count);
+            _nodes[tree].left = right;
+            update(tree);
+            return {left, tree};
+        }
+        auto [left, right] = split(node.right, count - left_count - 1);
+        _nodes[tree].right = left;
+        update(tree);
+        return {tree, right};
+    }
+
+    std::size_t incremental_parser::count_ending_by(std::uint32_t tree, std::size_t offset) const noexcept
+    {
+        std::size_t count = 0;
+        while (tree != no_node)
+        {
+            const chunk_node& node = _nodes[tree];
+            std::size_t end = get_size(node.left) + node.data.end - node.data.begin;
+            if (end <= offset)
+            {
+                count += get_count(node.left) + 1;
+                offset -= end;
+                tree = node.right;
+            }
+            else
+                tree = node.left;
+        }
+        return count;
+    }
+
+    template <typename F>
+    void incremental_parser::for_each_chunk(std::uint32_t tree, F&& function) const
+    {
+        if (tree == no_node)
+            return;
+        for_each_chunk(_nodes[tree].left, function);
+        function(_nodes[tree].data);
+        for_each_chunk(_nodes[tree].right, function);
+    }
+
+    auto incremental_parser::parse(const std::shared_ptr<parsed_source>& source, std::optional<compile_error>& error, bool& needs_more) -> std::optional<std::vector<chunk>>
+    {
+        error_trap trap;
+        std::string_view source_code = source->source_code;
+        lexer lexer(source_code);
+        parser parser(token_source(lexer), source->allocator);
+        std::vector<parsed_declaration> declarations;
+        try
+        {
+            declarations = parser.parse_declarations();
+        }
+        catch (const compile_error& parse_error)
+        {
+            error = parse_error;
+            // A lexer error can only be fixed by more source code if it's at the end, i.e. an unclosed comment.
+            auto is_at_end = [&](const compile_error& lex_error)
+            {
+                return lexer.get_lines().get_line_begin(lex_error.line_number) + lex_error.column_number == source_code.size();
+            };
+            // A parser error can only be fixed by more source code if there are no tokens after it.
+            if (parse_error.stage == "Lexer")
+                needs_more = is_at_end(parse_error);
+            else try
+            {
+                needs_more = !lexer.next();
+            }
+            catch (const compile_error& lex_error)
+            {
+                needs_more = is_at_end(lex_error);
+            }
+            return std::nullopt;
+        }
+
+        // Split the source code at the start of each declaration, using the line starts the lexer found.
+        const line_index& lines = lexer.get_lines();
+        std::vector<chunk> chunks;
+        chunks.reserve(declarations.size());
+        auto add_chunk = [&](std::uint32_t begin, std::uint32_t end, node_declaration* n_declaration)
+        {
+            auto [begin_line_number, begin_column_number] = lines.locate(begin);
+            auto [end_line_number, end_column_number] = lines.locate(end);
+            std::uint32_t newline_count = end_line_number - begin_line_number;
+            chunks.emplace_back(source, begin, end, n_declaration, newline_count, newline_count ? end_column_number : end - begin, std::nullopt);
+        };
+        if (declarations.empty())
+        {
+            if (!source_code.empty())
+                add_chunk(0, static_cast<std::uint32_t>(source_code.size()), nullptr);
+        }
+        else for (std::size_t i = 0; i < declarations.size(); ++i)
+        {
+            // The first chunk also gets any leading trivia.
+            std::uint32_t begin = i ? declarations[i].offset : 0;
+            std::uint32_t end = i + 1 < declarations.size() ? declarations[i + 1].offset : static_cast<std::uint32_t>(source_code.size());
+            add_chunk(begin, end, declarations[i].n_declaration);
+        }
+        return chunks;
+    }
+
+    bool incremental_parser::is_separable(std::string_view source_code) noexcept
+    {
+        // Every chunk starts with an identifier, which an identifier or integer literal would absorb.
+        // A line comment would absorb the whole next line, so conservatively reject any '/' on the last line.
+        return source_code.empty() ||
+            (!is_identifier_rest(source_code.back()) && source_code.find('/', source_code.rfind('\n') + 1) == std::string_view::npos);
+    }
+} // namespace shl
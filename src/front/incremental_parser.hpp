@@ -0,0 +1,140 @@
+#pragma once
+
+#include "common/arena_allocator.hpp"
+#include "common/error.hpp"
+#include "middle/ast.hpp"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace shl
+{
+    // Keeps a source file lexed and parsed as it's edited, for editor tooling.
+    // The source code is split into chunks, one per top-level declaration, and an edit only
+    // re-lexes and re-parses the chunks it touches. The chunks are kept in a tree ordered by position,
+    // so finding and replacing them takes O(log n) time in the number of chunks.
+    // The program's declarations are only gathered again when it's next asked for, which takes O(n) time.
+    // Unlike the rest of the compiler, errors don't exit; the chunks with errors are left out of the program instead.
+    class incremental_parser
+    {
+    public:
+        [[nodiscard]] explicit incremental_parser(std::string_view source_code);
+
+        incremental_parser(const incremental_parser&) = delete;
+        incremental_parser(incremental_parser&&) = delete;
+        incremental_parser& operator=(const incremental_parser&) = delete;
+        incremental_parser& operator=(incremental_parser&&) = delete;
+
+        // Replaces source_code[offset, offset + length) with replacement.
+        // Returns false if the declarations around the edit no longer parse.
+        bool edit(std::size_t offset, std::size_t length, std::string_view replacement);
+
+        // Returns every top-level declaration without errors, in source order.
+        [[nodiscard]] const node_program& get_program() const;
+
+        // Returns every error, with locations in the whole source code.
+        [[nodiscard]] std::vector<compile_error> get_errors() const;
+
+        // Returns the whole edited source code. Takes time proportional to its size.
+        [[nodiscard]] std::string get_source_code() const;
+
+        [[nodiscard]] std::size_t size() const noexcept { return get_size(_root); }
+
+    private:
+        // The source code of one or more chunks which were parsed together, and their nodes.
+        struct parsed_source
+        {
+            [[nodiscard]] explicit parsed_source(std::string&& source_code);
+
+            std::string source_code;
+            arena_allocator allocator;
+        };
+
+        // A top-level declaration, from its first token up to the next one's, or the leading trivia of the file.
+        struct chunk
+        {
+            std::shared_ptr<const parsed_source> source;
+            // The chunk's characters are source->source_code[begin, end).
+            std::uint32_t begin;
+            std::uint32_t end;
+            // Nothing if the chunk is only trivia or has an error.
+            node_declaration* n_declaration;
+            std::uint32_t newline_count;
+            // The number of characters after the last newline, or all of them if there are none.
+            std::uint32_t last_line_length;
+            // The error, with a location relative to the start of the chunk.
+            std::optional<compile_error> error;
+
+            [[nodiscard]] std::string_view get_source_code() const noexcept
+            {
+                return std::string_view(source->source_code).substr(begin, end - begin);
+            }
+        };
+
+        // A chunk in the tree. The tree is a treap: it's ordered by position, and each node's priority
+        // is greater than its children's, which keeps it balanced with high probability.
+        struct chunk_node
+        {
+            chunk data;
+            std::uint32_t priority;
+            std::uint32_t left;
+            std::uint32_t right;
+            // The total size and number of the chunks in the subtree.
+            std::size_t size;
+            std::size_t count;
+        };
+
+        static constexpr std::uint32_t no_node = std::numeric_limits<std::uint32_t>::max();
+
+        // Returns a new node for the chunk, reusing a freed one if there is one.
+        [[nodiscard]] std::uint32_t add_node(chunk&& chunk);
+
+        // Returns the tree of every chunk, in order.
+        [[nodiscard]] std::uint32_t add_nodes(std::vector<chunk>&& chunks);
+
+        // Frees the tree's nodes, appending their source code in order.
+        void free_nodes(std::uint32_t tree, std::string& source_code);
+
+        // Recomputes the node's size and count from its chunk and children.
+        void update(std::uint32_t node) noexcept;
+
+        // Joins the trees, with every chunk of the left one before the right one's.
+        [[nodiscard]] std::uint32_t merge(std::uint32_t left, std::uint32_t right) noexcept;
+
+        // Splits the tree into its first count chunks and the rest.
+        [[nodiscard]] std::pair<std::uint32_t, std::uint32_t> split(std::uint32_t tree, std::size_t count) noexcept;
+
+        // Returns the number of chunks in the tree which end at or before the offset.
+        [[nodiscard]] std::size_t count_ending_by(std::uint32_t tree, std::size_t offset) const noexcept;
+
+        // Calls the function on each chunk of the tree, in order.
+        template <typename F>
+        void for_each_chunk(std::uint32_t tree, F&& function) const;
+
+        [[nodiscard]] std::size_t get_size(std::uint32_t tree) const noexcept { return tree == no_node ? 0 : _nodes[tree].size; }
+        [[nodiscard]] std::size_t get_count(std::uint32_t tree) const noexcept { return tree == no_node ? 0 : _nodes[tree].count; }
+
+        // Lexes and parses the source code into chunks.
+        // If it has an error, returns nothing, and whether or not the error may be fixed by appending more source code.
+        [[nodiscard]] static std::optional<std::vector<chunk>> parse(const std::shared_ptr<parsed_source>& source, std::optional<compile_error>& error, bool& needs_more);
+
+        // If the source code can be lexed separately from any chunk that may follow it.
+        [[nodiscard]] static bool is_separable(std::string_view source_code) noexcept;
+
+    private:
+        std::vector<chunk_node> _nodes;
+        std::vector<std::uint32_t> _free_nodes;
+        std::uint32_t _root = no_node;
+        // The state of the xorshift generator of the nodes' priorities.
+        std::uint32_t _random_state = 2463534242;
+
+        // The program, gathered from the chunks if they changed since.
+        mutable node_program _program;
+        mutable bool _is_program_stale = false;
+    };
+} // namespace shl
@@ -1,164 +1,249 @@
 #include "lexer.hpp"
 #include "common/error.hpp"
-#include "common/ctype.hpp"
+#include "common/ranged_enum.hpp"
+#include "front/lexer_scan.hpp"
+#include <array>
 
 namespace shl
 {
-    std::vector<token> lexer::operator()()
-    {
-        std::vector<token> tokens;
+    // Every byte of the source code is classified exactly once into one of these.
+    DEFINE_RANGED_ENUM(char_class,
+        (
+            invalid,    // Not allowed outside of comments.
+            space,      // Whitespace, excluding '\n'.
+            newline,    // '\n'
+            digit,      // [0-9]
+            identifier, // [A-Za-z_]
+            slash,      // '/', either division or the start of a comment.
+            asterisk,   // '*', either multiplication or part of a multi-line comment.
+            punctuator, // Any other single character token.
+            end         // Past the end of the source code.
+        ),
+        // Ranges
+        ()
+    );
 
-        while (peek())
-        {
-            if (try_consume_whitespace_and_comments()) continue;
-            else if (auto token_value = try_consume_integer_literal())
-                tokens.emplace_back(token_type::integer_literal_, line_number, get_column_count(), *token_value);
-            else if (auto token_value = try_consume_identifier())
-            {
-                     if (token_value == "return")  tokens.emplace_back(token_type::return_,  line_number, get_column_count());
-                else if (token_value == "if")      tokens.emplace_back(token_type::if_,      line_number, get_column_count());
-                else if (token_value == "elif")    tokens.emplace_back(token_type::elif_,    line_number, get_column_count());
-                else if (token_value == "else")    tokens.emplace_back(token_type::else_,    line_number, get_column_count());
-                else if (token_value == "while")   tokens.emplace_back(token_type::while_,   line_number, get_column_count());
-                else if (token_value == "dowhile") tokens.emplace_back(token_type::dowhile_, line_number, get_column_count());
-                else if (token_value == "in")      tokens.emplace_back(token_type::in_,      line_number, get_column_count());
-                else if (token_value == "out")     tokens.emplace_back(token_type::out_,     line_number, get_column_count());
-                else if (token_value == "inout")   tokens.emplace_back(token_type::inout_,   line_number, get_column_count());
-                else if (token_value == "copy")    tokens.emplace_back(token_type::copy_,    line_number, get_column_count());
-                else if (token_value == "move")    tokens.emplace_back(token_type::move_,    line_number, get_column_count());
-                else tokens.emplace_back(token_type::identifier_, line_number, get_column_count(), *token_value);
-            }
-            else if (try_consume_token('(')) tokens.emplace_back(token_type::open_parenthesis_,  line_number, get_column_count());
-            else if (try_consume_token(')')) tokens.emplace_back(token_type::close_parenthesis_, line_number, get_column_count());
-            else if (try_consume_token('{')) tokens.emplace_back(token_type::open_brace_,        line_number, get_column_count());
-            else if (try_consume_token('}')) tokens.emplace_back(token_type::close_brace_,       line_number, get_column_count());
-            else if (try_consume_token('[')) tokens.emplace_back(token_type::open_bracket_,      line_number, get_column_count());
-            else if (try_consume_token(']')) tokens.emplace_back(token_type::close_bracket_,     line_number, get_column_count());
-            else if (try_consume_token(':')) tokens.emplace_back(token_type::colon_,             line_number, get_column_count());
-            else if (try_consume_token(';')) tokens.emplace_back(token_type::semicolon_,         line_number, get_column_count());
-            else if (try_consume_token(',')) tokens.emplace_back(token_type::comma_,             line_number, get_column_count());
-            else if (try_consume_token('=')) tokens.emplace_back(token_type::equals_,            line_number, get_column_count());
-
-            else if (try_consume_token('/')) tokens.emplace_back(token_type::forward_slash_, line_number, get_column_count());
-            else if (try_consume_token('%')) tokens.emplace_back(token_type::percent_,       line_number, get_column_count());
-            else if (try_consume_token('*')) tokens.emplace_back(token_type::asterisk_,      line_number, get_column_count());
-            else if (try_consume_token('+')) tokens.emplace_back(token_type::plus_,          line_number, get_column_count());
-            else if (try_consume_token('-')) tokens.emplace_back(token_type::minus_,         line_number, get_column_count());
-
-            else error_exit("Lexer", "Invalid character", line_number, get_column_count());
-        }
+    // The states of the lexer's DFA, i.e. what has been consumed since the start of the current token.
+    DEFINE_RANGED_ENUM(lexer_state,
+        (
+            start,
+            space,
+            integer_literal,
+            identifier,
+            punctuator,
+            slash,
+            line_comment,
+            block_comment,
+            block_comment_asterisk,
+            block_comment_end,
 
-        reset();
-        line_number = 1;
-        return tokens;
-    }
+            // Correspondence: Not states, only transition results.
 
-    bool lexer::try_consume_whitespace_and_comments()
-    {
-        if (*peek() == '\n')
-        {
-            consume();
-            on_newline();
-            return true;
-        }
-        if (try_consume_token(&is_space, &is_space))
-            return true;
-        if (try_consume_token("//"))
-        {
-            // Consume the rest of the line.
-            (void)try_consume_token(&is_not_line_ending, &is_not_line_ending);
-            // Consume the line ending.
-            if (try_consume_token(&is_space, &is_space))
-                on_newline();
-            return true;
-        }
-        if (try_consume_token("/*"))
-        {
-            char looking_for = '*';
-            while (auto c = peek())
-            {
-                if (*c == '\n')
-                    on_newline();
-                consume();
-                if (*c == looking_for)
-                {
-                    if (looking_for == '*')
-                        looking_for = '/';
-                    else // the end of the multi-line comment has been found
-                        return true;
-                }
-                else // reset what we're looking for.
-                    looking_for = '*';
-            }
-            // there is no end to the multi-line comment.
-            error_exit("Lexer", "Multi-line comment never closed. Expected \"*/\"", line_number, get_column_count());
-        }
-        return false;
-    }
+            done,  // The current token ends before the current character.
+            error  // The current character can neither start nor continue a token.
+        ),
+        // Ranges
+        ()
+    );
 
-    std::optional<std::string_view> lexer::try_consume_integer_literal()
+    static constexpr auto char_classes = []
     {
-        return try_consume_token(&is_digit_10, &is_digit_10);
-    }
+        std::array<char_class, 256> classes{}; // Everything is invalid by default.
+        for (char c : std::string_view(" \t\v\f\r"))
+            classes[static_cast<std::uint8_t>(c)] = char_class::space;
+        classes['\n'] = char_class::newline;
+        for (char c = '0'; c <= '9'; ++c)
+            classes[c] = char_class::digit;
+        for (char c = 'a'; c <= 'z'; ++c)
+            classes[c] = char_class::identifier;
+        for (char c = 'A'; c <= 'Z'; ++c)
+            classes[c] = char_class::identifier;
+        classes['_'] = char_class::identifier;
+        for (char c : std::string_view("(){}[]:;,=%+-"))
+            classes[static_cast<std::uint8_t>(c)] = char_class::punctuator;
+        classes['/'] = char_class::slash;
+        classes['*'] = char_class::asterisk;
+        return classes;
+    }();
 
-    std::optional<std::string_view> lexer::try_consume_identifier()
+    // The token type of each character classified as char_class::punctuator or char_class::asterisk.
+    static constexpr auto punctuator_types = []
     {
-        return try_consume_token(&is_identifier_first, &is_identifier_rest);
-    }
+        std::array<token_type, 256> types{};
+        types['('] = token_type::open_parenthesis_;
+        types[')'] = token_type::close_parenthesis_;
+        types['{'] = token_type::open_brace_;
+        types['}'] = token_type::close_brace_;
+        types['['] = token_type::open_bracket_;
+        types[']'] = token_type::close_bracket_;
+        types[':'] = token_type::colon_;
+        types[';'] = token_type::semicolon_;
+        types[','] = token_type::comma_;
+        types['='] = token_type::equals_;
+        types['%'] = token_type::percent_;
+        types['*'] = token_type::asterisk_;
+        types['+'] = token_type::plus_;
+        types['-'] = token_type::minus_;
+        return types;
+    }();
 
-    std::optional<std::string_view> lexer::try_consume_token(token_pred first_pred, token_pred rest_pred)
+    // transitions[state][char_class] is the state after consuming a character of that class.
+    static constexpr auto transitions = []
     {
-        if (first_pred(*peek())) // guaranteed to be valid.
-        {
-            std::size_t i = 1;
-            for (auto c = peek(i); c && rest_pred(*c); ++i, c = peek(i));
+        using enum lexer_state;
+        std::array<std::array<lexer_state, +char_class::_count>, +done> table{};
+        auto set = [&table](lexer_state from, char_class c, lexer_state to) { table[+from][+c] = to; };
+        auto set_all = [&table](lexer_state from, lexer_state to) { table[+from].fill(to); };
 
-            auto token_begin_it = consume(i);
-            auto token_end_it = iterator();
-            return std::string_view(token_begin_it, token_end_it);
-        }
-        return std::nullopt;
-    }
+        set_all(start, error);
+        set(start, char_class::space, space);
+        set(start, char_class::newline, space);
+        set(start, char_class::digit, integer_literal);
+        set(start, char_class::identifier, identifier);
+        set(start, char_class::slash, slash);
+        set(start, char_class::asterisk, punctuator);
+        set(start, char_class::punctuator, punctuator);
+
+        set_all(space, done);
+        set(space, char_class::space, space);
+        set(space, char_class::newline, space);
+
+        set_all(integer_literal, done);
+        set(integer_literal, char_class::digit, integer_literal);
+
+        set_all(identifier, done);
+        set(identifier, char_class::digit, identifier);
+        set(identifier, char_class::identifier, identifier);
 
-    std::optional<std::string_view> lexer::try_consume_token(token_pred char_pred)
+        set_all(punctuator, done);
+
+        set_all(slash, done);
+        set(slash, char_class::slash, line_comment);
+        set(slash, char_class::asterisk, block_comment);
+
+        set_all(line_comment, line_comment);
+        set(line_comment, char_class::newline, done);
+        set(line_comment, char_class::end, done);
+
+        set_all(block_comment, block_comment);
+        set(block_comment, char_class::asterisk, block_comment_asterisk);
+        set(block_comment, char_class::end, error);
+
+        set_all(block_comment_asterisk, block_comment);
+        set(block_comment_asterisk, char_class::asterisk, block_comment_asterisk);
+        set(block_comment_asterisk, char_class::slash, block_comment_end);
+        set(block_comment_asterisk, char_class::end, error);
+
+        set_all(block_comment_end, done);
+
+        return table;
+    }();
+
+    lexer::lexer(std::string_view source_code, const lexer_scanner& scanner) : _chars(source_code), _scanner(&scanner)
     {
-        if (char_pred(*peek())) // guaranteed to be valid.
-        {
-            auto token_begin_it = consume();
-            auto token_end_it = iterator();
-            return std::string_view(token_begin_it, token_end_it);
-        }
-        return std::nullopt;
+        // Tokens only have 32 bits for their offsets.
+        if (source_code.size() > UINT32_MAX)
+            error_exit("Lexer", "Source code is larger than 4 GiB");
     }
 
-    std::optional<std::string_view> lexer::try_consume_token(std::string_view wanted)
+    token_buffer lexer::operator()()
     {
-        std::size_t i = 0;
-        for (auto c = peek(i); c && i < wanted.size() && c == wanted[i]; ++i, c = peek(i));
-        if (i == wanted.size())
-        {
-            auto token_begin_it = consume(i);
-            auto token_end_it = iterator();
-            return std::string_view(token_begin_it, token_end_it);
-        }
-        return std::nullopt;
+        token_buffer tokens;
+        while (auto t = next())
+            tokens.push_back(*t);
+        return tokens;
     }
 
-    std::optional<std::string_view> lexer::try_consume_token(char wanted)
+    std::optional<token> lexer::next()
     {
-        static thread_local char c_wanted; // thread_local for future proofing.
-        c_wanted = wanted;
-        return try_consume_token([](char c) { return c == c_wanted; });
+        if (token t; next(t))
+            return t;
+        return std::nullopt;
     }
 
-    void lexer::on_newline()
+    bool lexer::next(token& token)
     {
-        ++line_number;
-        column_iterator = iterator();
+        // The kernel that skips the rest of each state's run of characters, if it has one.
+        static constexpr auto scanners = []
+        {
+            std::array<lexer_scan_function lexer_scanner::*, +lexer_state::done> scanners{};
+            scanners[+lexer_state::space] = &lexer_scanner::skip_space;
+            scanners[+lexer_state::integer_literal] = &lexer_scanner::skip_digits;
+            scanners[+lexer_state::identifier] = &lexer_scanner::skip_identifier;
+            scanners[+lexer_state::line_comment] = &lexer_scanner::skip_line_comment;
+            scanners[+lexer_state::block_comment] = &lexer_scanner::skip_block_comment;
+            return scanners;
+        }();
+        const lexer_scanner& scanner = *_scanner;
+
+        // Work on a copy of the cursor so it stays in registers, and only commit it once a token is lexed.
+        cursor<char> chars = _chars;
+
+        while (!chars.is_at_end())
+        {
+            // Run the DFA until the current token ends.
+            const std::size_t token_begin = chars.position();
+            lexer_state state = lexer_state::start;
+            while (true)
+            {
+                const char* current = chars.peek();
+                char_class c = current ? char_classes[static_cast<std::uint8_t>(*current)] : char_class::end;
+                lexer_state next_state = transitions[+state][+c];
+                if (next_state == lexer_state::done)
+                    break;
+                if (next_state == lexer_state::error)
+                {
+                    auto [line_number, column_number] = _lines.locate(chars.position());
+                    if (state == lexer_state::start)
+                        error_exit("Lexer", "Invalid character", line_number, column_number);
+                    // The only other way to error is to reach the end inside a multi-line comment.
+                    error_exit("Lexer", "Multi-line comment never closed. Expected \"*/\"", line_number, column_number);
+                }
+                if (c == char_class::newline)
+                    _lines.add_line(chars.position() + 1);
+                state = next_state;
+                chars.consume();
+                if (auto scan = scanners[+state])
+                    chars.seek((scanner.*scan)(chars.data(), chars.position(), chars.size(), _lines));
+            }
+
+            // Write the token, if any.
+            token.offset = static_cast<std::uint32_t>(token_begin);
+            token.length = static_cast<std::uint32_t>(chars.position() - token_begin);
+            token.symbol = symbol_id::empty;
+            switch (state)
+            {
+            case lexer_state::integer_literal:
+                token.type = token_type::integer_literal_;
+                break;
+            case lexer_state::identifier:
+            {
+                std::string_view value(chars.data() + token_begin, token.length);
+                token.type = get_identifier_type(value);
+                if (token.type == token_type::identifier_)
+                    token.symbol = get_interner().intern(value);
+                break;
+            }
+            case lexer_state::punctuator:
+                token.type = punctuator_types[static_cast<std::uint8_t>(chars.data()[token_begin])];
+                break;
+            case lexer_state::slash:
+                token.type = token_type::forward_slash_;
+                break;
+            default: // Whitespace and comments.
+                continue;
+            }
+            _chars = chars;
+            return true;
+        }
+
+        _chars = chars;
+        return false;
     }
 
-    std::uint32_t lexer::get_column_count()
+    void lexer::reset() noexcept
     {
-        return iterator() - column_iterator;
+        _chars.reset();
+        _lines.clear();
     }
 } // namespace shl
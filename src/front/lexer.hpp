@@ -1,38 +1,53 @@
 #pragma once
 
-#include "common/consumer.hpp"
+#include "common/cursor.hpp"
+#include "front/lexer_scan.hpp"
+#include "front/line_index.hpp"
 #include "front/token.hpp"
 #include <optional>
-#include <string>
-#include <vector>
+#include <string_view>
 
 namespace shl
 {
-    class lexer : consumer<std::string>
+    // Tokens view the source code directly, so it must outlive the lexer and all its tokens.
+    class lexer
     {
     public:
-        [[nodiscard]] explicit lexer(const std::string& source_code) noexcept : consumer<std::string>(source_code) {}
-        [[nodiscard]] explicit lexer(std::string&& source_code) noexcept : consumer<std::string>(std::move(source_code)) {}
+        // Runs of characters are skipped with the scanner, which is the fastest one the CPU supports unless given.
+        [[nodiscard]] explicit lexer(std::string_view source_code, const lexer_scanner& scanner = get_lexer_scanner());
 
-        [[nodiscard]] std::vector<token> operator()();
+        // Lexes all the remaining tokens at once.
+        [[nodiscard]] token_buffer operator()();
 
-    private:
-        [[nodiscard]] bool try_consume_whitespace_and_comments();
-        [[nodiscard]] std::optional<std::string_view> try_consume_integer_literal();
-        [[nodiscard]] std::optional<std::string_view> try_consume_identifier();
+        // Lexes only the next token, if there is one.
+        [[nodiscard]] std::optional<token> next();
 
-        using token_pred = bool(*)(char);
-        [[nodiscard]] std::optional<std::string_view> try_consume_token(token_pred first_pred, token_pred rest_pred);
-        [[nodiscard]] std::optional<std::string_view> try_consume_token(token_pred char_pred);
-        [[nodiscard]] std::optional<std::string_view> try_consume_token(std::string_view wanted);
-        [[nodiscard]] std::optional<std::string_view> try_consume_token(char wanted);
+        // Lexes only the next token into token, and returns if there was one.
+        // Lets a ring_cursor pull tokens straight into its window.
+        [[nodiscard]] bool next(token& token);
 
-    private:
-        void on_newline();
-        std::uint32_t get_column_count();
+        // Resets the lexer so its ready to lex from the start again.
+        void reset() noexcept;
+
+        // Returns the token's characters in the source code.
+        [[nodiscard]] std::string_view get_value(const token& token) const noexcept
+        {
+            return std::string_view(_chars.data() + token.offset, token.length);
+        }
+
+        // Returns the location just past the token's last character.
+        // Only valid for tokens this lexer has lexed since it was last reset.
+        [[nodiscard]] source_location get_location(const token& token) const noexcept
+        {
+            return _lines.locate(token.offset + token.length);
+        }
+
+        [[nodiscard]] const line_index& get_lines() const noexcept { return _lines; }
 
     private:
-        std::uint32_t line_number = 1;
-        const_iterator column_iterator;
+        cursor<char> _chars;
+        const lexer_scanner* _scanner;
+        // The start of each line lexed thus far.
+        line_index _lines;
     };
 } // namespace shl
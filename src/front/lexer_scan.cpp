@@ -0,0 +1,322 @@
+#include "lexer_scan.hpp"
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SHL_LEXER_SCAN_X86 1
+#else
+#define SHL_LEXER_SCAN_X86 0
+#endif
+
+namespace shl
+{
+    // Scalar kernels, used for the tails of the vectorized kernels and on CPUs without SSE4.2.
+
+    static constexpr bool is_scan_space(char c) noexcept
+    {
+        return c == ' ' || static_cast<std::uint8_t>(c - '\t') <= '\r' - '\t';
+    }
+
+    static constexpr bool is_scan_digit(char c) noexcept
+    {
+        return static_cast<std::uint8_t>(c - '0') <= 9;
+    }
+
+    static constexpr bool is_scan_identifier(char c) noexcept
+    {
+        return static_cast<std::uint8_t>((c | 0x20) - 'a') < 26 || is_scan_digit(c) || c == '_';
+    }
+
+    static std::size_t skip_space_scalar(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        for (; position < size && is_scan_space(source[position]); ++position)
+            if (source[position] == '\n')
+                lines.add_line(position + 1);
+        return position;
+    }
+
+    static std::size_t skip_line_comment_scalar(const char* source, std::size_t position, std::size_t size, line_index&)
+    {
+        auto newline = static_cast<const char*>(std::memchr(source + position, '\n', size - position));
+        return newline ? newline - source : size;
+    }
+
+    static std::size_t skip_block_comment_scalar(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        for (; position < size; ++position)
+        {
+            if (source[position] == '*' && position + 1 < size && source[position + 1] == '/')
+                break;
+            if (source[position] == '\n')
+                lines.add_line(position + 1);
+        }
+        return position;
+    }
+
+    static std::size_t skip_identifier_scalar(const char* source, std::size_t position, std::size_t size, line_index&)
+    {
+        while (position < size && is_scan_identifier(source[position]))
+            ++position;
+        return position;
+    }
+
+    static std::size_t skip_digits_scalar(const char* source, std::size_t position, std::size_t size, line_index&)
+    {
+        while (position < size && is_scan_digit(source[position]))
+            ++position;
+        return position;
+    }
+
+    static constexpr lexer_scanner scalar_scanner
+    {
+        &skip_space_scalar,
+        &skip_line_comment_scalar,
+        &skip_block_comment_scalar,
+        &skip_identifier_scalar,
+        &skip_digits_scalar,
+    };
+
+#if SHL_LEXER_SCAN_X86
+    // Adds the lines after the newlines set in newline_mask, whose bit i corresponds to source[base + i].
+    static inline void add_lines(std::uint32_t newline_mask, std::size_t base, line_index& lines)
+    {
+        for (; newline_mask; newline_mask &= newline_mask - 1)
+            lines.add_line(base + __builtin_ctz(newline_mask) + 1);
+    }
+
+    // Returns a mask of the low count bits, where count is at most 32.
+    static inline std::uint32_t low_bits(unsigned count) noexcept
+    {
+        return count < 32 ? (1u << count) - 1 : ~0u;
+    }
+
+    // SSE4.2 kernels, 16 bytes at a time.
+
+    // Each pair of characters is an inclusive range for _SIDD_CMP_RANGES.
+    alignas(16) static constexpr char space_ranges[16] = "\t\r  ";
+    alignas(16) static constexpr char identifier_ranges[16] = "azAZ09__";
+    alignas(16) static constexpr char digit_ranges[16] = "09";
+    alignas(16) static constexpr char block_comment_end[16] = "*/";
+
+    static constexpr int sse_first_outside_ranges = _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT;
+
+    __attribute__((target("sse4.2")))
+    static std::size_t skip_space_sse42(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        const __m128i ranges = _mm_load_si128(reinterpret_cast<const __m128i*>(space_ranges));
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; position + 16 <= size; position += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + position));
+            int length = _mm_cmpestri(ranges, 4, chunk, 16, sse_first_outside_ranges);
+            std::uint32_t newline_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)) & low_bits(length);
+            add_lines(newline_mask, position, lines);
+            if (length < 16)
+                return position + length;
+        }
+        return skip_space_scalar(source, position, size, lines);
+    }
+
+    __attribute__((target("sse4.2")))
+    static std::size_t skip_line_comment_sse42(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; position + 16 <= size; position += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + position));
+            if (std::uint32_t newline_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)))
+                return position + __builtin_ctz(newline_mask);
+        }
+        return skip_line_comment_scalar(source, position, size, lines);
+    }
+
+    __attribute__((target("sse4.2")))
+    static std::size_t skip_block_comment_sse42(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        const __m128i needle = _mm_load_si128(reinterpret_cast<const __m128i*>(block_comment_end));
+        const __m128i newline = _mm_set1_epi8('\n');
+        while (position + 16 <= size)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + position));
+            // The index of the first full match, or 15 for a partial match of '*' in the last byte, or 16 for no match.
+            int length = _mm_cmpestri(needle, 2, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ORDERED | _SIDD_LEAST_SIGNIFICANT);
+            std::uint32_t newline_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)) & low_bits(length);
+            add_lines(newline_mask, position, lines);
+            if (length < 15)
+                return position + length;
+            // Let a partial match be checked again at the start of the next chunk.
+            position += length;
+        }
+        return skip_block_comment_scalar(source, position, size, lines);
+    }
+
+    __attribute__((target("sse4.2")))
+    static std::size_t skip_identifier_sse42(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        const __m128i ranges = _mm_load_si128(reinterpret_cast<const __m128i*>(identifier_ranges));
+        for (; position + 16 <= size; position += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + position));
+            if (int length = _mm_cmpestri(ranges, 8, chunk, 16, sse_first_outside_ranges); length < 16)
+                return position + length;
+        }
+        return skip_identifier_scalar(source, position, size, lines);
+    }
+
+    __attribute__((target("sse4.2")))
+    static std::size_t skip_digits_sse42(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        const __m128i ranges = _mm_load_si128(reinterpret_cast<const __m128i*>(digit_ranges));
+        for (; position + 16 <= size; position += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + position));
+            if (int length = _mm_cmpestri(ranges, 2, chunk, 16, sse_first_outside_ranges); length < 16)
+                return position + length;
+        }
+        return skip_digits_scalar(source, position, size, lines);
+    }
+
+    static constexpr lexer_scanner sse42_scanner
+    {
+        &skip_space_sse42,
+        &skip_line_comment_sse42,
+        &skip_block_comment_sse42,
+        &skip_identifier_sse42,
+        &skip_digits_sse42,
+    };
+
+    // AVX2 kernels, 32 bytes at a time.
+
+    // Returns a mask of the bytes in chunk which are in the inclusive range [low, high].
+    __attribute__((target("avx2")))
+    static inline __m256i in_range_avx2(__m256i chunk, char low, char high) noexcept
+    {
+        __m256i offset = _mm256_sub_epi8(chunk, _mm256_set1_epi8(low));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(high - low)), offset);
+    }
+
+    __attribute__((target("avx2")))
+    static inline std::uint32_t movemask_avx2(__m256i mask) noexcept
+    {
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(mask));
+    }
+
+    __attribute__((target("avx2")))
+    static std::size_t skip_space_avx2(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        for (; position + 32 <= size; position += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + position));
+            __m256i space = _mm256_or_si256(in_range_avx2(chunk, '\t', '\r'), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')));
+            std::uint32_t others = ~movemask_avx2(space);
+            unsigned length = others ? __builtin_ctz(others) : 32;
+            std::uint32_t newline_mask = movemask_avx2(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))) & low_bits(length);
+            add_lines(newline_mask, position, lines);
+            if (others)
+                return position + length;
+        }
+        return skip_space_sse42(source, position, size, lines);
+    }
+
+    __attribute__((target("avx2")))
+    static std::size_t skip_line_comment_avx2(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        for (; position + 32 <= size; position += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + position));
+            if (std::uint32_t newline_mask = movemask_avx2(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))))
+                return position + __builtin_ctz(newline_mask);
+        }
+        return skip_line_comment_sse42(source, position, size, lines);
+    }
+
+    __attribute__((target("avx2")))
+    static std::size_t skip_block_comment_avx2(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        // Compare 32 bytes against '*' and the 32 bytes after each against '/', so 33 bytes must be readable.
+        for (; position + 33 <= size; position += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + position));
+            __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + position + 1));
+            std::uint32_t end_mask = movemask_avx2(_mm256_and_si256(
+                _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('*')),
+                _mm256_cmpeq_epi8(next, _mm256_set1_epi8('/'))));
+            unsigned length = end_mask ? __builtin_ctz(end_mask) : 32;
+            std::uint32_t newline_mask = movemask_avx2(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))) & low_bits(length);
+            add_lines(newline_mask, position, lines);
+            if (end_mask)
+                return position + length;
+        }
+        return skip_block_comment_sse42(source, position, size, lines);
+    }
+
+    __attribute__((target("avx2")))
+    static std::size_t skip_identifier_avx2(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        for (; position + 32 <= size; position += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + position));
+            __m256i letter = in_range_avx2(_mm256_or_si256(chunk, _mm256_set1_epi8(0x20)), 'a', 'z');
+            __m256i digit = in_range_avx2(chunk, '0', '9');
+            __m256i underscore = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_'));
+            std::uint32_t others = ~movemask_avx2(_mm256_or_si256(_mm256_or_si256(letter, digit), underscore));
+            if (others)
+                return position + __builtin_ctz(others);
+        }
+        return skip_identifier_sse42(source, position, size, lines);
+    }
+
+    __attribute__((target("avx2")))
+    static std::size_t skip_digits_avx2(const char* source, std::size_t position, std::size_t size, line_index& lines)
+    {
+        for (; position + 32 <= size; position += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + position));
+            if (std::uint32_t others = ~movemask_avx2(in_range_avx2(chunk, '0', '9')))
+                return position + __builtin_ctz(others);
+        }
+        return skip_digits_sse42(source, position, size, lines);
+    }
+
+    static constexpr lexer_scanner avx2_scanner
+    {
+        &skip_space_avx2,
+        &skip_line_comment_avx2,
+        &skip_block_comment_avx2,
+        &skip_identifier_avx2,
+        &skip_digits_avx2,
+    };
+#endif
+
+    const lexer_scanner& get_lexer_scanner() noexcept
+    {
+#if SHL_LEXER_SCAN_X86
+        static const lexer_scanner& scanner = []() -> const lexer_scanner&
+        {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2"))
+                return avx2_scanner;
+            if (__builtin_cpu_supports("sse4.2"))
+                return sse42_scanner;
+            return scalar_scanner;
+        }();
+        return scanner;
+#else
+        return scalar_scanner;
+#endif
+    }
+
+    std::span<const lexer_scanner* const> get_lexer_scanners() noexcept
+    {
+#if SHL_LEXER_SCAN_X86
+        static constexpr const lexer_scanner* scanners[]{&scalar_scanner, &sse42_scanner, &avx2_scanner};
+        // The same checks as get_lexer_scanner, which initializes the CPU's features.
+        const lexer_scanner& fastest = get_lexer_scanner();
+        std::size_t count = &fastest == &avx2_scanner ? 3 : &fastest == &sse42_scanner ? 2 : 1;
+        return std::span(scanners, count);
+#else
+        static constexpr const lexer_scanner* scanners[]{&scalar_scanner};
+        return scanners;
+#endif
+    }
+} // namespace shl
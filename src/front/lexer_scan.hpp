@@ -0,0 +1,33 @@
+#pragma once
+
+#include "front/line_index.hpp"
+#include <cstddef>
+#include <span>
+
+namespace shl
+{
+    // Skips a run of characters starting at position, and returns the position of the first character not in the run.
+    // Runs that may span lines add the start of each line after a newline they skip to lines.
+    using lexer_scan_function = std::size_t(*)(const char* source, std::size_t position, std::size_t size, line_index& lines);
+
+    // Vectorized kernels for the runs of characters which make up most of a source file.
+    struct lexer_scanner
+    {
+        // Whitespace, including newlines.
+        lexer_scan_function skip_space;
+        // Everything up to, but not including, the next '\n'.
+        lexer_scan_function skip_line_comment;
+        // Everything up to, but not including, the next "*/".
+        lexer_scan_function skip_block_comment;
+        // [A-Za-z0-9_]
+        lexer_scan_function skip_identifier;
+        // [0-9]
+        lexer_scan_function skip_digits;
+    };
+
+    // Returns the fastest scanner the running CPU supports (AVX2, then SSE4.2, then scalar).
+    [[nodiscard]] const lexer_scanner& get_lexer_scanner() noexcept;
+
+    // Returns every scanner the running CPU supports, scalar first, so they can be checked against each other.
+    [[nodiscard]] std::span<const lexer_scanner* const> get_lexer_scanners() noexcept;
+} // namespace shl
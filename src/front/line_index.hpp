@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace shl
+{
+    struct source_location
+    {
+        std::uint32_t line_number;
+        std::uint32_t column_number;
+    };
+
+    // The offset of the start of each line in a source file, so locations are only computed when needed.
+    class line_index
+    {
+    public:
+        [[nodiscard]] line_index() : _line_begins{0} {}
+
+        // Adds a line starting at line_begin, which must be after all other lines' starts.
+        void add_line(std::size_t line_begin)
+        {
+            _line_begins.push_back(static_cast<std::uint32_t>(line_begin));
+        }
+
+        // Returns the line and column of the character at offset.
+        // Lines are numbered from 1, and columns from 0.
+        [[nodiscard]] source_location locate(std::size_t offset) const noexcept
+        {
+            auto it = std::ranges::upper_bound(_line_begins, offset); // Never the first line's start.
+            return
+            {
+                static_cast<std::uint32_t>(it - _line_begins.begin()),
+                static_cast<std::uint32_t>(offset - *std::prev(it))
+            };
+        }
+
+        // Returns the offset of the start of the line, numbered from 1.
+        [[nodiscard]] std::uint32_t get_line_begin(std::uint32_t line_number) const noexcept
+        {
+            return _line_begins[line_number - 1];
+        }
+
+        [[nodiscard]] std::uint32_t get_line_count() const noexcept
+        {
+            return static_cast<std::uint32_t>(_line_begins.size());
+        }
+
+        // Removes all but the first line.
+        void clear() noexcept
+        {
+            _line_begins.resize(1);
+        }
+
+    private:
+        std::vector<std::uint32_t> _line_begins;
+    };
+} // namespace shl
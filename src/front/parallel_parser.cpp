@@ -0,0 +1,136 @@
+#include "parallel_parser.hpp"
+#include "common/error.hpp"
+#include "common/thread_pool.hpp"
+#include "front/parser.hpp"
+#include "front/token_stream.hpp"
+#include <atomic>
+
+namespace shl
+{
+    parallel_parser::parallel_parser(lexer& lexer) : _lexer(lexer)
+    {
+        _allocators.push_back(std::make_unique<arena_allocator>(1024 * 1024)); // 1 MiB first block.
+    }
+
+    node_program* parallel_parser::operator()()
+    {
+        // Lex everything up front, so declarations can be found without parsing them.
+        // Errors are left for the serial parse to report, in case there's a parser error before them.
+        bool has_lexer_error = false;
+        {
+            error_trap trap;
+            try
+            {
+                for (token t; _lexer.next(t); )
+                    _tokens.push_back(t);
+            }
+            catch (const compile_error&)
+            {
+                has_lexer_error = true;
+            }
+        }
+        if (has_lexer_error)
+            return parse_serially();
+
+        // Only spin up the thread pool if there's enough work for more than one thread.
+        thread_pool* pool = _tokens.size() >= 2 * min_batch_size ? &get_thread_pool() : nullptr;
+        std::size_t thread_count = pool ? pool->get_thread_count() : 1;
+        std::vector<std::size_t> batch_begins = split(std::max(min_batch_size, _tokens.size() / (thread_count * batches_per_thread)));
+        std::size_t batch_count = batch_begins.size() - 1;
+        if (!batch_count)
+            return parse_serially();
+
+        while (_allocators.size() < thread_count)
+            _allocators.push_back(std::make_unique<arena_allocator>(1024 * 1024)); // 1 MiB first block.
+
+        // The batches are parsed speculatively, so remember where to rewind the arenas to if they have to be thrown away.
+        std::vector<arena_allocator::checkpoint> checkpoints;
+        checkpoints.reserve(thread_count);
+        for (std::size_t i = 0; i < thread_count; ++i)
+            checkpoints.push_back(_allocators[i]->get_checkpoint());
+
+        std::vector<std::vector<parsed_declaration>> batches(batch_count);
+        std::atomic<bool> has_error = false;
+        auto parse_batch = [&](std::size_t batch_index, std::size_t thread_index)
+        {
+            if (has_error.load(std::memory_order_relaxed))
+                return;
+            error_trap trap;
+            try
+            {
+                token_source source(_lexer, _tokens, batch_begins[batch_index], batch_begins[batch_index + 1]);
+                parser parser(source, *_allocators[thread_index]);
+                batches[batch_index] = parser.parse_declarations();
+            }
+            catch (const compile_error&)
+            {
+                has_error.store(true, std::memory_order_relaxed);
+            }
+        };
+        if (pool)
+            pool->run(batch_count, parse_batch);
+        else for (std::size_t i = 0; i < batch_count; ++i)
+            parse_batch(i, 0);
+
+        // The split is only a guess for invalid programs, so find the real error serially.
+        if (has_error.load(std::memory_order_relaxed))
+        {
+            for (std::size_t i = 0; i < thread_count; ++i)
+                _allocators[i]->rewind(checkpoints[i]);
+            return parse_serially();
+        }
+
+        // Stitch the batches together in source order.
+        arena_allocator& allocator = *_allocators.front();
+        auto n_program = allocator.allocate<node_program>(allocator.make_vector<node_declaration*>());
+        std::size_t declaration_count = 0;
+        for (auto& batch : batches)
+            declaration_count += batch.size();
+        n_program->declarations.reserve(declaration_count);
+        for (auto& batch : batches)
+            for (auto& declaration : batch)
+                n_program->declarations.push_back(declaration.n_declaration);
+        return n_program;
+    }
+
+    std::vector<std::size_t> parallel_parser::split(std::size_t batch_size) const
+    {
+        // Top-level declarations end with a ';' or '}' outside of any brackets.
+        std::vector<std::size_t> batch_begins{0};
+        std::size_t depth = 0;
+        for (std::size_t i = 0; i < _tokens.size(); ++i)
+        {
+            switch (_tokens.get_type(i))
+            {
+            case token_type::open_parenthesis_:
+            case token_type::open_bracket_:
+            case token_type::open_brace_:
+                ++depth;
+                break;
+            case token_type::close_parenthesis_:
+            case token_type::close_bracket_:
+                depth -= depth != 0;
+                break;
+            case token_type::close_brace_:
+                depth -= depth != 0;
+                [[fallthrough]];
+            case token_type::semicolon_:
+                if (!depth && i + 1 - batch_begins.back() >= batch_size)
+                    batch_begins.push_back(i + 1);
+                break;
+            default:
+                break;
+            }
+        }
+        if (batch_begins.back() != _tokens.size())
+            batch_begins.push_back(_tokens.size());
+        return batch_begins;
+    }
+
+    node_program* parallel_parser::parse_serially()
+    {
+        _lexer.reset();
+        parser parser(token_source(_lexer), *_allocators.front());
+        return parser();
+    }
+} // namespace shl
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common/arena_allocator.hpp"
+#include "front/lexer.hpp"
+#include "front/token.hpp"
+#include "middle/ast.hpp"
+#include <memory>
+#include <vector>
+
+namespace shl
+{
+    // Lexes all the source code up front, splits the tokens between top-level declarations,
+    // and parses batches of declarations on every thread of the thread pool, each thread with its own arena.
+    // Errors are reported exactly as a serial parse would report them.
+    class parallel_parser
+    {
+    public:
+        [[nodiscard]] explicit parallel_parser(lexer& lexer);
+
+        parallel_parser(const parallel_parser&) = delete;
+        parallel_parser(parallel_parser&&) = delete;
+        parallel_parser& operator=(const parallel_parser&) = delete;
+        parallel_parser& operator=(parallel_parser&&) = delete;
+
+        // The nodes live as long as the parallel parser.
+        [[nodiscard]] node_program* operator()();
+
+    private:
+        // Returns the index of the first token of each batch of whole top-level declarations, then the number of tokens.
+        [[nodiscard]] std::vector<std::size_t> split(std::size_t batch_size) const;
+
+        // Re-lexes and parses everything on the calling thread, so any error is reported in source order.
+        [[nodiscard]] node_program* parse_serially();
+
+    private:
+        // Fewer tokens than this aren't worth waking another thread for.
+        static constexpr std::size_t min_batch_size = 16 * 1024;
+        // More batches than threads balance out declarations of uneven size.
+        static constexpr std::size_t batches_per_thread = 8;
+
+        lexer& _lexer;
+        token_buffer _tokens;
+        // One arena per thread, so threads never contend on allocation.
+        std::vector<std::unique_ptr<arena_allocator>> _allocators;
+    };
+} // namespace shl
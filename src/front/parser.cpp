@@ -4,321 +4,367 @@ namespace shl
 {
     node_program* parser::operator()()
     {
-        if (auto n_program = try_parse(&parser::try_parse_program, "Invalid program"))
-            return n_program;
-        return nullptr;
+        // program → declaration declarations
+        auto n_program = _allocator.allocate<node_program>(_allocator.make_vector<node_declaration*>());
+        predict(nonterminal::program, "Invalid program");
+        do
+            n_program->declarations.push_back(parse_declaration());
+        while (predict(nonterminal::declarations) == production::declarations_declaration);
+        expect_end("Invalid declaration");
+        return n_program;
     }
 
-    node_program* parser::try_parse_program()
+    std::vector<parsed_declaration> parser::parse_declarations()
     {
-        auto n_program = _allocator.allocate<node_program>();
-        while (peek())
-            if (auto n_declaration = try_parse(&parser::try_parse_declaration, "Invalid declaration"))
-                n_program->declarations.push_back(n_declaration);
-        if (!n_program->declarations.empty())
-            return n_program;
-        return nullptr;
+        std::vector<parsed_declaration> declarations;
+        while (predict(nonterminal::declarations) == production::declarations_declaration)
+        {
+            std::uint32_t offset = peek()->offset; // The token is overwritten while parsing.
+            declarations.emplace_back(parse_declaration(), offset);
+        }
+        expect_end("Invalid declaration");
+        return declarations;
+    }
+
+    node_declaration* parser::parse_declaration()
+    {
+        // declaration → identifier ":" declaration_value
+        auto n_name = parse_identifier();
+        expect(token_type::colon_, "Expected ':'");
+        return parse_declaration_value(n_name);
     }
 
-    node_declaration* parser::try_parse_declaration()
+    node_declaration* parser::parse_declaration_value(node_identifier* n_name)
     {
-        if (auto n_name = try_parse_identifier())
+        auto n_declaration = _allocator.allocate<node_declaration>();
+        // Anything that isn't a function is reported as a missing ';'.
+        switch (try_predict(nonterminal::declaration_value))
         {
-            auto n_declaration = _allocator.allocate<node_declaration>();
-            try_consume(token_type::colon_, "Expected ':'");
-            if (auto n_function = try_parse_function(true))
+        case production::declaration_value_function:
+            n_declaration->n_value = _allocator.allocate<node_definition>(_allocator.allocate<node_named_function>(n_name, parse_function()));
+            break;
+        default: // production::declaration_value_object
+        {
+            // object_value → object_type object_initializer ";"
+            node_identifier* n_type = nullptr;
+            if (predict(nonterminal::object_type) == production::object_type_identifier)
+                n_type = parse_identifier();
+            if (predict(nonterminal::object_initializer) == production::object_initializer_expression)
             {
-                n_declaration->n_value = _allocator.allocate<node_definition>(_allocator.allocate<node_named_function>(n_name, n_function));
-                return n_declaration;
+                consume();
+                auto n_expression = parse_expression();
+                n_declaration->n_value = _allocator.allocate<node_definition>(_allocator.allocate<node_define_object>(n_name, n_type, n_expression));
             }
             else
-            {
-                auto n_type = try_parse_identifier();
-                if (try_consume(token_type::equals_))
-                {
-                    if (auto n_expression = try_parse(&parser::try_parse_expression, "Expected expression", 0))
-                        n_declaration->n_value = _allocator.allocate<node_definition>(_allocator.allocate<node_define_object>(n_name, n_type, n_expression));
-                }
-                else
-                    n_declaration->n_value = _allocator.allocate<node_declare_object>(n_name);
-                try_consume(token_type::semicolon_, "Expected ';'");
-                return n_declaration;
-            }
+                n_declaration->n_value = _allocator.allocate<node_declare_object>(n_name);
+            expect(token_type::semicolon_, "Expected ';'");
+            break;
+        }
         }
-        return nullptr;
+        return n_declaration;
     }
 
-    node_declare_object* parser::try_parse_declare_object(node_identifier* n_name, bool optional_type)
+    node_function* parser::parse_function()
     {
-        if (n_name || (n_name = try_parse_identifier()))
+        // function → "(" return_values parameter_list ")" "=" statement
+        consume();
+        auto n_function = _allocator.allocate<node_function>(_allocator.make_vector<node_declare_object*>(), _allocator.make_vector<node_parameter*>());
+        // Parse any return objects.
+        if (predict(nonterminal::return_values) == production::return_values_some)
         {
-            try_consume(token_type::colon_, "Expected ':'");
-            auto n_type = try_parse_identifier();
-            if (!optional_type && !n_type) error(std::nullopt, "Expected identifier");
-            // If optional, the lack of a type identifier means auto.
-            return _allocator.allocate<node_declare_object>(n_name, n_type);
+            n_function->return_values.push_back(parse_declare_object("Expected return value declaration"));
+            while (predict(nonterminal::return_values_tail) == production::return_values_tail_comma)
+            {
+                consume();
+                n_function->return_values.push_back(parse_declare_object("Expected return value declaration"));
+            }
         }
-        return nullptr;
-    }
-
-    node_function* parser::try_parse_function(bool colon_consumed)
-    {
-        if (colon_consumed || try_consume(token_type::colon_))
+        // Parse any parameters.
+        if (predict(nonterminal::parameter_list) == production::parameter_list_some)
         {
-            // An opening parenthesis means there's a function definition.
-            if (try_consume(token_type::open_parenthesis_))
+            consume();
+            if (predict(nonterminal::parameters) == production::parameters_some)
             {
-                auto n_function = _allocator.allocate<node_function>();
-                // Parse any return objects.
-                if (auto n_declare_object = try_parse_declare_object(nullptr, false))
-                {
-                    n_function->return_values.push_back(n_declare_object);
-                    while (try_consume(token_type::comma_))
-                    {
-                        n_declare_object = try_parse(&parser::try_parse_declare_object, "Expected return value declaration", nullptr, false);
-                        n_function->return_values.push_back(n_declare_object);
-                    }
-                }
-                if (try_consume(token_type::semicolon_))
+                n_function->parameters.push_back(parse_parameter());
+                while (predict(nonterminal::parameters_tail) == production::parameters_tail_comma)
                 {
-                    // Parse any parameters.
-                    if (auto n_parameter = try_parse_parameter())
-                    {
-                        n_function->parameters.push_back(n_parameter);
-                        while (try_consume(token_type::comma_))
-                        {
-                            n_parameter = try_parse(&parser::try_parse_parameter, "Expected parameter");
-                            n_function->parameters.push_back(n_parameter);
-                        }
-                    }
+                    consume();
+                    n_function->parameters.push_back(parse_parameter());
                 }
-                // Consume the closing parenthesis and equal sign.
-                try_consume(token_type::close_parenthesis_, "Expected ')'");
-                try_consume(token_type::equals_, "Expected '='");
-                // Parse the statement.
-                n_function->n_statement = try_parse(&parser::try_parse_statement, "Expected statement");
-                return n_function;
             }
         }
-        return nullptr;
+        // Consume the closing parenthesis and equal sign.
+        expect(token_type::close_parenthesis_, "Expected ')'");
+        expect(token_type::equals_, "Expected '='");
+        // Parse the statement.
+        n_function->n_statement = parse_statement();
+        return n_function;
     }
 
-    node_parameter* parser::try_parse_parameter()
+    node_parameter* parser::parse_parameter()
     {
-        auto n_parameter_pass = try_parse_parameter_pass();
-        if (auto n_name = try_parse_identifier())
-        {
-            if (!n_parameter_pass) // Default parameter passing is in.
-                n_parameter_pass = _allocator.allocate<node_parameter_pass>(node_in());
-            auto n_declare_object = try_parse(&parser::try_parse_declare_object, "Expected object declaration", n_name, false);
-            return _allocator.allocate<node_parameter>(n_parameter_pass, n_declare_object);
-        }
-        else if (n_parameter_pass)
-            error(peek(), "Expected identifier");
-        return nullptr;
+        // parameter → parameter_pass declare_object
+        predict(nonterminal::parameter, "Expected parameter");
+        auto n_parameter_pass = parse_parameter_pass();
+        auto n_declare_object = parse_declare_object("Expected identifier");
+        return _allocator.allocate<node_parameter>(n_parameter_pass, n_declare_object);
     }
 
-    node_scope* parser::try_parse_scope()
+    node_parameter_pass* parser::parse_parameter_pass()
     {
-        if (try_consume(token_type::open_brace_))
+        production production = predict(nonterminal::parameter_pass);
+        if (production != production::parameter_pass_default)
+            consume();
+        switch (production)
         {
-            auto n_scope = _allocator.allocate<node_scope>();
-            while (auto n_scoped_statement = try_parse_scoped_statement())
-                n_scope->scoped_statements.push_back(n_scoped_statement);
-            try_consume(token_type::close_brace_, "Expected '}'");
-            return n_scope;
+        case production::parameter_pass_out:   return _allocator.allocate<node_parameter_pass>(node_out());
+        case production::parameter_pass_inout: return _allocator.allocate<node_parameter_pass>(node_inout());
+        case production::parameter_pass_copy:  return _allocator.allocate<node_parameter_pass>(node_copy());
+        case production::parameter_pass_move:  return _allocator.allocate<node_parameter_pass>(node_move());
+        default: // Default parameter passing is in.
+            return _allocator.allocate<node_parameter_pass>(node_in());
         }
-        return nullptr;
     }
 
-    node_statement* parser::try_parse_statement()
+    node_declare_object* parser::parse_declare_object(std::string_view error_message)
     {
-        if (try_consume(token_type::semicolon_))
-            return _allocator.allocate<node_statement>();
-        if (auto n_scope = try_parse_scope())
-            return _allocator.allocate<node_statement>(n_scope);
-        if (auto n_if = try_parse_if())
-            return _allocator.allocate<node_statement>(n_if);
-        if (auto n_return = try_parse_return())
-            return _allocator.allocate<node_statement>(n_return);
-        if (auto n_reassign = try_parse_reassign())
-            return _allocator.allocate<node_statement>(n_reassign);
-        return nullptr;
+        // declare_object → identifier ":" identifier
+        predict(nonterminal::declare_object, error_message);
+        auto n_name = parse_identifier();
+        expect(token_type::colon_, "Expected ':'");
+        if (auto t = peek(); !t || t->type != token_type::identifier_)
+            error(nullptr, "Expected identifier");
+        auto n_type = parse_identifier();
+        return _allocator.allocate<node_declare_object>(n_name, n_type);
     }
 
-    node_scoped_statement* parser::try_parse_scoped_statement()
+    node_scope* parser::parse_scope()
     {
-        if (auto n_statement = try_parse_statement())
-            return _allocator.allocate<node_scoped_statement>(n_statement);
-        if (auto n_declaration = try_parse_declaration())
-            return _allocator.allocate<node_scoped_statement>(n_declaration);
-        if (auto n_scoped_if = try_parse_scoped_if())
-            return _allocator.allocate<node_scoped_statement>(n_scoped_if);
-        return nullptr;
+        // scope → "{" scoped_statements "}"
+        consume();
+        auto n_scope = _allocator.allocate<node_scope>(_allocator.make_vector<node_scoped_statement*>());
+        while (predict(nonterminal::scoped_statements) == production::scoped_statements_statement)
+            n_scope->scoped_statements.push_back(parse_scoped_statement());
+        expect(token_type::close_brace_, "Expected '}'");
+        return n_scope;
     }
 
-    node_expression* parser::try_parse_expression(std::uint8_t min_precedence)
+    node_scoped_statement* parser::parse_scoped_statement()
     {
-        auto n_term_lhs = try_parse_term();
-        if (!n_term_lhs) return nullptr;
-
-        auto n_expression = _allocator.allocate<node_expression>(n_term_lhs); // create current
-
-        // Operator precedence climbing time!
-        while (auto t_op = peek())
+        switch (predict(nonterminal::scoped_statement))
         {
-            auto precedence = get_operator_precedence(t_op->type);
-            if (!precedence || precedence < min_precedence) break;
-            auto next_min_precedence = *precedence + 1;
-
-            // TODO: Unary operators.
-            // node_unary_expression
-            auto n_binary_expression = _allocator.allocate<node_binary_expression>(); // create parent
-            n_binary_expression->n_expression_lhs = n_expression; // set left
-            n_binary_expression->n_binary_operator = _allocator.allocate<node_binary_operator>(); // set binary operator
-
-            // TODO: Unary operators.
-            if (auto n_binary_operator = try_parse_binary_operator())
-                n_binary_expression->n_binary_operator = n_binary_operator;
-
-            n_expression = _allocator.allocate<node_expression>(n_binary_expression); // create and continue as parent
-            n_binary_expression->n_expression_rhs = try_parse_expression(next_min_precedence); // set parent right
+        case production::scoped_statement_empty:
+            consume();
+            return _allocator.allocate<node_scoped_statement>(_allocator.allocate<node_statement>());
+        case production::scoped_statement_scope:
+            return _allocator.allocate<node_scoped_statement>(_allocator.allocate<node_statement>(parse_scope()));
+        case production::scoped_statement_if:
+        {
+            // An if without elifs or an else is just a statement.
+            auto n_if = parse_if();
+            if (predict(nonterminal::else_ifs) == production::else_ifs_end)
+                return _allocator.allocate<node_scoped_statement>(_allocator.allocate<node_statement>(n_if));
+            auto n_scoped_if = _allocator.allocate<node_scoped_if>(_allocator.make_vector<node_if*>());
+            n_scoped_if->ifs.push_back(n_if);
+            while (predict(nonterminal::else_ifs) == production::else_ifs_elif)
+                n_scoped_if->ifs.push_back(parse_if());
+            if (predict(nonterminal::else_ifs) == production::else_ifs_else)
+            {
+                consume();
+                n_scoped_if->ifs.push_back(_allocator.allocate<node_if>(nullptr, parse_statement()));
+            }
+            return _allocator.allocate<node_scoped_statement>(n_scoped_if);
+        }
+        case production::scoped_statement_return:
+            return _allocator.allocate<node_scoped_statement>(_allocator.allocate<node_statement>(parse_return()));
+        default: // production::scoped_statement_identifier
+        {
+            // identifier_statement → ":" declaration_value | reassign
+            auto n_identifier = parse_identifier();
+            if (try_predict(nonterminal::identifier_statement) == production::identifier_statement_reassign)
+                return _allocator.allocate<node_scoped_statement>(_allocator.allocate<node_statement>(parse_reassign(n_identifier)));
+            expect(token_type::colon_, "Expected ':'");
+            return _allocator.allocate<node_scoped_statement>(parse_declaration_value(n_identifier));
+        }
         }
-
-        return n_expression;
     }
 
-    node_term* parser::try_parse_term()
+    node_statement* parser::parse_statement()
     {
-        if (auto n_integer_literal = try_parse_integer_literal())
-            return _allocator.allocate<node_term>(n_integer_literal);
-        if (auto n_identifier = try_parse_identifier())
-            return _allocator.allocate<node_term>(n_identifier);
-        if (try_consume(token_type::open_parenthesis_))
+        switch (predict(nonterminal::statement, "Expected statement"))
         {
-            auto n_term = _allocator.allocate<node_term>();
-            if (auto n_expression = try_parse(&parser::try_parse_expression, "Expected expression", 0))
-                n_term->n_value = n_expression;
-            try_consume(token_type::close_parenthesis_, "Expected ')'");
-            return n_term;
+        case production::statement_empty:
+            consume();
+            return _allocator.allocate<node_statement>();
+        case production::statement_scope:
+            return _allocator.allocate<node_statement>(parse_scope());
+        case production::statement_if:
+            return _allocator.allocate<node_statement>(parse_if());
+        case production::statement_return:
+            return _allocator.allocate<node_statement>(parse_return());
+        default: // production::statement_reassign
+            return _allocator.allocate<node_statement>(parse_reassign(parse_identifier()));
         }
-        return nullptr;
     }
 
-    node_binary_operator* parser::try_parse_binary_operator()
+    node_if* parser::parse_if()
     {
-        if (try_consume(token_type::forward_slash_)) return _allocator.allocate<node_binary_operator>(node_forward_slash(token_type::forward_slash_));
-        if (try_consume(token_type::percent_))       return _allocator.allocate<node_binary_operator>(node_percent(token_type::percent_));
-
-        if (try_consume(token_type::asterisk_))      return _allocator.allocate<node_binary_operator>(node_asterisk(token_type::asterisk_));
-        if (try_consume(token_type::plus_))          return _allocator.allocate<node_binary_operator>(node_plus(token_type::plus_));
-        if (try_consume(token_type::minus_))         return _allocator.allocate<node_binary_operator>(node_minus(token_type::minus_));
-
-        // if (try_consume(token_type::tilde_))         return _allocator.allocate<node_unary_operator>(node_tilde_(token_type::tilde_));
-        return nullptr;
+        // if_statement → "if" expression statement
+        // else_ifs → "elif" expression statement else_ifs
+        consume();
+        auto n_if = _allocator.allocate<node_if>();
+        n_if->n_expression = parse_expression();
+        auto n_innermost_if = n_if;
+        while (try_predict(nonterminal::statement) == production::statement_if)
+        {
+            consume();
+            auto n_nested_if = _allocator.allocate<node_if>();
+            n_nested_if->n_expression = parse_expression();
+            n_innermost_if->n_statement = _allocator.allocate<node_statement>(n_nested_if);
+            n_innermost_if = n_nested_if;
+        }
+        n_innermost_if->n_statement = parse_statement();
+        return n_if;
     }
 
-    node_parameter_pass* parser::try_parse_parameter_pass()
+    node_return* parser::parse_return()
     {
-        if (try_consume(token_type::in_))    return _allocator.allocate<node_parameter_pass>(node_in());
-        if (try_consume(token_type::out_))   return _allocator.allocate<node_parameter_pass>(node_out());
-        if (try_consume(token_type::inout_)) return _allocator.allocate<node_parameter_pass>(node_inout());
-        if (try_consume(token_type::copy_))  return _allocator.allocate<node_parameter_pass>(node_copy());
-        if (try_consume(token_type::move_))  return _allocator.allocate<node_parameter_pass>(node_move());
-        return nullptr;
+        // return_statement → "return" ";"
+        consume();
+        expect(token_type::semicolon_, "Expected ';'");
+        return _allocator.allocate<node_return>();
     }
 
-    void parser::error(const std::optional<token>& token, std::string_view error_message)
+    node_reassign* parser::parse_reassign(node_identifier* n_identifier)
     {
-        if (token)
-            error_exit("Parser", error_message, token->line_number, token->column_number);
-        else
-        {
-            auto previous = --iterator();
-            error_exit("Parser", error_message, previous->line_number, previous->column_number);
-        }
+        // reassign → identifier "=" expression ";"
+        auto n_reassign = _allocator.allocate<node_reassign>(n_identifier);
+        expect(token_type::equals_, "Expected '='");
+        n_reassign->n_expression = parse_expression();
+        expect(token_type::semicolon_, "Expected ';'");
+        return n_reassign;
     }
 
-    node_return* parser::try_parse_return()
+    node_expression* parser::parse_expression()
     {
-        if (try_consume(token_type::return_))
+        // Operators are reduced the same way precedence climbing would: higher precedence first, then left to right.
+        _operands.clear();
+        _operators.clear();
+        for (;;)
         {
-            try_consume(token_type::semicolon_, "Expected ';'");
-            return _allocator.allocate<node_return>();
-        }
-        return nullptr;
-    }
+            // expression → term binary_operations
+            // term → "(" expression ")", which just opens a parenthesis here.
+            production production;
+            while ((production = predict(nonterminal::term, "Expected expression")) == production::term_parenthesized)
+            {
+                consume();
+                _operators.emplace_back(nullptr, 0);
+            }
+            auto n_term = production == production::term_integer_literal
+                ? _allocator.allocate<node_term>(parse_integer_literal())
+                : _allocator.allocate<node_term>(parse_identifier());
+            _operands.push_back(_allocator.allocate<node_expression>(n_term));
 
-    node_reassign* parser::try_parse_reassign()
-    {
-        if (peek(1) && peek(1)->type == token_type::equals_)
-        {
-            if (auto n_identifier = try_parse_identifier())
+            for (;;)
             {
-                auto n_reassign = _allocator.allocate<node_reassign>(n_identifier);
-                try_consume(token_type::equals_, "Expected '='");
-                if (auto n_expression = try_parse(&parser::try_parse_expression, "Expected expression", 0))
-                    n_reassign->n_expression = n_expression;
-                try_consume(token_type::semicolon_, "Expected ';'");
-                return n_reassign;
+                // binary_operations → binary_operator term binary_operations
+                if (predict(nonterminal::binary_operations) == production::binary_operations_operator)
+                {
+                    auto precedence = *get_operator_precedence(peek()->type);
+                    reduce_operators(precedence);
+                    _operators.emplace_back(parse_binary_operator(), precedence);
+                    break;
+                }
+
+                // The operand is complete, so close its parenthesis, or finish if there is none.
+                reduce_operators(0);
+                if (_operators.empty())
+                    return _operands.back();
+                expect(token_type::close_parenthesis_, "Expected ')'");
+                _operators.pop_back();
+                n_term = _allocator.allocate<node_term>();
+                n_term->n_value = _operands.back();
+                _operands.back() = _allocator.allocate<node_expression>(n_term);
             }
         }
-        return nullptr;
     }
 
-    node_if* parser::try_parse_if(bool if_consumed)
+    void parser::reduce_operators(std::uint8_t min_precedence)
     {
-        if (if_consumed || try_consume(token_type::if_))
+        while (!_operators.empty() && _operators.back().n_binary_operator && _operators.back().precedence >= min_precedence)
         {
-            auto n_if = _allocator.allocate<node_if>();
-            if (auto n_expression = try_parse(&parser::try_parse_expression, "Expected expression", 0))
-                n_if->n_expression = n_expression;
-            if (auto n_statement = try_parse(&parser::try_parse_statement, "Expected statement"))
-                n_if->n_statement = n_statement;
-            return n_if;
+            // TODO: Unary operators.
+            // node_unary_expression
+            auto n_binary_expression = _allocator.allocate<node_binary_expression>();
+            n_binary_expression->n_binary_operator = _operators.back().n_binary_operator;
+            n_binary_expression->n_expression_rhs = _operands.back();
+            _operators.pop_back();
+            _operands.pop_back();
+            n_binary_expression->n_expression_lhs = _operands.back();
+            _operands.back() = _allocator.allocate<node_expression>(n_binary_expression);
         }
-        return nullptr;
     }
 
-    node_scoped_if* parser::try_parse_scoped_if()
+    node_binary_operator* parser::parse_binary_operator()
     {
-        if (auto n_if = try_parse_if())
+        production production = predict(nonterminal::binary_operator);
+        consume();
+        switch (production)
         {
-            auto n_scoped_if = _allocator.allocate<node_scoped_if>(std::vector{n_if});
-            while (try_consume(token_type::elif_))
-                n_scoped_if->ifs.push_back(try_parse(&parser::try_parse_if, "Expected expression and statement", true));
-            if (try_consume(token_type::else_))
-                n_scoped_if->ifs.push_back(_allocator.allocate<node_if>(nullptr, try_parse(&parser::try_parse_statement, "Expected statement")));
-            return n_scoped_if;
+        case production::binary_operator_forward_slash: return _allocator.allocate<node_binary_operator>(node_forward_slash(token_type::forward_slash_));
+        case production::binary_operator_percent:       return _allocator.allocate<node_binary_operator>(node_percent(token_type::percent_));
+
+        case production::binary_operator_asterisk:      return _allocator.allocate<node_binary_operator>(node_asterisk(token_type::asterisk_));
+        case production::binary_operator_plus:          return _allocator.allocate<node_binary_operator>(node_plus(token_type::plus_));
+        default: // production::binary_operator_minus
+            return _allocator.allocate<node_binary_operator>(node_minus(token_type::minus_));
         }
-        return nullptr;
     }
 
-    node_integer_literal* parser::try_parse_integer_literal()
+    node_integer_literal* parser::parse_integer_literal()
     {
-        if (auto t_integer_literal = try_consume(token_type::integer_literal_))
-            return _allocator.allocate<node_integer_literal>(t_integer_literal->value);
-        return nullptr;
+        return _allocator.allocate<node_integer_literal>(get_value(*consume()));
     }
 
-    node_identifier* parser::try_parse_identifier()
+    node_identifier* parser::parse_identifier()
     {
-        if (auto t_identifier = try_consume(token_type::identifier_))
-            return _allocator.allocate<node_identifier>(t_identifier->value);
-        return nullptr;
+        const token* t_identifier = consume();
+        return _allocator.allocate<node_identifier>(get_value(*t_identifier), t_identifier->symbol);
     }
 
-    std::optional<token> parser::try_consume(token_type type)
+    production parser::try_predict(nonterminal nonterminal)
     {
-        if (auto t = peek(); t && t->type == type)
-            return *consume();
-        return std::nullopt;
+        const token* t = peek();
+        return shl::predict(nonterminal, t ? +t->type : terminal_end);
+    }
+
+    production parser::predict(nonterminal nonterminal, std::string_view error_message)
+    {
+        production production = try_predict(nonterminal);
+        if (production == production::_count)
+            error(nullptr, error_message);
+        return production;
     }
 
-    token parser::try_consume(token_type type, std::string_view error_message)
+    const token* parser::expect(token_type type, std::string_view error_message)
     {
         if (auto t = peek(); t && t->type == type)
-            return *consume();
+            return consume();
         else error(t, error_message);
     }
+
+    void parser::expect_end(std::string_view error_message)
+    {
+        if (peek())
+            error(nullptr, error_message);
+    }
+
+    void parser::error(const token* token, std::string_view error_message)
+    {
+        const shl::token* t = token ? token : previous();
+        if (!t)
+            error_exit("Parser", error_message);
+        auto [line_number, column_number] = get_location(*t);
+        error_exit("Parser", error_message, line_number, column_number);
+    }
 } // namespace shl
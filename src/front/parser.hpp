@@ -1,67 +1,96 @@
 #pragma once
 
 #include "common/arena_allocator.hpp"
-#include "common/consumer.hpp"
 #include "common/error.hpp"
+#include "front/grammar.hpp"
+#include "front/lexer.hpp"
 #include "front/token.hpp"
+#include "front/token_stream.hpp"
 #include "middle/ast.hpp"
-#include <vector>
 
 namespace shl
 {
-    class parser : consumer<std::vector<token>>
+    // A top-level declaration and the offset of its first token in the source code.
+    struct parsed_declaration
+    {
+        node_declaration* n_declaration;
+        std::uint32_t offset;
+    };
+
+    // Pulls tokens from its source as it parses, so only a small window of tokens is ever alive.
+    // The nodes are allocated in the given arena, so they outlive the parser.
+    class parser : token_stream
     {
     public:
-        [[nodiscard]] explicit parser(const std::vector<token>& tokens) : consumer<std::vector<token>>(tokens) {}
-        [[nodiscard]] explicit parser(std::vector<token>&& tokens) noexcept : consumer<std::vector<token>>(std::move(tokens)) {}
+        [[nodiscard]] explicit parser(const token_source& source, arena_allocator& allocator) noexcept
+            : token_stream(source), _allocator(allocator) {}
 
         [[nodiscard]] node_program* operator()();
 
+        // Parses top-level declarations until the lexer runs out of tokens.
+        // Unlike operator()(), having no declarations is valid.
+        [[nodiscard]] std::vector<parsed_declaration> parse_declarations();
+
     private:
-        // Correspondence: Cased grammar rule.
+        // Correspondence: Nonterminals in front/grammar.hpp.
+        // Each one is only called once its production has been predicted,
+        // so none of them speculate, and they only fail on a missing token.
 
-        [[nodiscard]] node_program* try_parse_program();
-        [[nodiscard]] node_declaration* try_parse_declaration();
-        [[nodiscard]] node_declare_object* try_parse_declare_object(node_identifier* n_name, bool optional_type);
-        [[nodiscard]] node_function* try_parse_function(bool colon_consumed = false);
-        [[nodiscard]] node_parameter* try_parse_parameter();
-        [[nodiscard]] node_scope* try_parse_scope();
-        [[nodiscard]] node_statement* try_parse_statement();
-        [[nodiscard]] node_scoped_statement* try_parse_scoped_statement();
-        // Also parses operator precedence.
-        [[nodiscard]] node_expression* try_parse_expression(std::uint8_t min_precedence);
-        [[nodiscard]] node_term* try_parse_term();
+        [[nodiscard]] node_declaration* parse_declaration();
+        [[nodiscard]] node_declaration* parse_declaration_value(node_identifier* n_name);
+        [[nodiscard]] node_function* parse_function();
+        [[nodiscard]] node_parameter* parse_parameter();
+        [[nodiscard]] node_parameter_pass* parse_parameter_pass();
+        [[nodiscard]] node_declare_object* parse_declare_object(std::string_view error_message);
+        [[nodiscard]] node_scope* parse_scope();
+        [[nodiscard]] node_scoped_statement* parse_scoped_statement();
+        [[nodiscard]] node_statement* parse_statement();
+        // Also parses elifs, since they only differ by keyword.
+        // Ifs directly nested in its statement are parsed in a loop instead of recursively.
+        [[nodiscard]] node_if* parse_if();
+        [[nodiscard]] node_return* parse_return();
+        [[nodiscard]] node_reassign* parse_reassign(node_identifier* n_identifier);
+        // Also parses operator precedence and parentheses, with explicit stacks instead of recursion.
+        [[nodiscard]] node_expression* parse_expression();
+        [[nodiscard]] node_binary_operator* parse_binary_operator();
+        [[nodiscard]] node_integer_literal* parse_integer_literal();
+        [[nodiscard]] node_identifier* parse_identifier();
 
-        // Correspondence: Non-trivial grammar rule case.
+    private:
+        // Returns the production to parse the nonterminal with, chosen by the next token alone,
+        // or production::_count if there is none.
+        [[nodiscard]] production try_predict(nonterminal nonterminal);
 
-        [[nodiscard]] node_return* try_parse_return();
-        [[nodiscard]] node_reassign* try_parse_reassign();
-        [[nodiscard]] node_if* try_parse_if(bool if_consumed = false);
-        [[nodiscard]] node_scoped_if* try_parse_scoped_if();
-        // [[nodiscard]] node_binary_expression* try_parse_binary_expression();
+        // Same as try_predict, but the production must exist.
+        // Nullable nonterminals always have one, others report the error at the previous token if they don't.
+        production predict(nonterminal nonterminal, std::string_view error_message = "Unexpected token");
 
-        // Correspondence: Trivial grammar rule.
+        // Consumes the next token, which must have the given type.
+        // The returned token is valid until lookahead more tokens are pulled.
+        const token* expect(token_type type, std::string_view error_message);
 
-        [[nodiscard]] node_binary_operator* try_parse_binary_operator();
-        [[nodiscard]] node_parameter_pass* try_parse_parameter_pass();
-        [[nodiscard]] node_integer_literal* try_parse_integer_literal();
-        [[nodiscard]] node_identifier* try_parse_identifier();
+        // Reports the error at the previous token if there are tokens left.
+        void expect_end(std::string_view error_message);
 
-    private:
-        [[nodiscard]] std::optional<token> try_consume(token_type type);
-        token try_consume(token_type type, std::string_view error_message);
+        // Pops operators with at least the given precedence into binary expressions, stopping at any open parenthesis.
+        void reduce_operators(std::uint8_t min_precedence);
 
-        template <typename Func, typename... Args>
-        [[nodiscard]] auto try_parse(Func func, std::string_view error_message, Args&&... args)
-        {
-            if (auto n = (this->*func)(std::forward<Args>(args)...)) return n;
-            else error(std::nullopt, error_message);
-        }
+    private:
+        // Reports the error at the token, or the previous one if there is none.
+        [[noreturn]] void error(const token* token, std::string_view error_message);
 
     private:
-        [[noreturn]] void error(const std::optional<token>& token, std::string_view error_message);
+        // An operator waiting for its right operand, or an open parenthesis if n_binary_operator is nullptr.
+        struct pending_operator
+        {
+            node_binary_operator* n_binary_operator;
+            std::uint8_t precedence;
+        };
 
     private:
-        arena_allocator _allocator{1024 * 1024}; // 1 MiB blocks.
+        arena_allocator& _allocator;
+        // Expression parsing state, kept around to reuse its capacity.
+        std::vector<node_expression*> _operands;
+        std::vector<pending_operator> _operators;
     };
 } // namespace shl
@@ -1,10 +1,24 @@
 #pragma once
 
+#include "common/interner.hpp"
 #include "common/ranged_enum.hpp"
 #include <array>
 #include <cstdint>
 #include <optional>
 #include <string_view>
+#include <vector>
+
+// Every keyword, spelled as it is in source code.
+// Each keyword's token type is its spelling with an appended underscore,
+// so adding a keyword here is all that's needed for the lexer to recognize it.
+#define TOKEN_KEYWORDS \
+    /* Correspondence: Non-trivial grammar rule case. */ \
+    return, if, elif, else, while, dowhile, \
+    /* Correspondence: Parameter passing. */ \
+    in, out, inout, copy, move
+
+#define _TOKEN_KEYWORD_NAME(keyword) keyword##_,
+#define _TOKEN_KEYWORD_SPELLING(keyword) #keyword,
 
 namespace shl
 {
@@ -28,14 +42,9 @@ namespace shl
             integer_literal_,
             identifier_,
 
-            // Correspondence: Non-trivial grammar rule case.
+            // Correspondence: Keywords.
 
-            return_,
-            if_,
-            elif_,
-            else_,
-            while_,
-            dowhile_,
+            FOR_EACH(_TOKEN_KEYWORD_NAME, TOKEN_KEYWORDS)
 
             // Correspondence: Binary-only operators.
 
@@ -46,22 +55,15 @@ namespace shl
 
             asterisk_, // binary: multiplication, unary: indirection/dereference
             plus_,     // binary: addition,       unary: promotion
-            minus_,    // binary: subtraction,    unary: negation
+            minus_     // binary: subtraction,    unary: negation
 
             // Correspondence: Unary-only operators
 
             // _tilde, // unary: bitwise not
-
-            // Correspondence: Parameter passing.
-
-            in_,
-            out_,
-            inout_,
-            copy_,
-            move_
         ),
         // Ranges
         (
+            (keyword, identifier_ + 1, forward_slash_),
             (binary_operator, forward_slash_, minus_ + 1),
             (unary_operator, asterisk_, minus_ + 1),
             (binary_and_unary_operator, _range_unary_operators_begin, _range_binary_operators_end),
@@ -87,11 +89,122 @@ namespace shl
         return std::nullopt;
     }
 
+    // The spelling of each keyword, in the same order as their token types.
+    inline constexpr auto keyword_spellings = std::to_array<std::string_view>({ FOR_EACH(_TOKEN_KEYWORD_SPELLING, TOKEN_KEYWORDS) });
+    static_assert(keyword_spellings.size() == +token_type::_range_keywords_end - +token_type::_range_keywords_begin);
+
+    // Keywords are told apart from identifiers with a compile-time perfect hash,
+    // so every identifier takes one hash and at most one compare.
+
+    // The number of bits in a keyword hash, i.e. log2 of the number of slots.
+    inline constexpr std::uint32_t keyword_hash_bits = 5;
+    static_assert(keyword_spellings.size() <= (1u << keyword_hash_bits));
+
+    // Packs the parts of a non-empty identifier that tell every keyword apart.
+    [[nodiscard]] constexpr std::uint32_t get_keyword_key(std::string_view identifier) noexcept
+    {
+        return static_cast<std::uint8_t>(identifier.front())
+            | static_cast<std::uint8_t>(identifier.back()) << 8
+            | static_cast<std::uint32_t>(identifier.size()) << 16;
+    }
+
+    [[nodiscard]] constexpr std::uint32_t get_keyword_hash(std::uint32_t key, std::uint32_t multiplier) noexcept
+    {
+        return (key * multiplier) >> (32 - keyword_hash_bits);
+    }
+
+    // The first odd multiplier, starting from 2^32 / phi, that hashes every keyword to a different slot.
+    inline constexpr std::uint32_t keyword_hash_multiplier = []
+    {
+        for (std::uint32_t multiplier = 0x9E3779B1; ; multiplier += 2)
+        {
+            std::uint32_t used_slots = 0;
+            bool is_perfect = true;
+            for (std::string_view spelling : keyword_spellings)
+            {
+                std::uint32_t slot = get_keyword_hash(get_keyword_key(spelling), multiplier);
+                is_perfect &= !(used_slots >> slot & 1);
+                used_slots |= 1u << slot;
+            }
+            if (is_perfect)
+                return multiplier;
+        }
+    }();
+
+    // Each slot holds one more than the index of the keyword that hashes to it, or 0 if none do.
+    inline constexpr auto keyword_hash_table = []
+    {
+        std::array<std::uint8_t, 1u << keyword_hash_bits> table{};
+        for (std::size_t i = 0; i < keyword_spellings.size(); ++i)
+            table[get_keyword_hash(get_keyword_key(keyword_spellings[i]), keyword_hash_multiplier)] = i + 1;
+        return table;
+    }();
+
+    // Returns the keyword's token type, or token_type::identifier_ if it's not a keyword.
+    [[nodiscard]] constexpr token_type get_identifier_type(std::string_view identifier) noexcept
+    {
+        if (std::uint8_t slot = keyword_hash_table[get_keyword_hash(get_keyword_key(identifier), keyword_hash_multiplier)];
+            slot && keyword_spellings[slot - 1] == identifier)
+            return static_cast<token_type>(+token_type::_range_keywords_begin + slot - 1);
+        return token_type::identifier_;
+    }
+
+    static_assert([]
+    {
+        for (std::size_t i = 0; i < keyword_spellings.size(); ++i)
+            if (get_identifier_type(keyword_spellings[i]) != static_cast<token_type>(+token_type::_range_keywords_begin + i))
+                return false;
+        return get_identifier_type("iff") == token_type::identifier_ && get_identifier_type("_") == token_type::identifier_;
+    }());
+
+    // Line and column numbers aren't stored, they're computed from the offset only when needed.
     struct token
     {
         token_type type;
-        std::uint32_t line_number;
-        std::uint32_t column_number;
-        std::string_view value;
+        // The token's characters are source_code[offset, offset + length).
+        std::uint32_t offset;
+        std::uint32_t length;
+        // The interned characters of identifiers, or symbol_id::empty for all other tokens.
+        symbol_id symbol = symbol_id::empty;
+    };
+
+    // Tokens stored as parallel arrays, so each one only takes 13 bytes.
+    class token_buffer
+    {
+    public:
+        void push_back(const token& token)
+        {
+            _types.push_back(token.type);
+            _offsets.push_back(token.offset);
+            _lengths.push_back(token.length);
+            _symbols.push_back(token.symbol);
+        }
+
+        void reserve(std::size_t capacity)
+        {
+            _types.reserve(capacity);
+            _offsets.reserve(capacity);
+            _lengths.reserve(capacity);
+            _symbols.reserve(capacity);
+        }
+
+        [[nodiscard]] token operator[](std::size_t index) const noexcept
+        {
+            return {_types[index], _offsets[index], _lengths[index], _symbols[index]};
+        }
+
+        [[nodiscard]] token_type get_type(std::size_t index) const noexcept { return _types[index]; }
+        [[nodiscard]] std::uint32_t get_offset(std::size_t index) const noexcept { return _offsets[index]; }
+        [[nodiscard]] std::uint32_t get_length(std::size_t index) const noexcept { return _lengths[index]; }
+        [[nodiscard]] symbol_id get_symbol(std::size_t index) const noexcept { return _symbols[index]; }
+
+        [[nodiscard]] std::size_t size() const noexcept { return _types.size(); }
+        [[nodiscard]] bool empty() const noexcept { return _types.empty(); }
+
+    private:
+        std::vector<token_type> _types;
+        std::vector<std::uint32_t> _offsets;
+        std::vector<std::uint32_t> _lengths;
+        std::vector<symbol_id> _symbols;
     };
 } // namespace shl
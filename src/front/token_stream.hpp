@@ -0,0 +1,94 @@
+#pragma once
+
+#include "common/cursor.hpp"
+#include "front/lexer.hpp"
+#include "front/token.hpp"
+
+namespace shl
+{
+    // Where a token_stream gets its tokens from: either straight from a lexer,
+    // or from a range of tokens the lexer already lexed, which many threads can read at once.
+    class token_source
+    {
+    public:
+        [[nodiscard]] explicit token_source(lexer& lexer) noexcept : _lexer(lexer) {}
+
+        // The lexer must have lexed the tokens, and is only used to get their values and locations.
+        [[nodiscard]] token_source(lexer& lexer, const token_buffer& tokens, std::size_t begin, std::size_t end) noexcept
+            : _lexer(lexer), _tokens(&tokens), _index(begin), _end(end) {}
+
+        [[nodiscard]] bool next(token& token)
+        {
+            if (!_tokens)
+                return _lexer.next(token);
+            if (_index == _end)
+                return false;
+            token = (*_tokens)[_index++];
+            return true;
+        }
+
+        [[nodiscard]] const lexer& get_lexer() const noexcept { return _lexer; }
+
+    private:
+        lexer& _lexer;
+        const token_buffer* _tokens = nullptr;
+        std::size_t _index = 0;
+        std::size_t _end = 0;
+    };
+
+    // Pulls tokens from a token_source on demand, only keeping a small window of them alive at once.
+    // Each token is written straight into the window, and tokens are only ever handed out by pointer.
+    class token_stream
+    {
+    public:
+        // The number of tokens, starting at the current one, that can be peeked at.
+        static constexpr std::size_t lookahead = 2;
+
+    public:
+        [[nodiscard]] explicit token_stream(const token_source& source) noexcept : _source(source), _tokens(_source) {}
+
+        token_stream(const token_stream&) = delete;
+        token_stream(token_stream&&) = delete;
+        token_stream& operator=(const token_stream&) = delete;
+        token_stream& operator=(token_stream&&) = delete;
+
+    protected:
+        // If there is a token offset tokens after the current one, returns said token.
+        // Otherwise, returns nullptr.
+        // The returned token is valid until lookahead more tokens are pulled.
+        [[nodiscard]] const token* peek(std::size_t offset = 0)
+        {
+            return _tokens.peek(offset);
+        }
+
+        // Returns the current token and advances to the next one.
+        // Call peek() first to see if the advance is valid.
+        // The returned token is valid until lookahead more tokens are pulled.
+        const token* consume() noexcept
+        {
+            return _tokens.consume();
+        }
+
+        // Returns the last consumed token, if any.
+        [[nodiscard]] const token* previous() const noexcept
+        {
+            return _tokens.previous();
+        }
+
+        // Returns the token's characters in the source code.
+        [[nodiscard]] std::string_view get_value(const token& token) const noexcept
+        {
+            return _source.get_lexer().get_value(token);
+        }
+
+        // Returns the location just past the token's last character.
+        [[nodiscard]] source_location get_location(const token& token) const noexcept
+        {
+            return _source.get_lexer().get_location(token);
+        }
+
+    private:
+        token_source _source;
+        ring_cursor<token, lookahead, token_source> _tokens;
+    };
+} // namespace shl
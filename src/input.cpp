@@ -3,6 +3,7 @@
 #include "common/error.hpp"
 #include "common/util.hpp"
 #include <iostream>
+#include <vector>
 #include <getopt.h> // https://linux.die.net/man/3/optarg
 
 namespace shl
@@ -12,16 +13,49 @@ namespace shl
     const input& handle_input(int argc, char *argv[])
     {
         // All options that require an argument.
-        static const std::string opts_r = insert_after_each("ove", ":");
+        static const std::string opts_r = insert_after_each("ovejf", ":");
         // All options that have no arguments.
         static const std::string opts_n = "";
-        // The full option string.
-        static const std::string opts_all = opts_r + opts_n;
+        // The full option string. Options stop at the first non-option, so nothing after the input file is reordered.
+        static const std::string opts_all = "+" + opts_r + opts_n;
+        // All options that only have a long name.
+        static const option long_opts[]
+        {
+            {"run", no_argument, nullptr, 'r'},
+            {"jit", no_argument, nullptr, 'J'},
+            {"emit-ir", no_argument, nullptr, 'I'},
+            {"ir", no_argument, nullptr, 'B'},
+            {},
+        };
 
-        for (int c; (c = getopt(argc, argv, opts_all.c_str())) != -1; )
+        // When running, everything after the input file is for the program. When compiling, options may follow it.
+        std::vector<char*> in_paths;
+        auto next_option = [&]
+        {
+            int c = getopt_long(argc, argv, opts_all.c_str(), long_opts, nullptr);
+            while (c == -1 && _input.mode == input::mode::compile && optind < argc)
+            {
+                in_paths.push_back(argv[optind++]);
+                c = getopt_long(argc, argv, opts_all.c_str(), long_opts, nullptr);
+            }
+            return c;
+        };
+        for (int c; (c = next_option()) != -1; )
         {
             switch (c)
             {
+            case 'r':
+                _input.mode = input::mode::run;
+                break;
+            case 'J':
+                _input.mode = input::mode::jit;
+                break;
+            case 'I':
+                _input.format = input::format::ir;
+                break;
+            case 'B':
+                _input.ir_backend = true;
+                break;
             case 'o':
                 _input.out_path = optarg;
                 break;
@@ -42,18 +76,63 @@ namespace shl
                 if (!is_identifier(_input.entry_point))
                     error_exit("Input", "Invalid -e argument: it's not an identifier");
                 break;
+            case 'f':
+            {
+                std::string_view format = optarg;
+                if (format == "asm")
+                    _input.format = input::format::assembly;
+                else if (format == "obj")
+                    _input.format = input::format::object;
+                else if (format == "exe")
+                    _input.format = input::format::executable;
+                else
+                    error_exit("Input", "Invalid -f argument: it must be asm, obj or exe");
+                break;
+            }
+            case 'j':
+                try
+                {
+                    int thread_count = std::stoi(optarg);
+                    if (thread_count < 0)
+                        error_exit("Input", "Invalid -j argument");
+                    _input.thread_count = static_cast<std::uint32_t>(thread_count);
+                }
+                catch (std::exception&)
+                {
+                    error_exit("Input", "Invalid -j argument");
+                }
+                break;
             }
         }
 
         // TODO: For now, only accept one input file.
-        if (optind + 1 != argc)
+        if (_input.mode != input::mode::compile)
+        {
+            // The program's arguments start with the input file, like a program's start with its path.
+            if (!in_paths.empty())
+                error_exit("Input", "--run and --jit must come before the input source file");
+            if (optind == argc)
+                error_exit("Input", "You must provide an input source file to run");
+            _input.program_argc = argc - optind;
+            _input.program_argv = argv + optind;
+            _input.in_path = argv[optind];
+        }
+        else if (in_paths.size() != 1)
             error_exit("Input", "You must provide exactly one input source file");
-
-        _input.in_path = argv[optind];
+        else
+            _input.in_path = in_paths.front();
         if (_input.out_path.empty())
         {
             _input.out_path = _input.in_path;
-            _input.out_path.replace_extension("asm");
+            switch (_input.format)
+            {
+            case input::format::assembly:   _input.out_path.replace_extension("asm"); break;
+            case input::format::object:     _input.out_path.replace_extension("o");   break;
+            case input::format::executable: _input.out_path.replace_extension();      break;
+            case input::format::ir:         _input.out_path.replace_extension("ir");  break;
+            }
+            if (_input.out_path == _input.in_path) // Never overwrite the source.
+                _input.out_path += ".out";
         }
 
         return _input;
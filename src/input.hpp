@@ -15,10 +15,34 @@ namespace shl
             _count
         };
 
+        enum class mode : std::uint8_t
+        {
+            compile, // Compile the program to assembly.
+            run,     // Interpret the program in process, with the arguments after the input file.
+            jit,     // Compile the program to machine code in process and run it, with the arguments after the input file.
+        };
+
+        enum class format : std::uint8_t
+        {
+            assembly,   // NASM source.
+            object,     // A relocatable ELF64 object file.
+            executable, // A static ELF64 executable.
+            ir,         // The three-address code the IR backend generates assembly from.
+        };
+
+        mode mode = mode::compile;
+        format format = format::assembly;
+        // Generate assembly from the three-address code instead of straight from the AST.
+        bool ir_backend = false;
         std::filesystem::path in_path;
         std::filesystem::path out_path;
         verbose_level verbose_level = verbose_level::none;
         std::string_view entry_point = "main";
+        // The number of threads to compile with, or 0 for one per hardware thread.
+        std::uint32_t thread_count = 0;
+        // The arguments to run the program with, starting with the input file as its name.
+        int program_argc = 0;
+        char** program_argv = nullptr;
     };
 
     constexpr bool operator>=(decltype(input::verbose_level) lhs, decltype(input::verbose_level) rhs) noexcept
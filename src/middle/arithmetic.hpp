@@ -0,0 +1,47 @@
+#pragma once
+
+#include "middle/ast.hpp"
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+namespace shl
+{
+    // The language's integers are unsigned and 64 bits; +, - and * wrap around.
+
+    // Returns the literal's value, or nothing if it doesn't fit in 64 bits.
+    [[nodiscard]] inline std::optional<std::uint64_t> get_value(std::string_view literal) noexcept
+    {
+        std::uint64_t value;
+        auto [end, error] = std::from_chars(literal.data(), literal.data() + literal.size(), value);
+        if (error != std::errc() || end != literal.data() + literal.size())
+            return std::nullopt;
+        return value;
+    }
+
+    [[nodiscard]] inline std::optional<std::uint64_t> get_value(const node_integer_literal* node) noexcept
+    {
+        return get_value(node->value);
+    }
+
+    // Returns the value of the binary operation, or nothing if it divides by zero, which traps at run time.
+    [[nodiscard]] inline std::optional<std::uint64_t> evaluate(const node_binary_operator* node, std::uint64_t lhs, std::uint64_t rhs) noexcept
+    {
+        return std::visit([lhs, rhs]<typename T>(const T&) -> std::optional<std::uint64_t>
+        {
+            if constexpr (std::is_same_v<T, node_forward_slash>)
+                return rhs ? std::optional(lhs / rhs) : std::nullopt;
+            else if constexpr (std::is_same_v<T, node_percent>)
+                return rhs ? std::optional(lhs % rhs) : std::nullopt;
+            else if constexpr (std::is_same_v<T, node_asterisk>)
+                return lhs * rhs;
+            else if constexpr (std::is_same_v<T, node_plus>)
+                return lhs + rhs;
+            else
+                return lhs - rhs;
+        }, node->n_value);
+    }
+} // namespace shl
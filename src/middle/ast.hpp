@@ -1,6 +1,10 @@
 #pragma once
 
+#include "common/interner.hpp"
+#include "common/ranged_enum.hpp"
 #include "front/token.hpp" // TODO: try to remove.
+#include <memory_resource>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -62,51 +66,64 @@ namespace shl
     struct node_move {};
 
 
+    // All node types, each with the name of its kind.
+    // This is the only list of them; everything that enumerates node types is generated from it.
+    #define NODE_LIST \
+        (none, std::monostate), \
+        (program, node_program*), \
+        (declaration, node_declaration*), \
+        (definition, node_definition*), \
+        (declare_object, node_declare_object*), \
+        (define_object, node_define_object*), \
+        (function, node_function*), \
+        (named_function, node_named_function*), \
+        (parameter, node_parameter*), \
+        (scope, node_scope*), \
+        (statement, node_statement*), \
+        (scoped_statement, node_scoped_statement*), \
+        (expression, node_expression*), \
+        (term, node_term*), \
+        (return_, node_return*), \
+        (if_, node_if*), \
+        (reassign, node_reassign*), \
+        (scoped_if, node_scoped_if*), \
+        (binary_expression, node_binary_expression*), \
+        (binary_operator, node_binary_operator*), \
+        (parameter_pass, node_parameter_pass*), \
+        (integer_literal, node_integer_literal*), \
+        (identifier, node_identifier*), \
+        (forward_slash, node_forward_slash), \
+        (percent, node_percent), \
+        (asterisk, node_asterisk), \
+        (plus, node_plus), \
+        (minus, node_minus), \
+        (in, node_in), \
+        (out, node_out), \
+        (inout, node_inout), \
+        (copy, node_copy), \
+        (move, node_move)
+
+    #define _NODE_LIST_NAME_(name, type) name
+    #define _NODE_LIST_NAME(args) _NODE_LIST_NAME_ args
+    #define _NODE_LIST_TYPE_(name, type) type
+    #define _NODE_LIST_TYPE(args) _NODE_LIST_TYPE_ args
+
     // All node types.
-    #define NODE_TYPES \
-        std::monostate, \
-        node_program*, \
-        node_declaration*, \
-        node_definition*, \
-        node_declare_object*, \
-        node_define_object*, \
-        node_function*, \
-        node_named_function*, \
-        node_parameter*, \
-        node_scope*, \
-        node_statement*, \
-        node_scoped_statement*, \
-        node_expression*, \
-        node_term*, \
-        node_return*, \
-        node_if*, \
-        node_reassign*, \
-        node_scoped_if*, \
-        node_binary_expression*, \
-        node_binary_operator*, \
-        node_parameter_pass*, \
-        node_integer_literal*, \
-        node_identifier*, \
-        node_forward_slash, \
-        node_percent, \
-        node_asterisk, \
-        node_plus, \
-        node_minus, \
-        node_in, \
-        node_out, \
-        node_inout, \
-        node_copy, \
-        node_move
+    #define NODE_TYPES FOR_EACH_COMMA(_NODE_LIST_TYPE, NODE_LIST)
 
     // Variant of all node types.
     using nodes = std::variant<NODE_TYPES>;
 
+    // The kind of each node type, i.e. its index in nodes.
+    DEFINE_RANGED_ENUM(node_kind, (FOR_EACH_COMMA(_NODE_LIST_NAME, NODE_LIST)), ());
+
 
     // Define all the undefined nodes in the same order.
+    // Lists of child nodes are pmr vectors, so they can be allocated from the same arena as the nodes.
 
     struct node_program
     {
-        std::vector<node_declaration*> declarations; // 1 or more.
+        std::pmr::vector<node_declaration*> declarations; // 1 or more.
     };
 
     struct node_declaration
@@ -134,8 +151,8 @@ namespace shl
 
     struct node_function
     {
-        std::vector<node_declare_object*> return_values; // 0 or more
-        std::vector<node_parameter*> parameters; // 0 or more
+        std::pmr::vector<node_declare_object*> return_values; // 0 or more
+        std::pmr::vector<node_parameter*> parameters; // 0 or more
         node_statement* n_statement;
     };
 
@@ -143,6 +160,8 @@ namespace shl
     {
         node_identifier* n_name;
         node_function* n_function;
+        // The function's mangled signature. Set by semantic analysis.
+        symbol_id signature = symbol_id::empty;
     };
 
     struct node_parameter
@@ -153,7 +172,7 @@ namespace shl
 
     struct node_scope
     {
-        std::vector<node_scoped_statement*> scoped_statements; // 0 or more
+        std::pmr::vector<node_scoped_statement*> scoped_statements; // 0 or more
     };
 
     struct node_statement
@@ -199,7 +218,7 @@ namespace shl
 
     struct node_scoped_if
     {
-        std::vector<node_if*> ifs;
+        std::pmr::vector<node_if*> ifs;
     };
 
     struct node_binary_expression
@@ -228,5 +247,8 @@ namespace shl
     struct node_identifier
     {
         std::string_view value;
+        symbol_id symbol;
+        // If this names an object that was declared elsewhere, the name in its declaration. Set by semantic analysis.
+        node_identifier* declaration = nullptr;
     };
 } // namespace shl
@@ -0,0 +1,368 @@
+#include "constant_folder.hpp"
+#include "common/thread_pool.hpp"
+#include "middle/arithmetic.hpp"
+#include <cassert>
+#include <charconv>
+#include <cstring>
+
+namespace shl
+{
+    // Folds as much of each node as it can without its children.
+    // Every expression leaves its value on the folder's results for whatever it's in to use.
+    struct folding_visitor : node_walker<folding_visitor, constant_folder::frame>
+    {
+        constant_folder& c; // context
+        constant_folder::folder& f;
+
+        [[nodiscard]] explicit folding_visitor(constant_folder& c, constant_folder::folder& f) noexcept : node_walker(f.frames), c(c), f(f) {}
+
+        bool operator()(std::monostate) { return true; }
+
+        bool operator()(node_program* node)
+        {
+            assert(false && "programs are folded a declaration at a time.");
+            return true;
+        }
+
+        bool operator()(node_declaration* node) { return replace(node->n_value); }
+        bool operator()(node_definition* node) { return replace(node->n_value); }
+
+        bool operator()(node_declare_object* node)
+        {
+            assert(!f.functions.empty() && "semantic analysis missed a static object declaration.");
+            f.functions.back().values.insert_or_assign(node->n_name, std::nullopt);
+            return true;
+        }
+
+        bool operator()(node_define_object* node)
+        {
+            if (stage()++ == 0)
+                return push(node->n_expression);
+            std::optional<std::uint64_t> value = pop_result();
+            if (!f.functions.empty())
+                f.functions.back().values.insert_or_assign(node->n_name, value);
+            else if (value)
+                c._initial_values.emplace(node->n_name, *value);
+            return true;
+        }
+
+        bool operator()(node_function* node)
+        {
+            assert(false && "unnamed function unimplemented.");
+            return true;
+        }
+
+        bool operator()(node_named_function* node)
+        {
+            if (stage()++ == 0)
+            {
+                auto& function = f.functions.emplace_back();
+                function.arm_base = f.arms.size();
+                // Parameters and return values are set by the caller.
+                for (auto n_parameter : node->n_function->parameters)
+                    function.values.emplace(n_parameter->n_declare_object->n_name, std::nullopt);
+                for (auto n_return_value : node->n_function->return_values)
+                    function.values.emplace(n_return_value->n_name, std::nullopt);
+                return push(node->n_function->n_statement);
+            }
+            f.functions.pop_back();
+            return true;
+        }
+
+        bool operator()(node_parameter* node) { return true; }
+
+        bool operator()(node_scope* node)
+        {
+            std::uint32_t i = stage()++;
+            if (i < node->scoped_statements.size())
+                return push(node->scoped_statements[i]);
+            return true;
+        }
+
+        bool operator()(node_statement* node)
+        {
+            auto n_if = std::get_if<node_if*>(&node->n_value);
+            if (!n_if)
+                return replace(node->n_value);
+
+            switch (stage()++)
+            {
+            case 0:
+                return push((*n_if)->n_expression);
+            case 1:
+                if (std::optional<std::uint64_t> condition = pop_result())
+                {
+                    // Replace the if with its statement, or with nothing, then fold whatever replaced it.
+                    node->n_value = *condition ? (*n_if)->n_statement->n_value : decltype(node->n_value)();
+                    stage() = 0;
+                    return false;
+                }
+                frame().changed_begin = f.changed.size();
+                begin_arm();
+                return push((*n_if)->n_statement);
+            default:
+                end_arm();
+                end_conditional(frame().changed_begin);
+                return true;
+            }
+        }
+
+        bool operator()(node_scoped_statement* node)
+        {
+            auto n_scoped_if = std::get_if<node_scoped_if*>(&node->n_value);
+            if (!n_scoped_if)
+                return replace(node->n_value);
+
+            // Each if takes three stages: one before its expression, one before its statement, and one after.
+            auto& ifs = (*n_scoped_if)->ifs;
+            auto& fr = frame();
+            std::uint32_t stage = fr.stage++;
+            std::size_t i = stage / 3;
+            if (stage == 0)
+                fr.changed_begin = f.changed.size();
+
+            switch (stage % 3)
+            {
+            case 0:
+                if (i == ifs.size())
+                {
+                    ifs.resize(fr.kept);
+                    end_conditional(fr.changed_begin);
+                    // Every if was removed.
+                    if (ifs.empty())
+                        node->n_value = f.allocator->allocate<node_statement>();
+                    return true;
+                }
+                if (ifs[i]->n_expression)
+                    return push(ifs[i]->n_expression);
+                ++fr.stage; // Else blocks have no expression to wait for.
+                [[fallthrough]];
+            case 1:
+            {
+                // Else blocks are always taken if they're reached.
+                std::optional<std::uint64_t> condition = ifs[i]->n_expression ? pop_result() : std::optional<std::uint64_t>(1);
+                if (condition && !*condition)
+                {
+                    // Never taken, so remove it.
+                    fr.stage = static_cast<std::uint32_t>(3 * (i + 1));
+                    return false;
+                }
+                if (condition)
+                {
+                    // Always taken if it's reached, so nothing after it is.
+                    if (fr.kept == 0)
+                    {
+                        // Nothing before it was kept, so it's always taken. Replace everything with its statement.
+                        node->n_value = ifs[i]->n_statement;
+                        fr.stage = 0;
+                        return false;
+                    }
+                    ifs[i]->n_expression = nullptr;
+                    ifs.resize(i + 1);
+                }
+                ifs[fr.kept++] = ifs[i];
+                begin_arm();
+                return push(ifs[i]->n_statement);
+            }
+            default:
+                end_arm();
+                return false;
+            }
+        }
+
+        bool operator()(node_expression* node)
+        {
+            if (stage()++ == 0)
+                return push(node->n_value);
+            if (std::holds_alternative<node_binary_expression*>(node->n_value) && f.results.back())
+                node->n_value = f.allocator->allocate<node_term>(make_literal(*f.results.back()));
+            return true;
+        }
+
+        bool operator()(node_term* node)
+        {
+            if (stage()++ == 0)
+                return push(node->n_value);
+            if (!std::holds_alternative<node_integer_literal*>(node->n_value) && f.results.back())
+                node->n_value = make_literal(*f.results.back());
+            return true;
+        }
+
+        bool operator()(node_return* node) { return true; }
+
+        bool operator()(node_if* node)
+        {
+            assert(false && "ifs are folded by the statements they're in.");
+            return true;
+        }
+
+        bool operator()(node_reassign* node)
+        {
+            if (stage()++ == 0)
+                return push(node->n_expression);
+            assign(node->n_identifier->declaration, pop_result());
+            return true;
+        }
+
+        bool operator()(node_scoped_if* node)
+        {
+            assert(false && "scoped ifs are folded by the scoped statements they're in.");
+            return true;
+        }
+
+        bool operator()(node_binary_expression* node)
+        {
+            switch (stage()++)
+            {
+            case 0:
+                return push(node->n_expression_lhs);
+            case 1:
+                return push(node->n_expression_rhs);
+            }
+            std::optional<std::uint64_t> rhs = pop_result();
+            std::optional<std::uint64_t> lhs = pop_result();
+            f.results.push_back(lhs && rhs ? evaluate(node->n_binary_operator, *lhs, *rhs) : std::nullopt);
+            return true;
+        }
+
+        bool operator()(node_binary_operator* node) { return true; }
+        bool operator()(node_parameter_pass* node) { return true; }
+
+        bool operator()(node_integer_literal* node)
+        {
+            // Literals too big for 64 bits are left for the generators to report.
+            f.results.push_back(get_value(node));
+            return true;
+        }
+
+        bool operator()(node_identifier* node)
+        {
+            // Outside of functions, this is a global object's initializer, which runs before any function can change others.
+            if (f.functions.empty())
+            {
+                auto value = c._initial_values.find(node->declaration);
+                f.results.push_back(value != c._initial_values.end() ? std::optional(value->second) : std::nullopt);
+            }
+            else
+            {
+                auto& values = f.functions.back().values;
+                auto value = values.find(node->declaration);
+                f.results.push_back(value != values.end() ? value->second : std::nullopt);
+            }
+            return true;
+        }
+
+        bool operator()(node_forward_slash) { return true; }
+        bool operator()(node_percent) { return true; }
+        bool operator()(node_asterisk) { return true; }
+        bool operator()(node_plus) { return true; }
+        bool operator()(node_minus) { return true; }
+        bool operator()(node_in) { return true; }
+        bool operator()(node_out) { return true; }
+        bool operator()(node_inout) { return true; }
+        bool operator()(node_copy) { return true; }
+        bool operator()(node_move) { return true; }
+
+    private:
+        [[nodiscard]] std::optional<std::uint64_t> pop_result()
+        {
+            std::optional<std::uint64_t> result = f.results.back();
+            f.results.pop_back();
+            return result;
+        }
+
+        // Sets the value of the object, if it's in the current function.
+        void assign(const node_identifier* declaration, std::optional<std::uint64_t> value)
+        {
+            if (f.functions.empty())
+                return;
+            auto& function = f.functions.back();
+            auto current = function.values.find(declaration);
+            if (current == function.values.end())
+                return;
+            // Remember the value from before the arm, to restore when it's done.
+            if (f.arms.size() > function.arm_base)
+                f.changes.emplace_back(declaration, current->second);
+            current->second = value;
+        }
+
+        void begin_arm()
+        {
+            f.arms.push_back(f.changes.size());
+        }
+
+        // Restores the values of the objects changed in the arm, so the next arm starts from the same values.
+        void end_arm()
+        {
+            auto& values = f.functions.back().values;
+            for (std::size_t i = f.changes.size(); i > f.arms.back(); --i)
+            {
+                values[f.changes[i - 1].declaration] = f.changes[i - 1].value;
+                f.changed.push_back(f.changes[i - 1].declaration);
+            }
+            f.changes.resize(f.arms.back());
+            f.arms.pop_back();
+        }
+
+        // Forgets the values of the objects changed in any of the conditional's arms, since any of them may have run.
+        void end_conditional(std::size_t changed_begin)
+        {
+            for (std::size_t i = changed_begin; i < f.changed.size(); ++i)
+                assign(f.changed[i], std::nullopt);
+            f.changed.resize(changed_begin);
+        }
+
+        // Returns an integer literal with the value.
+        [[nodiscard]] node_integer_literal* make_literal(std::uint64_t value)
+        {
+            char buffer[20]; // The most digits a 64-bit unsigned integer has.
+            std::size_t size = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer;
+            char* text = static_cast<char*>(f.allocator->allocate_bytes(size, 1));
+            std::memcpy(text, buffer, size);
+            return f.allocator->allocate<node_integer_literal>(std::string_view(text, size));
+        }
+    };
+
+    void constant_folder::operator()()
+    {
+        std::vector<folder> folders(1);
+        _allocators.push_back(std::make_unique<arena_allocator>(64 * 1024)); // 64 KiB first block.
+        folders.front().allocator = _allocators.front().get();
+
+        // Fold global objects' initializers in order first, since each may use the initial values of those before it.
+        std::vector<node_declaration*> functions;
+        for (auto n_declaration : _root->declarations)
+        {
+            auto n_definition = std::get_if<node_definition*>(&n_declaration->n_value);
+            if (n_definition && std::holds_alternative<node_define_object*>((*n_definition)->n_value))
+                fold(folders.front(), n_declaration->n_value);
+            else
+                functions.push_back(n_declaration);
+        }
+
+        // Then the functions, which don't depend on each other.
+        auto fold_function = [&](std::size_t function_index, std::size_t thread_index)
+        {
+            fold(folders[thread_index], functions[function_index]->n_value);
+        };
+        thread_pool* pool;
+        if (functions.size() >= min_parallel_function_count && (pool = &get_thread_pool())->get_thread_count() > 1)
+        {
+            folders.resize(pool->get_thread_count());
+            for (std::size_t i = 1; i < folders.size(); ++i)
+            {
+                _allocators.push_back(std::make_unique<arena_allocator>(64 * 1024)); // 64 KiB first block.
+                folders[i].allocator = _allocators[i].get();
+            }
+            pool->run(functions.size(), fold_function);
+        }
+        else for (std::size_t i = 0; i < functions.size(); ++i)
+            fold_function(i, 0);
+    }
+
+    void constant_folder::fold(folder& folder, node_ref root)
+    {
+        folding_visitor(*this, folder).walk(root);
+        assert(folder.functions.empty() && folder.arms.empty() && folder.changed.empty() && folder.results.empty());
+    }
+} // namespace shl
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "common/arena_allocator.hpp"
+#include "middle/ast.hpp"
+#include "middle/node_ref.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace shl
+{
+    struct folding_visitor; // implementation
+
+    // Simplifies a well-formed program before it's generated, with the language's unsigned 64-bit arithmetic:
+    // constant subexpressions are evaluated, uses of local objects whose values are known are replaced with them,
+    // and ifs whose conditions are known are either removed or replaced with their statements.
+    // Global objects' initializers are folded with the initial values of the global objects before them,
+    // so any that are constant end up as a single integer literal the generator can put straight in the data section.
+    // Dividing by zero isn't folded, so the program still traps at run time.
+    // Functions don't depend on each other here, so they're folded on every thread of the thread pool.
+    class constant_folder
+    {
+    public:
+        [[nodiscard]] explicit constant_folder(node_program* root) noexcept : _root(root) {}
+
+        constant_folder(const constant_folder&) = delete;
+        constant_folder(constant_folder&&) = delete;
+        constant_folder& operator=(const constant_folder&) = delete;
+        constant_folder& operator=(constant_folder&&) = delete;
+
+        // The nodes it adds live as long as the constant folder.
+        void operator()();
+
+    private:
+        // A function whose body is being folded.
+        struct function_scope
+        {
+            // The value of each of the function's objects declared so far, if it's known, by the name in its declaration.
+            // Global objects aren't here, since any function could change them.
+            std::unordered_map<const node_identifier*, std::optional<std::uint64_t>> values;
+            // How many arms were being folded when the function began. Only later ones are the function's.
+            std::size_t arm_base = 0;
+        };
+
+        // An object's value before it was changed in an arm.
+        struct change
+        {
+            const node_identifier* declaration;
+            std::optional<std::uint64_t> value;
+        };
+
+        // A node being folded, and how many times it's been resumed.
+        struct frame
+        {
+            node_ref node;
+            std::uint32_t stage = 0;
+            // For conditionals, where the objects changed in their arms begin in the folder's list of them.
+            std::size_t changed_begin = 0;
+            // For scoped ifs, how many ifs have been kept.
+            std::size_t kept = 0;
+        };
+
+        // The state of folding top-level declarations. Each thread has its own.
+        // An arm is the statement of an if whose condition isn't known, which may or may not run.
+        struct folder
+        {
+            // Where the nodes replacing folded ones are allocated.
+            arena_allocator* allocator;
+            // The functions being folded, innermost last.
+            std::vector<function_scope> functions;
+            // The values objects had before they were changed in the arms being folded, in order.
+            std::vector<change> changes;
+            // Where each arm being folded begins in changes, innermost last.
+            std::vector<std::size_t> arms;
+            // The objects changed in the arms of the conditionals being folded, whose values are unknown after them.
+            std::vector<const node_identifier*> changed;
+            // The values of the expressions folded so far and not yet used, if they're known.
+            std::vector<std::optional<std::uint64_t>> results;
+            std::vector<frame> frames;
+        };
+
+    private:
+        // Folds the node and everything under it.
+        void fold(folder& folder, node_ref root);
+
+        friend struct folding_visitor;
+
+    private:
+        // Fewer functions than this aren't worth waking other threads for.
+        static constexpr std::size_t min_parallel_function_count = 16;
+
+        node_program* _root;
+        // The initial values of the global objects folded so far whose initializers are constant, by the name in their declaration.
+        // Only added to before any functions are folded, so they can all read it at once.
+        std::unordered_map<const node_identifier*, std::uint64_t> _initial_values;
+        // One arena per thread, so threads never contend on allocation.
+        std::vector<std::unique_ptr<arena_allocator>> _allocators;
+    };
+} // namespace shl
@@ -0,0 +1,340 @@
+#include "flat_ast.hpp"
+#include "common/error.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+
+namespace shl
+{
+    // Flattens the pointer AST in post-order, so every node's children are added before it.
+    // Each node pushes its children first, and is added when it's resumed once they're flattened.
+    struct flat_ast_builder : node_walker<flat_ast_builder>
+    {
+        flat_ast& ast;
+        // Handles of flattened nodes, waiting for their parent to be flattened.
+        std::vector<node_handle>& handles;
+        // Each identifier's characters, by symbol, so repeated identifiers share them.
+        std::vector<string_range>& symbol_strings;
+        // The handle of each identifier that isn't a use, i.e. each name in a declaration, so uses can refer to it.
+        // Declarations always come before their uses, so they're flattened first.
+        std::unordered_map<const node_identifier*, node_handle>& declarations;
+
+        [[nodiscard]] explicit flat_ast_builder(flat_ast& ast, std::vector<node_frame>& frames, std::vector<node_handle>& handles,
+            std::vector<string_range>& symbol_strings, std::unordered_map<const node_identifier*, node_handle>& declarations) noexcept
+            : node_walker(frames), ast(ast), handles(handles), symbol_strings(symbol_strings), declarations(declarations) {}
+
+        bool operator()(std::monostate)
+        {
+            handles.push_back(node_handle::none);
+            return true;
+        }
+
+        bool operator()(const node_program* node)
+        {
+            if (stage()++ == 0) return expand(node->declarations);
+            return finish<flat::program>(node->declarations.size(), [&](auto c) { return flat::program{range(c, node->declarations.size())}; });
+        }
+
+        bool operator()(const node_declaration* node)
+        {
+            if (stage()++ == 0) return expand(node->n_value);
+            return finish<flat::declaration>(1, [](auto c) { return flat::declaration{c[0]}; });
+        }
+
+        bool operator()(const node_definition* node)
+        {
+            if (stage()++ == 0) return expand(node->n_value);
+            return finish<flat::definition>(1, [](auto c) { return flat::definition{c[0]}; });
+        }
+
+        bool operator()(const node_declare_object* node)
+        {
+            if (stage()++ == 0) return expand(node->n_name, node->n_type);
+            return finish<flat::declare_object>(2, [](auto c) { return flat::declare_object{c[0], c[1]}; });
+        }
+
+        bool operator()(const node_define_object* node)
+        {
+            if (stage()++ == 0) return expand(node->n_name, node->n_type, node->n_expression);
+            return finish<flat::define_object>(3, [](auto c) { return flat::define_object{c[0], c[1], c[2]}; });
+        }
+
+        bool operator()(const node_function* node)
+        {
+            if (stage()++ == 0) return expand(node->return_values, node->parameters, node->n_statement);
+            std::size_t return_value_count = node->return_values.size();
+            std::size_t parameter_count = node->parameters.size();
+            return finish<flat::function>(return_value_count + parameter_count + 1, [&](auto c)
+            {
+                return flat::function{range(c, return_value_count), range(c.subspan(return_value_count), parameter_count), c.back()};
+            });
+        }
+
+        bool operator()(const node_named_function* node)
+        {
+            if (stage()++ == 0) return expand(node->n_name, node->n_function);
+            string_range signature = ast.add_string(get_interner().get(node->signature));
+            return finish<flat::named_function>(2, [&](auto c) { return flat::named_function{c[0], c[1], signature}; });
+        }
+
+        bool operator()(const node_parameter* node)
+        {
+            if (stage()++ == 0) return expand(node->n_pass, node->n_declare_object);
+            return finish<flat::parameter>(2, [](auto c) { return flat::parameter{c[0], c[1]}; });
+        }
+
+        bool operator()(const node_scope* node)
+        {
+            if (stage()++ == 0) return expand(node->scoped_statements);
+            return finish<flat::scope>(node->scoped_statements.size(), [&](auto c) { return flat::scope{range(c, node->scoped_statements.size())}; });
+        }
+
+        bool operator()(const node_statement* node)
+        {
+            if (stage()++ == 0) return expand(node->n_value);
+            return finish<flat::statement>(1, [](auto c) { return flat::statement{c[0]}; });
+        }
+
+        bool operator()(const node_scoped_statement* node)
+        {
+            if (stage()++ == 0) return expand(node->n_value);
+            return finish<flat::scoped_statement>(1, [](auto c) { return flat::scoped_statement{c[0]}; });
+        }
+
+        bool operator()(const node_expression* node)
+        {
+            if (stage()++ == 0) return expand(node->n_value);
+            return finish<flat::expression>(1, [](auto c) { return flat::expression{c[0]}; });
+        }
+
+        bool operator()(const node_term* node)
+        {
+            if (stage()++ == 0) return expand(node->n_value);
+            return finish<flat::term>(1, [](auto c) { return flat::term{c[0]}; });
+        }
+
+        bool operator()(const node_return* node)
+        {
+            handles.push_back(ast.add(node_kind::return_));
+            return true;
+        }
+
+        bool operator()(const node_if* node)
+        {
+            if (stage()++ == 0) return expand(node->n_expression, node->n_statement);
+            return finish<flat::if_>(2, [](auto c) { return flat::if_{c[0], c[1]}; });
+        }
+
+        bool operator()(const node_reassign* node)
+        {
+            if (stage()++ == 0) return expand(node->n_identifier, node->n_expression);
+            return finish<flat::reassign>(2, [](auto c) { return flat::reassign{c[0], c[1]}; });
+        }
+
+        bool operator()(const node_scoped_if* node)
+        {
+            if (stage()++ == 0) return expand(node->ifs);
+            return finish<flat::scoped_if>(node->ifs.size(), [&](auto c) { return flat::scoped_if{range(c, node->ifs.size())}; });
+        }
+
+        bool operator()(const node_binary_expression* node)
+        {
+            if (stage()++ == 0) return expand(node->n_expression_lhs, node->n_binary_operator, node->n_expression_rhs);
+            return finish<flat::binary_expression>(3, [](auto c) { return flat::binary_expression{c[0], c[1], c[2]}; });
+        }
+
+        bool operator()(const node_binary_operator* node)
+        {
+            if (stage()++ == 0) return expand(node->n_value);
+            return finish<flat::binary_operator>(1, [](auto c) { return flat::binary_operator{c[0]}; });
+        }
+
+        bool operator()(const node_parameter_pass* node)
+        {
+            if (stage()++ == 0) return expand(node->n_value);
+            return finish<flat::parameter_pass>(1, [](auto c) { return flat::parameter_pass{c[0]}; });
+        }
+
+        bool operator()(const node_integer_literal* node)
+        {
+            handles.push_back(ast.add(flat::integer_literal{ast.add_string(node->value)}));
+            return true;
+        }
+
+        bool operator()(const node_identifier* node)
+        {
+            string_range& value = symbol_strings[std::to_underlying(node->symbol)];
+            if (value.offset == std::numeric_limits<std::uint32_t>::max())
+                value = ast.add_string(node->value);
+            node_handle declaration = node_handle::none;
+            if (node->declaration)
+            {
+                assert(declarations.contains(node->declaration) && "a use was flattened before its declaration.");
+                declaration = declarations[node->declaration];
+            }
+            handles.push_back(ast.add(flat::identifier{value, node->symbol, declaration}));
+            if (!node->declaration)
+                declarations.emplace(node, handles.back());
+            return true;
+        }
+
+        bool operator()(node_forward_slash) { return add_kind(node_kind::forward_slash); }
+        bool operator()(node_percent) { return add_kind(node_kind::percent); }
+        bool operator()(node_asterisk) { return add_kind(node_kind::asterisk); }
+        bool operator()(node_plus) { return add_kind(node_kind::plus); }
+        bool operator()(node_minus) { return add_kind(node_kind::minus); }
+        bool operator()(node_in) { return add_kind(node_kind::in); }
+        bool operator()(node_out) { return add_kind(node_kind::out); }
+        bool operator()(node_inout) { return add_kind(node_kind::inout); }
+        bool operator()(node_copy) { return add_kind(node_kind::copy); }
+        bool operator()(node_move) { return add_kind(node_kind::move); }
+
+    private:
+        // Pushes the children to be flattened, in reverse so they're flattened in order.
+        template <typename... Children>
+        bool expand(const Children&... children)
+        {
+            std::size_t begin = _frames.size();
+            (push(children), ...);
+            std::reverse(_frames.begin() + begin, _frames.end());
+            return false;
+        }
+
+        using node_walker::push;
+
+        template <typename T>
+        void push(const std::pmr::vector<T*>& children)
+        {
+            for (T* child : children)
+                push(child);
+        }
+
+        // Adds the node, built from the handles of its last child_count flattened children.
+        template <typename T, typename Build>
+        bool finish(std::size_t child_count, const Build& build)
+        {
+            T node = build(std::span(handles).last(child_count));
+            handles.resize(handles.size() - child_count);
+            handles.push_back(ast.add(node));
+            return true;
+        }
+
+        bool add_kind(node_kind kind)
+        {
+            handles.push_back(ast.add(kind));
+            return true;
+        }
+
+        [[nodiscard]] node_range range(std::span<const node_handle> children, std::size_t count)
+        {
+            return ast.add_children(children.first(count));
+        }
+    };
+
+    flat_ast::flat_ast(node_program* root)
+    {
+        add(node_kind::none);
+
+        std::vector<node_frame> frames;
+        std::vector<node_handle> handles;
+        std::vector<string_range> symbol_strings(get_interner().size(), {std::numeric_limits<std::uint32_t>::max(), 0});
+        std::unordered_map<const node_identifier*, node_handle> declarations;
+        flat_ast_builder(*this, frames, handles, symbol_strings, declarations).walk(root);
+        assert(handles.size() == 1 && handles.back() == get_root());
+    }
+
+    // Each array is written as its element count followed by its elements.
+    // All elements are trivially copyable, so each array is one memcpy.
+
+    template <typename T>
+    static void write_array(std::vector<std::byte>& buffer, const std::vector<T>& array)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::uint64_t count = array.size();
+        std::size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(count) + count * sizeof(T));
+        std::memcpy(buffer.data() + offset, &count, sizeof(count));
+        std::memcpy(buffer.data() + offset + sizeof(count), array.data(), count * sizeof(T));
+    }
+
+    template <typename T>
+    static void read_array(std::span<const std::byte>& buffer, std::vector<T>& array)
+    {
+        std::uint64_t count;
+        if (buffer.size() < sizeof(count))
+            error_exit("Flat AST", "Serialized tree is truncated");
+        std::memcpy(&count, buffer.data(), sizeof(count));
+        // Divided instead of multiplied, so a corrupt count can't overflow.
+        if (count > (buffer.size() - sizeof(count)) / sizeof(T))
+            error_exit("Flat AST", "Serialized tree is truncated");
+        array.resize(count);
+        std::memcpy(array.data(), buffer.data() + sizeof(count), count * sizeof(T));
+        buffer = buffer.subspan(sizeof(count) + count * sizeof(T));
+    }
+
+    flat_ast::flat_ast(std::span<const std::byte> buffer)
+    {
+        read_array(buffer, _kinds);
+        read_array(buffer, _slots);
+        read_array(buffer, _children);
+        read_array(buffer, _strings);
+        std::apply([&](auto&... pools) { (read_array(buffer, pools), ...); }, _pools);
+        if (_kinds.empty() || _slots.size() != _kinds.size())
+            error_exit("Flat AST", "Serialized tree is malformed");
+
+        for (flat::identifier& identifier : std::get<std::vector<flat::identifier>>(_pools))
+            identifier.symbol = get_interner().intern(get_string(identifier.value));
+    }
+
+    std::size_t flat_ast::get_memory_usage() const noexcept
+    {
+        std::size_t size = _kinds.size() * sizeof(node_kind)
+            + _slots.size() * sizeof(std::uint32_t)
+            + _children.size() * sizeof(node_handle)
+            + _strings.size();
+        std::apply([&](auto&... pools) { ((size += pools.size() * sizeof(pools[0])), ...); }, _pools);
+        return size;
+    }
+
+    void flat_ast::serialize(std::vector<std::byte>& buffer) const
+    {
+        write_array(buffer, _kinds);
+        write_array(buffer, _slots);
+        write_array(buffer, _children);
+        write_array(buffer, _strings);
+        std::apply([&](auto&... pools) { (write_array(buffer, pools), ...); }, _pools);
+    }
+
+    template <typename T>
+    node_handle flat_ast::add(const T& node)
+    {
+        auto& pool = std::get<std::vector<T>>(_pools);
+        _kinds.push_back(T::kind);
+        _slots.push_back(static_cast<std::uint32_t>(pool.size()));
+        pool.push_back(node);
+        return static_cast<node_handle>(_kinds.size() - 1);
+    }
+
+    node_handle flat_ast::add(node_kind kind)
+    {
+        _kinds.push_back(kind);
+        _slots.push_back(0);
+        return static_cast<node_handle>(_kinds.size() - 1);
+    }
+
+    node_range flat_ast::add_children(std::span<const node_handle> children)
+    {
+        node_range range{static_cast<std::uint32_t>(_children.size()), static_cast<std::uint32_t>(children.size())};
+        _children.insert(_children.end(), children.begin(), children.end());
+        return range;
+    }
+
+    string_range flat_ast::add_string(std::string_view string)
+    {
+        string_range range{static_cast<std::uint32_t>(_strings.size()), static_cast<std::uint32_t>(string.size())};
+        _strings.insert(_strings.end(), string.begin(), string.end());
+        return range;
+    }
+} // namespace shl
@@ -0,0 +1,320 @@
+#pragma once
+
+#include "common/interner.hpp"
+#include "middle/ast.hpp"
+#include "middle/node_ref.hpp"
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace shl
+{
+    // Indexes a node in a flat_ast.
+    // The none node is always first, and stands in for missing children.
+    enum class node_handle : std::uint32_t
+    {
+        none = 0,
+    };
+
+    [[nodiscard]] constexpr auto operator+(const node_handle handle) noexcept
+    {
+        return std::to_underlying(handle);
+    }
+
+    // A list of children, as a range of the flat_ast's shared child handles.
+    struct node_range
+    {
+        std::uint32_t offset;
+        std::uint32_t count;
+    };
+
+    // Characters in the flat_ast's string pool.
+    struct string_range
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    // The fields of each kind of node that has any, named after their pointer AST counterparts.
+    // Nodes without fields, i.e. returns, operators and parameter passes, are only a kind.
+    namespace flat
+    {
+        struct program
+        {
+            static constexpr node_kind kind = node_kind::program;
+            node_range declarations;
+        };
+
+        struct declaration
+        {
+            static constexpr node_kind kind = node_kind::declaration;
+            node_handle n_value;
+        };
+
+        struct definition
+        {
+            static constexpr node_kind kind = node_kind::definition;
+            node_handle n_value;
+        };
+
+        struct declare_object
+        {
+            static constexpr node_kind kind = node_kind::declare_object;
+            node_handle n_name;
+            node_handle n_type;
+        };
+
+        struct define_object
+        {
+            static constexpr node_kind kind = node_kind::define_object;
+            node_handle n_name;
+            node_handle n_type;
+            node_handle n_expression;
+        };
+
+        struct function
+        {
+            static constexpr node_kind kind = node_kind::function;
+            node_range return_values;
+            node_range parameters;
+            node_handle n_statement;
+        };
+
+        struct named_function
+        {
+            static constexpr node_kind kind = node_kind::named_function;
+            node_handle n_name;
+            node_handle n_function;
+            // The function's mangled signature. Set by semantic analysis.
+            string_range signature;
+        };
+
+        struct parameter
+        {
+            static constexpr node_kind kind = node_kind::parameter;
+            node_handle n_pass;
+            node_handle n_declare_object;
+        };
+
+        struct scope
+        {
+            static constexpr node_kind kind = node_kind::scope;
+            node_range scoped_statements;
+        };
+
+        struct statement
+        {
+            static constexpr node_kind kind = node_kind::statement;
+            node_handle n_value; // node_handle::none for empty statements.
+        };
+
+        struct scoped_statement
+        {
+            static constexpr node_kind kind = node_kind::scoped_statement;
+            node_handle n_value;
+        };
+
+        struct expression
+        {
+            static constexpr node_kind kind = node_kind::expression;
+            node_handle n_value;
+        };
+
+        struct term
+        {
+            static constexpr node_kind kind = node_kind::term;
+            node_handle n_value;
+        };
+
+        struct if_
+        {
+            static constexpr node_kind kind = node_kind::if_;
+            node_handle n_expression; // node_handle::none for else.
+            node_handle n_statement;
+        };
+
+        struct reassign
+        {
+            static constexpr node_kind kind = node_kind::reassign;
+            node_handle n_identifier;
+            node_handle n_expression;
+        };
+
+        struct scoped_if
+        {
+            static constexpr node_kind kind = node_kind::scoped_if;
+            node_range ifs;
+        };
+
+        struct binary_expression
+        {
+            static constexpr node_kind kind = node_kind::binary_expression;
+            node_handle n_expression_lhs;
+            node_handle n_binary_operator;
+            node_handle n_expression_rhs;
+        };
+
+        struct binary_operator
+        {
+            static constexpr node_kind kind = node_kind::binary_operator;
+            node_handle n_value;
+        };
+
+        struct parameter_pass
+        {
+            static constexpr node_kind kind = node_kind::parameter_pass;
+            node_handle n_value;
+        };
+
+        struct integer_literal
+        {
+            static constexpr node_kind kind = node_kind::integer_literal;
+            string_range value;
+        };
+
+        struct identifier
+        {
+            static constexpr node_kind kind = node_kind::identifier;
+            string_range value;
+            // Only meaningful in the process that interned it.
+            symbol_id symbol;
+            // If this names an object that was declared elsewhere, the name in its declaration, like node_identifier's.
+            node_handle declaration;
+        };
+    } // namespace flat
+
+    // An alternative store for the AST, made of a few contiguous arrays instead of linked nodes:
+    // node kinds in one array, each node's fields in a pool per kind, children as 32-bit handles,
+    // and child lists as ranges of one shared handle array.
+    // There are no pointers in it, so the whole tree can be copied or serialized an array at a time.
+    class flat_ast
+    {
+    public:
+        // Copies the tree under root. It's walked with an explicit stack, so any depth is fine.
+        // Children are always flattened before their parents, so the root is the last node.
+        [[nodiscard]] explicit flat_ast(node_program* root);
+
+        // Reads back a tree written by serialize.
+        // Identifiers are re-interned, since symbols are only meaningful in the process that interned them.
+        // Every array is checked to fit in the buffer, but the nodes in them are trusted to be as serialize wrote them.
+        [[nodiscard]] explicit flat_ast(std::span<const std::byte> buffer);
+
+        [[nodiscard]] node_handle get_root() const noexcept
+        {
+            return static_cast<node_handle>(_kinds.size() - 1);
+        }
+
+        [[nodiscard]] node_kind get_kind(node_handle handle) const noexcept
+        {
+            return _kinds[+handle];
+        }
+
+        // Returns the node's fields. The node must be of the given type's kind.
+        template <typename T>
+        [[nodiscard]] const T& get(node_handle handle) const noexcept
+        {
+            assert(get_kind(handle) == T::kind);
+            return std::get<std::vector<T>>(_pools)[_slots[+handle]];
+        }
+
+        // Calls visitor with the node's fields, or with its kind if it has none, like visit_node on the pointer AST.
+        // Each node kind has its own entry in a table built at compile time, so dispatching is one indirect call.
+        template <typename Visitor>
+        decltype(auto) visit(Visitor&& visitor, node_handle handle) const
+        {
+            using result = std::invoke_result_t<Visitor&, node_kind>;
+            using handler = result(*)(const flat_ast&, Visitor&, node_handle);
+            static constexpr auto handlers = []<std::size_t... kinds>(std::index_sequence<kinds...>)
+            {
+                return std::array<handler, sizeof...(kinds)>
+                {
+                    [](const flat_ast& ast, Visitor& visitor, node_handle handle) -> result
+                    {
+                        constexpr std::size_t pool = get_pool_index<static_cast<node_kind>(kinds)>(std::type_identity<pools>());
+                        if constexpr (pool < std::tuple_size_v<pools>)
+                            return visitor(std::get<pool>(ast._pools)[ast._slots[+handle]]);
+                        else
+                            return visitor(static_cast<node_kind>(kinds));
+                    }...
+                };
+            }(std::make_index_sequence<+node_kind::_count>());
+            return handlers[+get_kind(handle)](*this, visitor, handle);
+        }
+
+        [[nodiscard]] std::span<const node_handle> get_children(node_range range) const noexcept
+        {
+            return std::span(_children).subspan(range.offset, range.count);
+        }
+
+        [[nodiscard]] std::string_view get_string(string_range range) const noexcept
+        {
+            return std::string_view(_strings).substr(range.offset, range.length);
+        }
+
+        // Returns the number of nodes, including the none node.
+        [[nodiscard]] std::size_t size() const noexcept { return _kinds.size(); }
+
+        // Returns the number of bytes the tree takes up, excluding unused capacity.
+        [[nodiscard]] std::size_t get_memory_usage() const noexcept;
+
+        // Appends the tree to the buffer, an array at a time.
+        void serialize(std::vector<std::byte>& buffer) const;
+
+    private:
+        // Returns the index of the kind's pool, or the number of pools if its nodes have no fields.
+        template <node_kind kind, typename... Ts>
+        static consteval std::size_t get_pool_index(std::type_identity<std::tuple<std::vector<Ts>...>>) noexcept
+        {
+            std::size_t index = 0;
+            (void)((Ts::kind == kind ? false : (++index, true)) && ...);
+            return index;
+        }
+
+        template <typename T>
+        node_handle add(const T& node);
+        node_handle add(node_kind kind);
+        [[nodiscard]] node_range add_children(std::span<const node_handle> children);
+        [[nodiscard]] string_range add_string(std::string_view string);
+
+        friend struct flat_ast_builder;
+
+    private:
+        using pools = std::tuple<
+            std::vector<flat::program>,
+            std::vector<flat::declaration>,
+            std::vector<flat::definition>,
+            std::vector<flat::declare_object>,
+            std::vector<flat::define_object>,
+            std::vector<flat::function>,
+            std::vector<flat::named_function>,
+            std::vector<flat::parameter>,
+            std::vector<flat::scope>,
+            std::vector<flat::statement>,
+            std::vector<flat::scoped_statement>,
+            std::vector<flat::expression>,
+            std::vector<flat::term>,
+            std::vector<flat::if_>,
+            std::vector<flat::reassign>,
+            std::vector<flat::scoped_if>,
+            std::vector<flat::binary_expression>,
+            std::vector<flat::binary_operator>,
+            std::vector<flat::parameter_pass>,
+            std::vector<flat::integer_literal>,
+            std::vector<flat::identifier>
+        >;
+
+        std::vector<node_kind> _kinds;
+        // Each node's index into the pool for its kind, or 0 if its kind has no fields.
+        std::vector<std::uint32_t> _slots;
+        std::vector<node_handle> _children;
+        std::vector<char> _strings;
+        pools _pools;
+    };
+} // namespace shl
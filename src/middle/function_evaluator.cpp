@@ -0,0 +1,211 @@
+#include "function_evaluator.hpp"
+#include "middle/arithmetic.hpp"
+#include <cassert>
+
+namespace shl
+{
+    // Runs as much of each node as it can without its children.
+    // Every expression leaves its value on the evaluator's results for whatever it's in to use.
+    struct evaluating_visitor : node_walker<evaluating_visitor>
+    {
+        function_evaluator& e; // context
+
+        [[nodiscard]] explicit evaluating_visitor(function_evaluator& e) noexcept : node_walker(e._frames), e(e) {}
+
+        bool operator()(std::monostate) { return true; }
+
+        bool operator()(node_program* node)
+        {
+            assert(false && "programs can't be run.");
+            return true;
+        }
+
+        bool operator()(node_declaration* node) { return replace(node->n_value); }
+        bool operator()(node_definition* node) { return replace(node->n_value); }
+
+        bool operator()(node_declare_object* node)
+        {
+            e._values.emplace(node->n_name, std::nullopt);
+            return true;
+        }
+
+        bool operator()(node_define_object* node)
+        {
+            if (stage()++ == 0)
+                return push(node->n_expression);
+            e._values.emplace(node->n_name, pop_result());
+            return true;
+        }
+
+        bool operator()(node_function* node)
+        {
+            assert(false && "unnamed function unimplemented.");
+            return true;
+        }
+
+        // Nested functions are only defined here, not run.
+        bool operator()(node_named_function* node) { return true; }
+        bool operator()(node_parameter* node) { return true; }
+
+        bool operator()(node_scope* node)
+        {
+            std::uint32_t i = stage()++;
+            if (i < node->scoped_statements.size())
+                return push(node->scoped_statements[i]);
+            return true;
+        }
+
+        bool operator()(node_statement* node) { return replace(node->n_value); }
+        bool operator()(node_scoped_statement* node) { return replace(node->n_value); }
+        bool operator()(node_expression* node) { return replace(node->n_value); }
+        bool operator()(node_term* node) { return replace(node->n_value); }
+
+        bool operator()(node_return* node)
+        {
+            e._returned = true;
+            return true;
+        }
+
+        bool operator()(node_if* node)
+        {
+            if (stage()++ == 0)
+                return push(node->n_expression);
+            if (pop_result())
+                return replace(node->n_statement);
+            return true;
+        }
+
+        bool operator()(node_reassign* node)
+        {
+            if (stage()++ == 0)
+                return push(node->n_expression);
+            auto value = e._values.find(node->n_identifier->declaration);
+            if (value == e._values.end())
+                return fail(); // A global object.
+            value->second = pop_result();
+            return true;
+        }
+
+        bool operator()(node_scoped_if* node)
+        {
+            // Each if takes two stages: one before its expression, and one after.
+            std::uint32_t stage = this->stage()++;
+            std::size_t i = stage / 2;
+            if (stage % 2 == 0)
+            {
+                if (i == node->ifs.size())
+                    return true;
+                if (node->ifs[i]->n_expression)
+                    return push(node->ifs[i]->n_expression);
+                return replace(node->ifs[i]->n_statement); // Else blocks are always taken if they're reached.
+            }
+            if (pop_result())
+                return replace(node->ifs[i]->n_statement);
+            return false; // Try the next if.
+        }
+
+        bool operator()(node_binary_expression* node)
+        {
+            switch (stage()++)
+            {
+            case 0:
+                return push(node->n_expression_lhs);
+            case 1:
+                return push(node->n_expression_rhs);
+            }
+            std::uint64_t rhs = pop_result();
+            std::uint64_t lhs = pop_result();
+            return push_result(evaluate(node->n_binary_operator, lhs, rhs));
+        }
+
+        bool operator()(node_binary_operator* node) { return true; }
+        bool operator()(node_parameter_pass* node) { return true; }
+
+        bool operator()(node_integer_literal* node)
+        {
+            return push_result(get_value(node));
+        }
+
+        bool operator()(node_identifier* node)
+        {
+            auto value = e._values.find(node->declaration);
+            return push_result(value != e._values.end() ? value->second : std::nullopt); // Not in the table means a global object.
+        }
+
+        bool operator()(node_forward_slash) { return true; }
+        bool operator()(node_percent) { return true; }
+        bool operator()(node_asterisk) { return true; }
+        bool operator()(node_plus) { return true; }
+        bool operator()(node_minus) { return true; }
+        bool operator()(node_in) { return true; }
+        bool operator()(node_out) { return true; }
+        bool operator()(node_inout) { return true; }
+        bool operator()(node_copy) { return true; }
+        bool operator()(node_move) { return true; }
+
+    private:
+        // Stops the run. Returns true so the current node isn't resumed.
+        bool fail()
+        {
+            e._failed = true;
+            return true;
+        }
+
+        // Pushes the value of the current expression, or stops the run if it isn't known.
+        bool push_result(std::optional<std::uint64_t> value)
+        {
+            if (!value)
+                return fail();
+            e._results.push_back(*value);
+            return true;
+        }
+
+        [[nodiscard]] std::uint64_t pop_result()
+        {
+            std::uint64_t result = e._results.back();
+            e._results.pop_back();
+            return result;
+        }
+    };
+
+    auto function_evaluator::operator()(const node_named_function* node, std::span<const std::optional<std::uint64_t>> initial_values) -> std::optional<std::vector<std::uint64_t>>
+    {
+        auto& return_values = node->n_function->return_values;
+        auto& parameters = node->n_function->parameters;
+        assert(initial_values.size() == return_values.size() + parameters.size());
+
+        _values.clear();
+        _results.clear();
+        _frames.clear();
+        _returned = false;
+        _failed = false;
+
+        for (std::size_t i = 0; i < return_values.size(); ++i)
+            _values.emplace(return_values[i]->n_name, initial_values[i]);
+        for (std::size_t i = 0; i < parameters.size(); ++i)
+            _values.emplace(parameters[i]->n_declare_object->n_name, initial_values[return_values.size() + i]);
+
+        // Walked a step at a time, to stop once it returns, fails or runs out of fuel.
+        evaluating_visitor visitor(*this);
+        _frames.emplace_back(node->n_function->n_statement);
+        for (std::size_t fuel = _fuel; !_frames.empty() && !_returned; --fuel)
+        {
+            if (fuel == 0)
+                return std::nullopt;
+            visitor.step();
+            if (_failed)
+                return std::nullopt;
+        }
+
+        // Return values hidden by other objects with their names are never used, so they keep whatever the caller pushed.
+        std::vector<std::uint64_t> results(return_values.size());
+        for (std::size_t i = 0; i < return_values.size(); ++i)
+        {
+            const std::optional<std::uint64_t>& value = _values[return_values[i]->n_name];
+            if (!value)
+                return std::nullopt;
+            results[i] = *value;
+        }
+        return results;
+    }
+} // namespace shl
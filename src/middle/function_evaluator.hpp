@@ -0,0 +1,55 @@
+#pragma once
+
+#include "middle/ast.hpp"
+#include "middle/node_ref.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace shl
+{
+    struct evaluating_visitor; // implementation
+
+    // Runs functions at compile time, so a call with known arguments can be replaced with its results.
+    // A function can only be run if it's pure along the path it takes: it may only read its parameters,
+    // and only read and write its return values and local objects. Anything else, like using a global object,
+    // reading an argument that isn't known or an object before it's set, or dividing by zero, stops the run,
+    // and the call is left for run time. Each run visits at most a fixed number of nodes, so it always ends quickly.
+    class function_evaluator
+    {
+    public:
+        // The most nodes a run visits by default.
+        static constexpr std::size_t default_fuel = 1024 * 1024;
+
+        [[nodiscard]] explicit function_evaluator(std::size_t fuel = default_fuel) noexcept : _fuel(fuel) {}
+
+        function_evaluator(const function_evaluator&) = delete;
+        function_evaluator(function_evaluator&&) = delete;
+        function_evaluator& operator=(const function_evaluator&) = delete;
+        function_evaluator& operator=(function_evaluator&&) = delete;
+
+        // Runs the function, starting from what the caller pushes for its return values then its parameters, if known.
+        // Returns the function's return values, or nothing if it can't be run.
+        [[nodiscard]] std::optional<std::vector<std::uint64_t>> operator()(const node_named_function* node, std::span<const std::optional<std::uint64_t>> initial_values);
+
+    private:
+        friend struct evaluating_visitor;
+
+    private:
+        std::size_t _fuel;
+
+        // The run's state.
+
+        // The value of each of the function's objects declared so far, if it's set, by the name in its declaration.
+        std::unordered_map<const node_identifier*, std::optional<std::uint64_t>> _values;
+        // The values of the expressions run so far and not yet used.
+        std::vector<std::uint64_t> _results;
+        std::vector<node_frame> _frames;
+        // If the function returned, or can't be run.
+        bool _returned;
+        bool _failed;
+    };
+} // namespace shl
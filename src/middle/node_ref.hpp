@@ -0,0 +1,177 @@
+#pragma once
+
+#include "common/util.hpp"
+#include "middle/ast.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace shl
+{
+    // Returns the index of T in the variant's alternatives.
+    template <typename T, typename... Ts>
+    consteval std::size_t variant_index(std::type_identity<std::variant<Ts...>>) noexcept
+    {
+        std::size_t index = 0;
+        (void)((std::is_same_v<T, Ts> ? false : (++index, true)) && ...);
+        return index;
+    }
+
+    // The kind of a node type.
+    template <typename T> requires(is_any_of_v<T, NODE_TYPES>)
+    inline constexpr node_kind node_kind_of = static_cast<node_kind>(variant_index<T>(std::type_identity<nodes>()));
+
+    // The node type of a kind.
+    template <node_kind kind>
+    using node_type_of = std::variant_alternative_t<+kind, nodes>;
+
+    // Any node, as its kind and its address, so passes can hold on to nodes of any type
+    // and dispatch on them with a single table lookup; see visit_node.
+    // Nodes that are values, i.e. operators and parameter passes, are referred to where they're stored in their parent.
+    class node_ref
+    {
+    public:
+        [[nodiscard]] constexpr node_ref() noexcept = default;
+        [[nodiscard]] constexpr node_ref(std::monostate) noexcept {}
+
+        // A null node is the none node.
+        template <typename T> requires(is_any_of_v<T*, NODE_TYPES>)
+        [[nodiscard]] constexpr node_ref(T* node) noexcept
+            : _node(node), _kind(node ? node_kind_of<T*> : node_kind::none) {}
+
+        // Refers to whichever node the variant holds, which must outlive this.
+        template <typename... Ts> requires(is_any_of_v<Ts, NODE_TYPES> && ...)
+        [[nodiscard]] constexpr node_ref(const std::variant<Ts...>& node) noexcept
+            : node_ref(std::visit([]<typename T>(const T& node) -> node_ref
+            {
+                if constexpr (std::is_pointer_v<T> || std::is_same_v<T, std::monostate>)
+                    return node;
+                else
+                    return node_ref(const_cast<T*>(&node), node_kind_of<T>);
+            }, node)) {}
+
+        [[nodiscard]] constexpr node_kind get_kind() const noexcept { return _kind; }
+
+        // Returns the node, which must be of the given kind.
+        template <node_kind kind>
+        [[nodiscard]] constexpr node_type_of<kind> get() const noexcept
+        {
+            using T = node_type_of<kind>;
+            if constexpr (std::is_pointer_v<T>)
+                return static_cast<T>(_node);
+            else if constexpr (std::is_same_v<T, std::monostate>)
+                return {};
+            else
+                return *static_cast<const T*>(_node);
+        }
+
+    private:
+        [[nodiscard]] constexpr node_ref(void* node, node_kind kind) noexcept : _node(node), _kind(kind) {}
+
+    private:
+        void* _node = nullptr;
+        node_kind _kind = node_kind::none;
+    };
+
+    // Calls visitor with the node as its own type, like std::visit on nodes.
+    // Each node kind has its own entry in a table built at compile time, so dispatching is one indirect call.
+    template <typename Visitor>
+    decltype(auto) visit_node(Visitor&& visitor, node_ref node)
+    {
+        using result = std::invoke_result_t<Visitor&, std::monostate>;
+        using handler = result(*)(Visitor&, node_ref);
+        static constexpr auto handlers = []<std::size_t... kinds>(std::index_sequence<kinds...>)
+        {
+            return std::array<handler, sizeof...(kinds)>
+            {
+                [](Visitor& visitor, node_ref node) -> result
+                {
+                    return visitor(node.get<static_cast<node_kind>(kinds)>());
+                }...
+            };
+        }(std::make_index_sequence<+node_kind::_count>());
+        return handlers[+node.get_kind()](visitor, node);
+    }
+
+    // A node being walked, and how many times it's been resumed, for walkers that need nothing else to resume it.
+    struct node_frame
+    {
+        node_ref node;
+        std::uint32_t stage = 0;
+    };
+
+    // Walks a tree with an explicit stack of frames instead of recursing, so any depth is fine.
+    // Derived is a visitor whose calls each do as much of a node as they can without its children.
+    // A call returns true if the node is done, or false if it pushed a child first or replaced itself,
+    // in which case the node is called again, with its frame's stage as it left it, once the child is done.
+    // Frame has the node and its stage, and whatever else is needed to resume it, and is made from just the node.
+    // The frames are the pass's, so they can be kept between walks.
+    // Only uses of objects are pushed, never declarations, so an identifier that's visited is always a use,
+    // whose object is found through its declaration. Flattening is the exception, since it copies every node.
+    template <typename Derived, typename Frame = node_frame>
+    class node_walker
+    {
+    public:
+        using node_type = decltype(Frame::node);
+
+        [[nodiscard]] explicit node_walker(std::vector<Frame>& frames) noexcept : _frames(frames) {}
+
+        // Walks the node and everything under it.
+        void walk(node_type root)
+        {
+            _frames.emplace_back(root);
+            while (!_frames.empty())
+                step();
+        }
+
+        // Calls the visitor with the current node, and pops its frame if it's done.
+        void step()
+        {
+            // Copied, since pushing children may move the frame.
+            node_type node = _frames.back().node;
+            if (derived().visit(node))
+                derived().pop();
+        }
+
+    protected:
+        // Trees of other kinds of nodes are dispatched by Derived.
+        bool visit(node_ref node) requires(std::is_same_v<node_type, node_ref>) { return visit_node(derived(), node); }
+
+        void pop() { _frames.pop_back(); }
+
+        // The current node's frame. Invalidated by pushing a child.
+        [[nodiscard]] Frame& frame() { return _frames.back(); }
+        [[nodiscard]] std::uint32_t& stage() { return frame().stage; }
+
+        // Pushes a child of the current node, which is done before the current node is resumed.
+        // Returns false, since the current node isn't done yet.
+        bool push(node_type node)
+        {
+            _frames.emplace_back(node);
+            return false;
+        }
+
+        // Replaces the current node with its children, for nodes that have nothing left to do once they're done.
+        // The children are pushed in reverse so they're done in order.
+        // Returns false, since the children aren't done yet.
+        template <typename... Children>
+        bool replace(const Children&... children)
+        {
+            _frames.pop_back();
+            std::size_t begin = _frames.size();
+            (_frames.emplace_back(node_type(children)), ...);
+            std::reverse(_frames.begin() + begin, _frames.end());
+            return false;
+        }
+
+        std::vector<Frame>& _frames;
+
+    private:
+        [[nodiscard]] Derived& derived() noexcept { return static_cast<Derived&>(*this); }
+    };
+} // namespace shl
@@ -0,0 +1,309 @@
+#include "semantic_analyzer.hpp"
+#include "input.hpp"
+#include "common/error.hpp"
+#include "common/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <optional>
+#include <sstream>
+
+namespace shl
+{
+    // Checks as much of each node as it can without its children.
+    struct semantic_visitor : node_walker<semantic_visitor>
+    {
+        semantic_analyzer& a; // context
+        semantic_analyzer::checker& c;
+
+        [[nodiscard]] explicit semantic_visitor(semantic_analyzer& a, semantic_analyzer::checker& c) noexcept : node_walker(c.frames), a(a), c(c) {}
+
+        bool operator()(std::monostate) { return true; }
+
+        bool operator()(node_program* node)
+        {
+            assert(false && "programs are checked a declaration at a time.");
+            return true;
+        }
+
+        bool operator()(node_declaration* node) { return replace(node->n_value); }
+        bool operator()(node_definition* node) { return replace(node->n_value); }
+
+        bool operator()(node_declare_object* node)
+        {
+            if (c.functions.empty())
+                error_exit("Semantic", "Declaring static objects is unimplemented");
+            a.declare_object(c, node->n_name);
+            return true;
+        }
+
+        bool operator()(node_define_object* node)
+        {
+            // The object is in scope in its own expression.
+            a.declare_object(c, node->n_name);
+            return replace(node->n_expression);
+        }
+
+        bool operator()(node_function* node)
+        {
+            assert(false && "unnamed function unimplemented.");
+            return true;
+        }
+
+        bool operator()(node_named_function* node)
+        {
+            if (stage()++ == 0)
+            {
+                // Top-level functions are all declared before any of their bodies are checked.
+                if (c.is_declaring || !c.functions.empty())
+                    a.declare_function(c, node);
+                if (c.is_declaring)
+                    return true;
+
+                auto& function = c.functions.emplace_back(node->signature);
+                // Parameters are found before return values, and the first of each name before the rest.
+                // Later passes find objects through the declarations found here, so this is the only place this is decided.
+                for (auto n_parameter : node->n_function->parameters)
+                    if (!function.objects.find(n_parameter->n_declare_object->n_name->symbol))
+                        function.objects.insert(n_parameter->n_declare_object->n_name->symbol, n_parameter->n_declare_object->n_name);
+                for (auto n_return_value : node->n_function->return_values)
+                    if (!function.objects.find(n_return_value->n_name->symbol))
+                        function.objects.insert(n_return_value->n_name->symbol, n_return_value->n_name);
+                return push(node->n_function->n_statement);
+            }
+            c.functions.pop_back();
+            return true;
+        }
+
+        bool operator()(node_parameter* node) { return true; }
+
+        bool operator()(node_scope* node)
+        {
+            std::uint32_t i = stage()++;
+            if (i == 0)
+                c.functions.back().objects.begin_scope();
+            if (i < node->scoped_statements.size())
+                return push(node->scoped_statements[i]);
+            c.functions.back().objects.end_scope();
+            return true;
+        }
+
+        bool operator()(node_statement* node) { return replace(node->n_value); }
+        bool operator()(node_scoped_statement* node) { return replace(node->n_value); }
+        bool operator()(node_expression* node) { return replace(node->n_value); }
+        bool operator()(node_term* node) { return replace(node->n_value); }
+        bool operator()(node_return* node) { return true; }
+
+        bool operator()(node_if* node)
+        {
+            return replace(node->n_expression, node->n_statement);
+        }
+
+        bool operator()(node_reassign* node)
+        {
+            if (!resolve(node->n_identifier))
+                error_exit("Semantic", "Undefined object \"" + std::string(node->n_identifier->value) + '"');
+            return replace(node->n_expression);
+        }
+
+        bool operator()(node_scoped_if* node)
+        {
+            // Each if's expression and statement, in reverse so they're checked in order.
+            _frames.pop_back();
+            for (auto it = node->ifs.rbegin(); it != node->ifs.rend(); ++it)
+            {
+                _frames.emplace_back((*it)->n_statement);
+                _frames.emplace_back((*it)->n_expression);
+            }
+            return false;
+        }
+
+        bool operator()(node_binary_expression* node)
+        {
+            return replace(node->n_expression_lhs, node->n_expression_rhs);
+        }
+
+        bool operator()(node_binary_operator* node) { return true; }
+        bool operator()(node_parameter_pass* node) { return true; }
+        bool operator()(node_integer_literal* node) { return true; }
+
+        bool operator()(node_identifier* node)
+        {
+            if (!resolve(node))
+                error_exit("Semantic", "Undeclared identifier");
+            return true;
+        }
+
+        bool operator()(node_forward_slash) { return true; }
+        bool operator()(node_percent) { return true; }
+        bool operator()(node_asterisk) { return true; }
+        bool operator()(node_plus) { return true; }
+        bool operator()(node_minus) { return true; }
+        bool operator()(node_in) { return true; }
+        bool operator()(node_out) { return true; }
+        bool operator()(node_inout) { return true; }
+        bool operator()(node_copy) { return true; }
+        bool operator()(node_move) { return true; }
+
+    private:
+        // Annotates the use of an object with the object's declaration. Returns false if there's no such object in scope.
+        bool resolve(node_identifier* node)
+        {
+            node->declaration = a.find_object(c, node->symbol);
+            return node->declaration;
+        }
+    };
+
+    void semantic_analyzer::operator()()
+    {
+        thread_pool* pool = nullptr;
+        std::vector<checker> checkers(1);
+
+        // Declare everything at the top level in order, checking global objects' expressions along the way.
+        // Only functions declared before any error need their bodies checked, since they could have an earlier error.
+        std::optional<compile_error> declaration_error;
+        {
+            checker& checker = checkers.front();
+            checker.is_declaring = true;
+            error_trap trap;
+            try
+            {
+                for (; checker.index < _root->declarations.size(); ++checker.index)
+                    check(checker, _root->declarations[checker.index]->n_value);
+            }
+            catch (compile_error& error)
+            {
+                declaration_error = std::move(error);
+            }
+            checker.is_declaring = false;
+        }
+
+        // Check the function bodies, keeping each one's error, if any.
+        // Once a function has an error, functions after it don't need to be checked.
+        std::size_t function_count = _global_functions.size();
+        std::vector<std::optional<compile_error>> function_errors(function_count);
+        std::atomic<std::size_t> first_error_index = function_count;
+        auto check_function = [&](std::size_t function_index, std::size_t thread_index)
+        {
+            if (function_index > first_error_index.load(std::memory_order_relaxed))
+                return;
+            checker& checker = checkers[thread_index];
+            checker.index = _global_functions[function_index].index;
+            error_trap trap;
+            try
+            {
+                check(checker, _global_functions[function_index].node);
+            }
+            catch (compile_error& error)
+            {
+                function_errors[function_index] = std::move(error);
+                std::size_t index = first_error_index.load(std::memory_order_relaxed);
+                while (function_index < index && !first_error_index.compare_exchange_weak(index, function_index, std::memory_order_relaxed));
+            }
+        };
+        if (function_count >= min_parallel_function_count && (pool = &get_thread_pool())->get_thread_count() > 1)
+        {
+            checkers.resize(pool->get_thread_count());
+            pool->run(function_count, check_function);
+        }
+        else for (std::size_t i = 0; i < function_count; ++i)
+            check_function(i, 0);
+
+        // Report the first error. Every function was declared before the declaration error, if any.
+        if (std::size_t index = first_error_index.load(std::memory_order_relaxed); index != function_count)
+            declaration_error = std::move(function_errors[index]);
+        if (declaration_error)
+            error_exit(declaration_error->stage, declaration_error->error_message, declaration_error->line_number, declaration_error->column_number);
+
+        check_entry_point();
+    }
+
+    void semantic_analyzer::check(checker& checker, node_ref root)
+    {
+        // Left over from an error, if any.
+        checker.frames.clear();
+        checker.functions.clear();
+
+        semantic_visitor(*this, checker).walk(root);
+    }
+
+    void semantic_analyzer::declare_object(checker& checker, node_identifier* n_name)
+    {
+        if (find_object(checker, n_name->symbol))
+            error_exit("Semantic", "Redefined object");
+        if (checker.functions.empty())
+            _global_objects.insert(n_name->symbol, {n_name, checker.index});
+        else
+            checker.functions.back().objects.insert(n_name->symbol, n_name);
+    }
+
+    void semantic_analyzer::declare_function(checker& checker, node_named_function* node)
+    {
+        node->signature = get_interner().intern(create_function_signature(node));
+
+        // A nested function can't have the signature of the function it's in,
+        // of the function's other nested functions, or of any top-level function declared so far.
+        const std::size_t* index = _global_function_signatures.find(node->signature);
+        if (index && *index > checker.index)
+            index = nullptr;
+        if (checker.functions.empty())
+        {
+            if (index)
+                error_exit("Semantic", "Redefined function");
+            _global_function_signatures.insert(node->signature, checker.index);
+            _global_functions.emplace_back(node, checker.index);
+        }
+        else
+        {
+            auto& function = checker.functions.back();
+            if (index || function.signature == node->signature || function.nested_functions.find(node->signature))
+                error_exit("Semantic", "Redefined function");
+            function.nested_functions.insert(node->signature, {});
+        }
+    }
+
+    node_identifier* semantic_analyzer::find_object(const checker& checker, symbol_id symbol) const
+    {
+        if (!checker.functions.empty())
+            if (auto declaration = checker.functions.back().objects.find(symbol))
+                return *declaration;
+        if (auto object = _global_objects.find(symbol); object && object->index <= checker.index)
+            return object->declaration;
+        return nullptr;
+    }
+
+    void semantic_analyzer::check_entry_point() const
+    {
+        auto entry_point_symbol = get_interner().find(get_input().entry_point);
+        if (!entry_point_symbol) return;
+        auto it = std::ranges::find(_global_functions, *entry_point_symbol, [](const global_function& function) { return function.node->n_name->symbol; });
+        if (it == _global_functions.end()) return;
+        auto entry_point = it->node->n_function;
+
+        if (entry_point->return_values.size() > 1)
+            error_exit("Semantic", "Ill-formed entry point. Incorrect return value count. Must be 0 or 1");
+        if (entry_point->parameters.size() != 2 && !entry_point->parameters.empty())
+            error_exit("Semantic", "Ill-formed entry point. Incorrect parameter count. Must be 0 or 2");
+    }
+
+    std::string semantic_analyzer::create_function_signature(const node_named_function* node)
+    {
+        std::stringstream s_signaure;
+        s_signaure << node->n_name->value;
+
+        s_signaure << '_';
+        for (auto n_return_value : node->n_function->return_values)
+            s_signaure << '_' << n_return_value->n_name->value; // TODO: When types are implemented, change "n_name" to "n_type".
+
+        s_signaure << '_';
+        for (auto n_parameter : node->n_function->parameters)
+            s_signaure << '_' << n_parameter->n_declare_object->n_name->value; // TODO: When types are implemented, change "n_name" to "n_type".
+
+        // Change asterisks (from pointer types) to periods to appease assembler.
+        std::string signature = s_signaure.str();
+        for (char& c : signature)
+            if (c == '*')
+                c = '.';
+        return signature;
+    }
+} // namespace shl
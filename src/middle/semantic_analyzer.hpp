@@ -0,0 +1,104 @@
+#pragma once
+
+#include "common/symbol_table.hpp"
+#include "middle/ast.hpp"
+#include "middle/node_ref.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace shl
+{
+    struct semantic_visitor; // implementation
+
+    // Checks that a program is well-formed before it's generated, so generation never fails:
+    // every identifier must name an object in scope, nothing may be redefined, and the entry point must be well-formed.
+    // Annotates the AST along the way, with each use of an object's declaration and each function's signature.
+    // Top-level declarations are checked in order first. Each top-level function's body only depends on
+    // what was declared before it, so the bodies are then checked on every thread of the thread pool.
+    // Errors are reported exactly as checking everything in order would report them.
+    class semantic_analyzer
+    {
+    public:
+        [[nodiscard]] explicit semantic_analyzer(node_program* root) noexcept : _root(root) {}
+
+        semantic_analyzer(const semantic_analyzer&) = delete;
+        semantic_analyzer(semantic_analyzer&&) = delete;
+        semantic_analyzer& operator=(const semantic_analyzer&) = delete;
+        semantic_analyzer& operator=(semantic_analyzer&&) = delete;
+
+        // Exits with the first error in the program, if any.
+        void operator()();
+
+    private:
+        // A global object, and the index of the top-level declaration that defines it.
+        struct global_object
+        {
+            node_identifier* declaration;
+            std::size_t index;
+        };
+
+        // A top-level function, and the index of the top-level declaration that defines it.
+        struct global_function
+        {
+            node_named_function* node;
+            std::size_t index;
+        };
+
+        // A function whose body is being checked.
+        struct function_scope
+        {
+            symbol_id signature;
+            // The name in each object's declaration, scoped with the function's scopes.
+            symbol_table<node_identifier*> objects;
+            // The signatures of the function's nested functions.
+            symbol_table<std::monostate> nested_functions;
+        };
+
+        // The state of checking one top-level declaration. Each thread has its own.
+        struct checker
+        {
+            // The index of the top-level declaration being checked. Globals defined after it aren't in scope.
+            std::size_t index = 0;
+            // If top-level declarations are being declared, in which case function bodies aren't checked yet.
+            bool is_declaring = false;
+            // The functions being checked, innermost last.
+            std::vector<function_scope> functions;
+            std::vector<node_frame> frames;
+        };
+
+    private:
+        // Checks the node and everything under it.
+        void check(checker& checker, node_ref root);
+
+        // Declares the object in the innermost function, or globally if there isn't one.
+        void declare_object(checker& checker, node_identifier* n_name);
+
+        // Declares the top-level function, or the nested function in the innermost function.
+        void declare_function(checker& checker, node_named_function* node);
+
+        // Returns the name in the declaration of the object in scope with the given name, if any.
+        [[nodiscard]] node_identifier* find_object(const checker& checker, symbol_id symbol) const;
+
+        // Checks the entry point, if there is one.
+        void check_entry_point() const;
+
+        // Returns the function's mangled signature.
+        [[nodiscard]] static std::string create_function_signature(const node_named_function* node);
+
+        friend struct semantic_visitor;
+
+    private:
+        // Fewer top-level functions than this aren't worth waking other threads for.
+        static constexpr std::size_t min_parallel_function_count = 16;
+
+        node_program* _root;
+        symbol_table<global_object> _global_objects;
+        // Indices of the top-level declarations of functions, by signature.
+        symbol_table<std::size_t> _global_function_signatures;
+        // Every top-level function, in order.
+        std::vector<global_function> _global_functions;
+    };
+} // namespace shl
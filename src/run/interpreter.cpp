@@ -0,0 +1,96 @@
+#include "interpreter.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace shl
+{
+    // An instruction with its op replaced by the address of its handler.
+    struct threaded_instruction
+    {
+        const void* handler;
+        std::uint32_t a;
+        std::uint32_t b;
+        std::uint32_t c;
+    };
+
+    std::optional<std::uint64_t> interpreter::operator()(int argc, char* argv[]) const
+    {
+        // The address of each op's handler, in the same order as bytecode_op.
+        static const void* const handlers[]
+        {
+            &&op_move,
+            &&op_load,
+            &&op_store,
+            &&op_div,
+            &&op_mod,
+            &&op_mul,
+            &&op_add,
+            &&op_sub,
+            &&op_jump,
+            &&op_jump_if_zero,
+            &&op_exit,
+        };
+        static_assert(sizeof(handlers) / sizeof(*handlers) == +bytecode_op::_count);
+
+        std::vector<threaded_instruction> code;
+        code.reserve(_bytecode.instructions.size());
+        for (auto& instruction : _bytecode.instructions)
+            code.push_back({handlers[+instruction.op], instruction.a, instruction.b, instruction.c});
+
+        std::vector<std::uint64_t> registers = _bytecode.registers;
+        if (_bytecode.argc_register)
+        {
+            registers[*_bytecode.argc_register] = static_cast<std::uint64_t>(argc);
+            registers[*_bytecode.argv_register] = reinterpret_cast<std::uintptr_t>(argv);
+        }
+
+        std::uint64_t* r = registers.data();
+        const threaded_instruction* ip = code.data();
+
+#define DISPATCH() goto *ip->handler
+#define NEXT() do { ++ip; DISPATCH(); } while (false)
+
+        // Every program ends with an exit, so ip never runs past the end.
+        DISPATCH();
+
+    op_move:
+        r[ip->a] = r[ip->b];
+        NEXT();
+    op_load:
+        r[ip->a] = *reinterpret_cast<const std::uint64_t*>(r[ip->b]);
+        NEXT();
+    op_store:
+        *reinterpret_cast<std::uint64_t*>(r[ip->a]) = r[ip->b];
+        NEXT();
+    op_div:
+        if (r[ip->c] == 0)
+            return std::nullopt;
+        r[ip->a] = r[ip->b] / r[ip->c];
+        NEXT();
+    op_mod:
+        if (r[ip->c] == 0)
+            return std::nullopt;
+        r[ip->a] = r[ip->b] % r[ip->c];
+        NEXT();
+    op_mul:
+        r[ip->a] = r[ip->b] * r[ip->c];
+        NEXT();
+    op_add:
+        r[ip->a] = r[ip->b] + r[ip->c];
+        NEXT();
+    op_sub:
+        r[ip->a] = r[ip->b] - r[ip->c];
+        NEXT();
+    op_jump:
+        ip = code.data() + ip->a;
+        DISPATCH();
+    op_jump_if_zero:
+        ip = r[ip->a] ? ip + 1 : code.data() + ip->b;
+        DISPATCH();
+    op_exit:
+        return r[ip->a];
+
+#undef NEXT
+#undef DISPATCH
+    }
+} // namespace shl
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "back/bytecode.hpp"
+#include <cstdint>
+#include <optional>
+
+namespace shl
+{
+    // Runs bytecode in process, so a program can be run straight from its source, without being assembled and linked.
+    // Each instruction's handler jumps straight to the next one's (direct threading with computed gotos),
+    // instead of returning to a central switch, so there's no shared dispatch branch for the CPU to mispredict.
+    class interpreter
+    {
+    public:
+        [[nodiscard]] explicit interpreter(const bytecode& bytecode) noexcept : _bytecode(bytecode) {}
+
+        interpreter(const interpreter&) = delete;
+        interpreter(interpreter&&) = delete;
+        interpreter& operator=(const interpreter&) = delete;
+        interpreter& operator=(interpreter&&) = delete;
+
+        // Runs the program with the arguments given to it. Returns its exit status,
+        // or nothing if it divided by zero, which the native program traps on.
+        [[nodiscard]] std::optional<std::uint64_t> operator()(int argc, char* argv[]) const;
+
+    private:
+        const bytecode& _bytecode;
+    };
+} // namespace shl
@@ -0,0 +1,131 @@
+#include "jit.hpp"
+#include "back/assembler.hpp"
+#include "common/error.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace shl
+{
+    namespace
+    {
+        // Stands in for what's around a native program: whoever calls _start, and the kernel's exit.
+        // The program only preserves rsp, so everything else the caller expects preserved is saved first.
+        void append_runtime(assembly& program)
+        {
+            using enum x86_mnemonic;
+            using x86_register::rax, x86_register::rbx, x86_register::rsp, x86_register::rbp, x86_register::rsi, x86_register::rdi, x86_register::r12;
+            auto label = [](std::string_view name) { return get_interner().intern(name); };
+            symbol_id enter = label("shl_jit_enter");
+            symbol_id push_argv = label("shl_jit_push_argv");
+            symbol_id start = label("shl_jit_start");
+            symbol_id handle_syscall = label("shl_jit_syscall");
+
+            program.section(section_kind::text);
+
+            // Called like a C function with argc and argv.
+            // Lays them out below the saved registers like the kernel does at process entry:
+            // argc at [rsp], then argv's pointers, then a null pointer.
+            program.global(enter);
+            program.label(enter);
+            program.instruction(push, rbx);
+            program.instruction(push, rbp);
+            program.instruction(push, r12);
+            program.instruction(mov, r12, rsp);
+            program.instruction(push, 0);
+            program.instruction(mov, rax, rdi);
+            program.instruction(mov, rbx, 8);
+            program.instruction(mul, rbx);
+            program.instruction(add, rax, rsi);
+            program.label(push_argv);
+            program.instruction(cmp, rax, rsi);
+            program.instruction(je, x86_operand::label(start));
+            program.instruction(sub, rax, 8);
+            program.instruction(mov, rbx, x86_operand::memory(rax, 0, true));
+            program.instruction(push, rbx);
+            program.instruction(jmp, x86_operand::label(push_argv));
+            program.label(start);
+            program.instruction(push, rdi);
+            program.instruction(jmp, x86_operand::label(label("_start")));
+
+            // Called instead of syscall. The only system call the generator emits is exit,
+            // so this returns the status in rdi from shl_jit_enter.
+            program.global(handle_syscall);
+            program.label(handle_syscall);
+            program.instruction(mov, rax, rdi);
+            program.instruction(mov, rsp, r12);
+            program.instruction(pop, r12);
+            program.instruction(pop, rbp);
+            program.instruction(pop, rbx);
+            program.instruction(ret);
+        }
+
+        [[nodiscard]] constexpr std::size_t align_up(std::size_t size, std::size_t alignment) noexcept
+        {
+            return (size + alignment - 1) / alignment * alignment;
+        }
+
+        // Lists the functions in the perf map, in perf's format: "start size name", with start and size in hex.
+        // The map is appended to, since every region of code a process generates goes in the same one.
+        void write_perf_map(const object_code& code, const std::uint8_t* text)
+        {
+            std::ofstream perf_map("/tmp/perf-" + std::to_string(getpid()) + ".map", std::ios::app);
+            if (!perf_map)
+                return; // Profiling isn't worth failing the run for.
+            perf_map << std::hex;
+            for (auto& symbol : code.symbols)
+                if (symbol.is_function)
+                    perf_map << reinterpret_cast<std::uintptr_t>(text + symbol.offset) << ' ' << symbol.size << ' ' << symbol.name << '\n';
+        }
+    } // namespace
+
+    std::uint64_t jit::operator()(int argc, char* argv[])
+    {
+        append_runtime(_program);
+        assembler assembler(_program, get_interner().intern("shl_jit_syscall"));
+        object_code code = assembler();
+
+        // Text goes first, then data and bss on pages of their own, so text can be made executable but not writable.
+        // Everything is in one mapping, so RIP-relative references always reach.
+        std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        std::size_t data_offset = align_up(code.text.size(), page_size);
+        std::size_t bss_offset = data_offset + code.data.size();
+        std::size_t size = data_offset + align_up(code.data.size() + code.bss_size, page_size);
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            error_exit("JIT", "Unable to map memory for the program");
+        auto base = static_cast<std::uint8_t*>(memory);
+        std::ranges::copy(code.text, base);
+        std::ranges::copy(code.data, base + data_offset); // bss is already zeroed.
+
+        auto get_address = [&](const object_code::symbol& symbol) -> std::uint8_t*
+        {
+            switch (symbol.section)
+            {
+            case section_kind::text: return base + symbol.offset;
+            case section_kind::data: return base + data_offset + symbol.offset;
+            case section_kind::bss:  return base + bss_offset + symbol.offset;
+            default: error_exit("JIT", "Undefined symbol " + symbol.name);
+            }
+        };
+
+        for (auto& relocation : code.relocations)
+        {
+            std::uint8_t* location = base + relocation.offset;
+            auto displacement = static_cast<std::int32_t>(get_address(code.symbols[relocation.symbol]) + relocation.addend - location);
+            std::memcpy(location, &displacement, sizeof(displacement));
+        }
+
+        if (mprotect(base, data_offset, PROT_READ | PROT_EXEC) != 0)
+            error_exit("JIT", "Unable to make the program executable");
+        write_perf_map(code, base);
+
+        auto enter = reinterpret_cast<std::uint64_t(*)(int, char**)>(get_address(*code.find("shl_jit_enter")));
+        std::uint64_t status = enter(argc, argv);
+        munmap(memory, size);
+        return status;
+    }
+} // namespace shl
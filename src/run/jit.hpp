@@ -0,0 +1,29 @@
+#pragma once
+
+#include "back/assembly.hpp"
+#include <cstdint>
+#include <utility>
+
+namespace shl
+{
+    // Runs generated assembly in process: it's encoded straight into executable memory and its _start is called,
+    // so a program runs as native code without an external assembler or linker, nor a process of its own.
+    // Its functions are listed in /tmp/perf-<pid>.map, so perf can attribute samples in them to their signatures.
+    class jit
+    {
+    public:
+        [[nodiscard]] explicit jit(assembly program) noexcept : _program(std::move(program)) {}
+
+        jit(const jit&) = delete;
+        jit(jit&&) = delete;
+        jit& operator=(const jit&) = delete;
+        jit& operator=(jit&&) = delete;
+
+        // Runs the program with the arguments given to it, and returns its exit status.
+        // Like the native program, dividing by zero kills the process with SIGFPE.
+        [[nodiscard]] std::uint64_t operator()(int argc, char* argv[]);
+
+    private:
+        assembly _program;
+    };
+} // namespace shl
@@ -2,8 +2,20 @@
 #include "input.hpp"
 #include "common/error.hpp"
 #include "front/lexer.hpp"
-#include "front/parser.hpp"
+#include "front/parallel_parser.hpp"
+#include "middle/constant_folder.hpp"
+#include "middle/flat_ast.hpp"
+#include "middle/semantic_analyzer.hpp"
+#include "back/assembler.hpp"
+#include "back/bytecode_generator.hpp"
+#include "back/elf_writer.hpp"
 #include "back/generator.hpp"
+#include "back/ir_assembly_generator.hpp"
+#include "back/ir_code_generator.hpp"
+#include "run/interpreter.hpp"
+#include "run/jit.hpp"
+#include <csignal>
+#include <optional>
 
 using namespace shl;
 
@@ -11,19 +23,91 @@ int main(int argc, char* argv[])
 {
     auto& input = handle_input(argc, argv);
 
-    // Read the input file.
-    std::string in_file_contents;
+    // Read the input file. It stays mapped for the whole compilation,
+    // since tokens and identifiers in the AST view it directly.
+    fileio::source_buffer in_file_contents;
     if (!fileio::read(input.in_path, in_file_contents))
         error_exit("Input", "Unable to open input file");
 
-    lexer lexer(std::move(in_file_contents));
-    parser parser(lexer());
-    generator generator(parser());
-    auto assembly = generator();
+    lexer lexer(in_file_contents.view());
+    std::optional<parallel_parser> parser(std::in_place, lexer);
+    auto program = (*parser)();
+    semantic_analyzer analyzer(program);
+    analyzer();
+    constant_folder folder(program);
+    folder();
+
+    if (input.mode == input::mode::run)
+    {
+        // Bytecode is compiled from the IR, like the IR backend's assembly.
+        flat_ast ast(program);
+        parser.reset();
+        ir_code_generator ir_code_generator(ast);
+        auto code = ir_code_generator();
+        bytecode_generator bytecode_generator(code);
+        auto bytecode = bytecode_generator();
+        interpreter interpreter(bytecode);
+        auto status = interpreter(input.program_argc, input.program_argv);
+        if (!status)
+        {
+            // Die like the native program would.
+            std::signal(SIGFPE, SIG_DFL);
+            std::raise(SIGFPE);
+        }
+        return static_cast<int>(*status & 0xFF);
+    }
+
+    assembly generated;
+    if (input.format == input::format::ir || input.ir_backend)
+    {
+        // The IR is lowered from the flat AST, so the pointer AST's arenas can go once it's flattened.
+        flat_ast ast(program);
+        parser.reset();
+        ir_code_generator ir_code_generator(ast);
+        auto code = ir_code_generator();
+        if (input.format == input::format::ir)
+        {
+            if (!fileio::write(input.out_path, code.to_string()))
+                error_exit("Output", "Unable to open output file");
+            return EXIT_SUCCESS;
+        }
+        ir_assembly_generator ir_assembly_generator(code);
+        generated = ir_assembly_generator();
+    }
+    else
+    {
+        generator generator(program);
+        generated = generator();
+    }
+
+    if (input.mode == input::mode::jit)
+    {
+        jit jit(std::move(generated));
+        return static_cast<int>(jit(input.program_argc, input.program_argv) & 0xFF);
+    }
+
+    // Assemble and link in process, unless the assembly itself is wanted, which is the only time it's written as text.
+    std::string output;
+    if (input.format == input::format::assembly)
+        output = generated.to_string();
+    else
+    {
+        assembler assembler(generated);
+        auto code = assembler();
+        elf_writer elf_writer(code);
+        output = input.format == input::format::object ? elf_writer.relocatable() : elf_writer.executable();
+    }
 
     // Write the output file.
-    if (!fileio::write(input.out_path, assembly))
+    if (!fileio::write(input.out_path, output))
         error_exit("Output", "Unable to open output file");
+    if (input.format == input::format::executable)
+    {
+        std::error_code error;
+        std::filesystem::permissions(input.out_path, std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec | std::filesystem::perms::others_exec, std::filesystem::perm_options::add, error);
+        if (error)
+            error_exit("Output", "Unable to make output file executable");
+    }
 
     return EXIT_SUCCESS;
 }
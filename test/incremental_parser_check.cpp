@@ -0,0 +1,107 @@
+// Checks that editing a source file with the incremental parser gives the same program as parsing the edited
+// source code from scratch. Random edits, including ones that break the code, are applied to the input file,
+// and each one that breaks the code is undone, so the code keeps going in and out of parsing.
+// Usage: incremental_parser_check <file.shl> [edit count] [seed]
+
+#include "fileio.hpp"
+#include "front/incremental_parser.hpp"
+#include "middle/flat_ast.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace shl;
+
+namespace
+{
+    // Returns the program, flattened and serialized, so programs can be compared by their bytes.
+    std::vector<std::byte> serialize(const node_program& program)
+    {
+        // flat_ast only reads the tree.
+        std::vector<std::byte> buffer;
+        flat_ast(const_cast<node_program*>(&program)).serialize(buffer);
+        return buffer;
+    }
+
+    [[noreturn]] void fail(std::string_view message, std::size_t edit)
+    {
+        std::cerr << "Edit " << edit << ": " << message << '\n';
+        std::exit(EXIT_FAILURE);
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <file.shl> [edit count] [seed]\n";
+        return EXIT_FAILURE;
+    }
+    fileio::source_buffer in_file_contents;
+    if (!fileio::read(argv[1], in_file_contents))
+    {
+        std::cerr << "Unable to open input file\n";
+        return EXIT_FAILURE;
+    }
+    std::size_t edit_count = argc > 2 ? std::stoul(argv[2]) : 1000;
+    std::mt19937_64 random(argc > 3 ? std::stoul(argv[3]) : 1);
+
+    std::string source_code(in_file_contents.view());
+    incremental_parser parser(source_code);
+
+    // Pieces that open and close comments, scopes and declarations, or just extend tokens.
+    static constexpr std::string_view pieces[]{"/*", "*/", "//", "{", "}", "(", ")", ";", ":", ":=", "=", "+", "x", "1", " ", "\n", "main", "let"};
+    auto random_below = [&random](std::size_t n) { return std::uniform_int_distribution<std::size_t>(0, n - 1)(random); };
+
+    std::size_t parsed_count = 0;
+    std::size_t edits_made = 0;
+    std::chrono::nanoseconds edit_time{};
+    // Returns whether the edited file parses.
+    auto edit = [&](std::size_t offset, std::size_t length, std::string_view replacement, std::size_t i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        parser.edit(offset, length, replacement);
+        edit_time += std::chrono::steady_clock::now() - begin;
+        ++edits_made;
+        source_code.replace(offset, length, replacement);
+
+        if (parser.size() != source_code.size() || parser.get_source_code() != source_code)
+            fail("The source code differs from the edited source code.", i);
+
+        // If the whole file parses, the edited program must be the same, with no errors.
+        incremental_parser reparsed(source_code);
+        if (!reparsed.get_errors().empty())
+            return false;
+        ++parsed_count;
+        if (!parser.get_errors().empty())
+            fail("The file parses, but the edited file has errors.", i);
+        if (serialize(parser.get_program()) != serialize(reparsed.get_program()))
+            fail("The program differs from a full re-parse.", i);
+        return true;
+    };
+
+    for (std::size_t i = 0; i < edit_count; ++i)
+    {
+        // Replace a short span with a piece, or with a copy of another span.
+        std::size_t offset = random_below(source_code.size() + 1);
+        std::size_t length = std::min(random_below(8), source_code.size() - offset);
+        std::string replacement;
+        if (random_below(4))
+            replacement = pieces[random_below(std::size(pieces))];
+        else
+        {
+            std::size_t copy_offset = random_below(source_code.size() + 1);
+            replacement = source_code.substr(copy_offset, random_below(64));
+        }
+        std::string replaced = source_code.substr(offset, length);
+        if (!edit(offset, length, replacement, i))
+            edit(offset, replacement.size(), replaced, i);
+    }
+
+    std::cout << edits_made << " edits checked, " << parsed_count << " of them parsed, "
+        << std::chrono::duration_cast<std::chrono::microseconds>(edit_time).count() / std::max<std::size_t>(edits_made, 1) << " us per edit.\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+// Checks that every vectorized lexer scanner the CPU supports lexes like the scalar one.
+// Random inputs, made of long and short runs of each kind of character the scanners skip, are lexed with each scanner,
+// and their tokens, token locations and errors are compared to the scalar scanner's.
+// Usage: lexer_scan_check [input count] [seed]
+
+#include "common/error.hpp"
+#include "front/lexer.hpp"
+#include "front/lexer_scan.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace shl;
+
+namespace
+{
+    // A lexed token, with the location after it.
+    struct lexed_token
+    {
+        token_type type;
+        std::uint32_t offset;
+        std::uint32_t length;
+        source_location end;
+
+        bool operator==(const lexed_token& other) const noexcept
+        {
+            return type == other.type && offset == other.offset && length == other.length
+                && end.line_number == other.end.line_number && end.column_number == other.end.column_number;
+        }
+    };
+
+    // Every token lexed before the end or an error, and the error, if any.
+    struct lexed_source
+    {
+        std::vector<lexed_token> tokens;
+        std::string error;
+
+        bool operator==(const lexed_source&) const = default;
+    };
+
+    lexed_source lex(std::string_view source_code, const lexer_scanner& scanner)
+    {
+        lexed_source lexed;
+        lexer lexer(source_code, scanner);
+        error_trap trap;
+        try
+        {
+            for (token t; lexer.next(t); )
+                lexed.tokens.push_back({t.type, t.offset, t.length, lexer.get_location(t)});
+        }
+        catch (const compile_error& error)
+        {
+            lexed.error = error.error_message + " at " + std::to_string(error.line_number) + ':' + std::to_string(error.column_number);
+        }
+        return lexed;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t input_count = argc > 1 ? std::stoul(argv[1]) : 2000;
+    std::mt19937_64 random(argc > 2 ? std::stoul(argv[2]) : 1);
+    auto random_below = [&random](std::size_t n) { return std::uniform_int_distribution<std::size_t>(0, n - 1)(random); };
+
+    // Pieces that start and end each kind of run, and characters that end runs in the middle of a vector.
+    static constexpr std::string_view pieces[]{" ", "\t", "\n", "\r\n", "\v\f", "//", "/*", "*/", "*", "/", "x", "Z", "_", "7", "0",
+        ":=", ";", "{", "}", "(", ")", "+", "-", "%", "main", "let", "\x7f", "@", "\xc3\xa9"};
+    // Characters that are repeated into long runs, so the vectorized loops run more than once.
+    static constexpr char run_chars[]{' ', '\n', '\t', 'a', 'Q', '_', '5', '*', '/'};
+
+    auto scanners = get_lexer_scanners();
+    for (std::size_t i = 0; i < input_count; ++i)
+    {
+        std::string source_code;
+        std::size_t piece_count = random_below(200);
+        for (std::size_t j = 0; j < piece_count; ++j)
+        {
+            if (random_below(4))
+                source_code += pieces[random_below(std::size(pieces))];
+            else
+                source_code.append(random_below(80), run_chars[random_below(std::size(run_chars))]);
+        }
+
+        lexed_source expected = lex(source_code, *scanners.front());
+        for (std::size_t j = 1; j < scanners.size(); ++j)
+        {
+            if (lex(source_code, *scanners[j]) != expected)
+            {
+                std::cerr << "Input " << i << ": scanner " << j << " lexes differently from the scalar scanner.\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    std::cout << input_count << " inputs checked with " << scanners.size() << " scanners.\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+// Checks that the parallel parser keeps every top-level declaration, and parses them like a serial parse,
+// for programs of sizes around where it starts splitting the tokens into batches and waking other threads.
+// Usage: parallel_parser_check
+
+#include "front/incremental_parser.hpp"
+#include "front/lexer.hpp"
+#include "front/parallel_parser.hpp"
+#include "middle/flat_ast.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace shl;
+
+namespace
+{
+    // Returns the program, flattened and serialized, so programs can be compared by their bytes.
+    std::vector<std::byte> serialize(const node_program& program)
+    {
+        // flat_ast only reads the tree.
+        std::vector<std::byte> buffer;
+        flat_ast(const_cast<node_program*>(&program)).serialize(buffer);
+        return buffer;
+    }
+} // namespace
+
+int main()
+{
+    // Each global is 4 tokens, so these are on both sides of one and two 16 KiB batches of tokens.
+    static constexpr std::size_t global_counts[]{1, 1000, 4095, 4096, 6000, 8191, 8192, 20000};
+    for (std::size_t global_count : global_counts)
+    {
+        std::string source_code;
+        for (std::size_t i = 0; i < global_count; ++i)
+            source_code += "g" + std::to_string(i) + " := " + std::to_string(i) + ";\n";
+        source_code += "main: (status: let; argc: let, argv: let) = { status = g0; }\n";
+
+        lexer lexer(source_code);
+        parallel_parser parser(lexer);
+        node_program* program = parser();
+        incremental_parser reparsed(source_code);
+
+        if (program->declarations.size() != global_count + 1)
+        {
+            std::cerr << global_count << " globals: " << program->declarations.size() << " of "
+                << global_count + 1 << " declarations were parsed.\n";
+            return EXIT_FAILURE;
+        }
+        if (!reparsed.get_errors().empty() || serialize(*program) != serialize(reparsed.get_program()))
+        {
+            std::cerr << global_count << " globals: the program differs from a serial parse.\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::size(global_counts) << " program sizes checked.\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+// Checks that each program exits the same when built to an executable, run with --run, and run with --jit,
+// with no arguments and with a few, since programs can exit with their argc.
+// Usage: run_modes_check <shl> <file.shl>...
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    // Runs the command and returns how it ended: its exit status, or minus the signal that killed it.
+    int run(std::vector<std::string> arguments)
+    {
+        std::vector<char*> argv;
+        for (auto& argument : arguments)
+            argv.push_back(argument.data());
+        argv.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+        int status;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0)
+        {
+            std::cerr << "Unable to run " << arguments[0] << '\n';
+            std::exit(EXIT_FAILURE);
+        }
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <shl> <file.shl>...\n";
+        return EXIT_FAILURE;
+    }
+    std::string compiler = std::filesystem::absolute(argv[1]);
+    std::string executable = std::filesystem::temp_directory_path() / ("run_modes_check_" + std::to_string(getpid()));
+
+    static const std::vector<std::string> argument_lists[]{{}, {"a", "-b", "--c"}};
+    bool failed = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string source = argv[i];
+        if (run({compiler, source, "-f", "exe", "-o", executable}) != 0)
+        {
+            std::cerr << source << ": unable to build\n";
+            failed = true;
+            continue;
+        }
+        for (auto& arguments : argument_lists)
+        {
+            std::vector<std::string> built{executable}, interpreted{compiler, "--run", source}, jitted{compiler, "--jit", source};
+            for (auto* command : {&built, &interpreted, &jitted})
+                command->insert(command->end(), arguments.begin(), arguments.end());
+            int built_status = run(built);
+            int interpreted_status = run(interpreted);
+            int jitted_status = run(jitted);
+            if (interpreted_status != built_status || jitted_status != built_status)
+            {
+                std::cerr << source << " with " << arguments.size() << " arguments: the executable exits with " << built_status
+                    << ", --run with " << interpreted_status << " and --jit with " << jitted_status << ".\n";
+                failed = true;
+            }
+        }
+    }
+    std::filesystem::remove(executable);
+
+    if (failed)
+        return EXIT_FAILURE;
+    std::cout << argc - 2 << " programs checked in every mode.\n";
+    return EXIT_SUCCESS;
+}